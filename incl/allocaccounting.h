@@ -0,0 +1,45 @@
+#ifndef __ALLOC_ACCOUNTING__
+#define __ALLOC_ACCOUNTING__
+
+#include <cstdint>
+#include <string>
+
+namespace allocaccounting {
+
+// Heap allocations made through operator new while the probe runs, counted
+// only in builds with VT_ALLOC_ACCOUNTING (make ALLOC_ACCOUNTING=1), which
+// replace the global operator new with a counting one. Everything here is
+// a no-op otherwise.
+#ifdef VT_ALLOC_ACCOUNTING
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Buffers the probe may take to size its containers before every further
+// allocation counts as a steady state regression
+constexpr std::uint64_t WARMUP_BUFFERS = 300;
+
+// Allocations by the calling thread so far
+std::uint64_t threadAllocations();
+
+// Accounts one probe invocation, from construction to destruction
+class ProbeScope final {
+ public:
+  ProbeScope();
+  ProbeScope(const ProbeScope &) = delete;
+  ProbeScope(ProbeScope &&) = delete;
+  ~ProbeScope();
+ private:
+  std::uint64_t mStart;
+};
+
+// Buffers past the warm-up that allocated, 0 when accounting is compiled out
+std::uint64_t regressions();
+
+// Counters for the stats surface, empty when accounting is compiled out
+std::string statsJson();
+
+} // namespace allocaccounting
+
+#endif //__ALLOC_ACCOUNTING__
@@ -0,0 +1,29 @@
+#ifndef __APP_PARSER__
+#define __APP_PARSER__
+
+#include "types.h"
+
+namespace appparser {
+
+bool setAppProperties (vehicletracking::app_info_t&);
+bool setAggregationProperties (odwindows::windows_info_t&);
+bool setStatsServerProperties (statsserver::stats_info_t&);
+bool setCheckpointProperties (checkpoint::checkpoint_info_t&);
+bool setLoggingProperties (logger::log_info_t&);
+bool setSharedCountersProperties (shmcounters::shared_counters_info_t&);
+bool setIntervalControlProperties (intervalcontrol::interval_control_info_t&);
+bool setQueueControlProperties (queuecontrol::queue_control_info_t&);
+bool setPlacementProperties (placement::placement_info_t&);
+bool setStitchingProperties (stitching::stitching_info_t&);
+bool setCubeProperties (odcube::cube_info_t&);
+bool setOccupancyProperties (occupancy::occupancy_info_t&);
+bool setArchiveProperties (archive::archive_info_t&);
+bool setConfigWatchProperties (configwatch::config_watch_info_t&);
+bool setSourcesProperties (sources::sources_info_t&);
+bool setMetricsProperties (metrics::metrics_info_t&);
+bool setWatchdogProperties (watchdog::watchdog_info_t&);
+bool setMetaRingProperties (metaring::meta_ring_info_t&);
+
+} // namespace appparser
+
+#endif //__APP_PARSER__
@@ -0,0 +1,133 @@
+#ifndef __EVENT_ARCHIVE__
+#define __EVENT_ARCHIVE__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace archive {
+
+constexpr auto ERR_MSG_OPEN_FILE = "Unable to open archive file";
+constexpr auto ERR_MSG_MAP_FILE = "Unable to map archive file";
+constexpr auto ERR_MSG_FORMAT = "Not an archive file";
+
+// Archive files hold crossing events column by column, in batches, so a
+// reader only touches the columns it needs:
+//
+//   FileHeader
+//   BatchIndex, its column chunks, each 8 byte aligned    (every batch)
+//   BatchIndex of every batch                              (the footer index)
+//   Trailer
+//
+// Time and object id chunks are zigzag delta varints, travel times plain
+// varints; the small columns are plain little endian arrays that can be
+// used straight from the mapping. The footer is written when the file is
+// rotated, a file cut short by a crash is read by walking the batch
+// headers instead.
+constexpr std::uint64_t MAGIC = 0x31524131434f5456ULL;        // "VTOC1AR1"
+constexpr std::uint64_t BATCH_MAGIC = 0x48435442434f5456ULL;  // "VTOCBTCH"
+constexpr std::uint32_t VERSION = 1;
+
+enum Column : std::uint8_t { TIME, STREAM, ENTRY, EXIT, OBJECT_ID, CLASS, TRAVEL_MS, COLUMNS };
+
+enum class Encoding : std::uint8_t { Plain = 0, DeltaVarint = 1, Varint = 2 };
+
+struct FileHeader {
+  std::uint64_t mMagic;
+  std::uint32_t mVersion;
+  std::uint32_t mColumns;
+};
+
+struct ChunkIndex {
+  std::uint64_t mOffset;   // from the start of the file
+  std::uint32_t mSize;     // bytes, before padding
+  Encoding mEncoding;
+  std::uint8_t mWidth;     // bytes per decoded value
+  std::uint16_t mReserved;
+};
+
+struct BatchIndex {
+  std::uint64_t mMagic;
+  std::uint32_t mRows;
+  std::uint32_t mReserved;
+  std::uint64_t mFirstTime;  // earliest and latest event, ns since epoch
+  std::uint64_t mLastTime;
+  ChunkIndex mChunks[COLUMNS];
+};
+
+struct Trailer {
+  std::uint64_t mIndexOffset;
+  std::uint32_t mBatches;
+  std::uint32_t mVersion;
+  std::uint64_t mMagic;
+};
+
+struct Event {
+  std::uint64_t mTime;      // wall clock, ns since epoch
+  std::uint64_t mObjectId;
+  std::uint32_t mTravelMs;  // entry to exit
+  std::uint16_t mStream;
+  std::int16_t mClass;
+  std::uint8_t mEntry;
+  std::uint8_t mExit;
+};
+using event_t = struct Event;
+
+// A batch of events, column by column
+struct Columns {
+  void reserve(const std::size_t);
+  void clear();
+  void push(const event_t &);
+  std::size_t size() const { return mTime.size(); }
+  event_t event(const std::size_t) const;
+
+  std::vector<std::uint64_t> mTime;
+  std::vector<std::uint16_t> mStream;
+  std::vector<std::uint8_t> mEntry;
+  std::vector<std::uint8_t> mExit;
+  std::vector<std::uint64_t> mObjectId;
+  std::vector<std::int16_t> mClass;
+  std::vector<std::uint32_t> mTravelMs;
+};
+using columns_t = struct Columns;
+
+// Encodes a batch, index first, to be written at the given file offset.
+// Reuses the output buffer.
+void encode(const columns_t &, const std::uint64_t, std::vector<std::uint8_t> &);
+
+// Maps an archive file read only. Throws std::runtime_error when it is not
+// one.
+class ArchiveReader final {
+ public:
+  ArchiveReader() = delete;
+  explicit ArchiveReader(const std::string &);
+  ArchiveReader(const ArchiveReader &) = delete;
+  ArchiveReader(ArchiveReader &&) = delete;
+  ~ArchiveReader();
+
+  std::size_t batches() const { return mIndex.size(); }
+  const BatchIndex &batch(const std::size_t idx) const { return mIndex[idx]; }
+  // The footer was missing, batches were found by walking the file
+  bool recovered() const { return mRecovered; }
+
+  // Decodes the selected columns of a batch, a bit mask of 1 << Column,
+  // into reused vectors. False when the batch is damaged.
+  bool decode(const std::size_t, columns_t &, const std::uint32_t = ~0U) const;
+  // A plain column straight from the mapping, nullptr for encoded ones
+  const void *plain(const std::size_t, const Column) const;
+
+ private:
+  bool readFooter();
+  void walkBatches();
+  bool validChunk(const ChunkIndex &) const;
+
+  std::string mPath;
+  const std::uint8_t *mBase;
+  std::size_t mSize;
+  std::vector<BatchIndex> mIndex;
+  bool mRecovered;
+};
+
+} // namespace archive
+
+#endif //__EVENT_ARCHIVE__
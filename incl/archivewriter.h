@@ -0,0 +1,81 @@
+#ifndef __ARCHIVE_WRITER__
+#define __ARCHIVE_WRITER__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "archive.h"
+#include "types.h"
+
+namespace archive {
+
+constexpr auto ERR_MSG_DIRECTORY = "Unable to create archive directory";
+constexpr auto ERR_MSG_BATCHES = "Archive batch-rows, batches and flush-seconds must be positive";
+
+// Archives crossing events into one file per hour, see archive.h for the
+// layout. Events are copied into a pre-sized columnar batch on the
+// streaming thread; full batches, batches older than flush-seconds and
+// the last batch of an hour go to a writer thread that encodes and writes
+// them. The streaming thread never waits for the disk: when every batch is
+// still waiting to be written, events are dropped and counted.
+class ArchiveWriter final {
+ public:
+  ArchiveWriter() = delete;
+  explicit ArchiveWriter(const archive_info_t &);
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter(ArchiveWriter &&) = delete;
+  // Writes what is left and the footer of the last file
+  ~ArchiveWriter();
+
+  // Streaming thread only
+  void append(const event_t &);
+  // Wall clock, ns since epoch, once per buffer
+  void tick(const std::uint64_t);
+
+  std::uint64_t archived() const { return mArchived.load(std::memory_order_relaxed); }
+  std::uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+ private:
+  struct Batch {
+    columns_t mColumns;
+    std::uint64_t mHour;     // since epoch, every event of the batch
+    std::uint64_t mOpened;   // wall clock of the first event
+  };
+
+  void handOff();
+  void run();
+  void write(Batch &);
+  void openFile(const std::uint64_t);
+  void closeFile();
+  bool writeAll(const void *, const std::size_t);
+
+  archive_info_t mInfo;
+  std::uint64_t mFlushAfter;  // nanoseconds
+
+  std::vector<Batch> mPool;
+  Batch *mOpen;                  // streaming thread
+  std::vector<Batch*> mFree;
+  std::vector<Batch*> mFull;     // oldest first
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  bool mStopping;
+
+  // Writer thread
+  int mFd;
+  std::uint64_t mFileHour;
+  std::uint64_t mOffset;
+  std::vector<BatchIndex> mIndex;
+  std::vector<std::uint8_t> mScratch;
+
+  std::atomic<std::uint64_t> mArchived;
+  std::atomic<std::uint64_t> mDropped;
+  std::thread mThread;
+};
+
+} // namespace archive
+
+#endif //__ARCHIVE_WRITER__
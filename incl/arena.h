@@ -0,0 +1,72 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+namespace arena {
+
+constexpr auto ERR_MSG_ARENA_CAPACITY = "Arena capacity must be positive";
+
+// Bump allocator for scratch memory that lives until the next reset, once
+// per buffer in the probe. The block is allocated up front; requests that
+// do not fit spill to the heap, are freed on reset and are counted, so a
+// steady state with no spills allocates nothing.
+class Arena final {
+ public:
+  Arena() = delete;
+  explicit Arena(const std::size_t);
+  Arena(const Arena &) = delete;
+  Arena(Arena &&) = delete;
+  ~Arena() = default;
+
+  void *allocate(const std::size_t, const std::size_t align = alignof(std::max_align_t));
+  // Grows the latest allocation in place, false if it is not the latest
+  // one or the block has no room left
+  bool extend(void *, const std::size_t, const std::size_t);
+  void reset();
+
+  std::size_t capacity() const { return mCapacity; }
+  std::size_t used() const { return mUsed; }
+  std::size_t highWater() const { return mHighWater; }
+  std::uint64_t spills() const { return mSpills; }
+
+ private:
+  std::unique_ptr<char[]> mBlock;
+  std::size_t mCapacity;
+  std::size_t mUsed;
+  std::size_t mHighWater;
+  char *mLast;
+  std::vector<std::unique_ptr<char[]>> mSpilled;  // freed on reset
+  std::uint64_t mSpills;
+};
+
+// Stream buffer over arena memory, so that the std::ostream based JSON
+// writers can build messages without touching the heap. Valid until the
+// arena is reset.
+class TextBuffer final : public std::streambuf {
+ public:
+  TextBuffer() = delete;
+  explicit TextBuffer(Arena &, const std::size_t reserve = 256);
+  TextBuffer(const TextBuffer &) = delete;
+  TextBuffer(TextBuffer &&) = delete;
+  ~TextBuffer() = default;
+
+  const char *data() const { return pbase(); }
+  std::size_t size() const { return static_cast<std::size_t>(pptr() - pbase()); }
+
+ protected:
+  int_type overflow(int_type) override;
+
+ private:
+  bool grow(const std::size_t);
+
+  Arena &mArena;
+};
+
+} // namespace arena
+
+#endif //__ARENA__
@@ -0,0 +1,100 @@
+#ifndef __CHECKPOINT__
+#define __CHECKPOINT__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include "types.h"
+
+namespace checkpoint {
+
+constexpr auto ERR_MSG_OPEN_FILE = "Unable to open checkpoint file";
+constexpr auto ERR_MSG_RESIZE_FILE = "Unable to resize checkpoint file";
+constexpr auto ERR_MSG_MAP_FILE = "Unable to map checkpoint file";
+constexpr auto ERR_MSG_STATE_SIZE = "Checkpoint state larger than its slot";
+
+// Appends trivially copyable values to a byte buffer that is reused
+// between checkpoints, so steady state encoding doesn't allocate.
+class Encoder final {
+ public:
+  Encoder() = default;
+  Encoder(const Encoder &) = default;
+  Encoder(Encoder &&) = default;
+  ~Encoder() = default;
+
+  void reset() { mBuffer.clear(); }
+  void reserve(const std::size_t size) { mBuffer.reserve(size); }
+  const std::vector<std::uint8_t> &buffer() const { return mBuffer; }
+
+  template <typename T>
+  void put(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Encoder copies with memcpy");
+    auto offset = mBuffer.size();
+    mBuffer.resize(offset + sizeof(T));
+    std::memcpy(mBuffer.data() + offset, &value, sizeof(T));
+  }
+
+ private:
+  std::vector<std::uint8_t> mBuffer;
+};
+
+class Decoder final {
+ public:
+  Decoder() = delete;
+  explicit Decoder(const std::uint8_t *data, const std::size_t size):
+    mData{data}, mSize{size}, mOffset{0} {}
+  Decoder(const Decoder &) = default;
+  Decoder(Decoder &&) = default;
+  ~Decoder() = default;
+
+  // Returns false, leaving value untouched, when the state is too short
+  template <typename T>
+  bool get(T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Decoder copies with memcpy");
+    if (mOffset + sizeof(T) > mSize) {
+      return false;
+    }
+    std::memcpy(&value, mData + mOffset, sizeof(T));
+    mOffset += sizeof(T);
+    return true;
+  }
+
+ private:
+  const std::uint8_t *mData;
+  std::size_t mSize;
+  std::size_t mOffset;
+};
+
+// Memory-mapped file holding two state slots. A checkpoint is written to
+// the slot not holding the latest generation and only then stamped with
+// the next generation number, so a crash at any point leaves at least one
+// complete, checksummed slot behind. Restore picks the newest valid one.
+class CheckpointFile final {
+ public:
+  CheckpointFile() = delete;
+  explicit CheckpointFile(const std::string &, const std::size_t);
+  CheckpointFile(const CheckpointFile &) = delete;
+  CheckpointFile(CheckpointFile &&) = delete;
+  ~CheckpointFile();
+
+  bool restore(std::vector<std::uint8_t> &, std::uint64_t &) const;
+  void write(const std::vector<std::uint8_t> &);
+  std::uint64_t generation() const { return mGeneration; }
+
+ private:
+  void map(const std::size_t);
+  void unmap();
+
+  std::string mPath;
+  std::size_t mSlotSize;
+  int mFd;
+  std::uint8_t *mBase;
+  std::size_t mMappedSize;
+  std::uint64_t mGeneration;
+};
+
+} // namespace checkpoint
+
+#endif //__CHECKPOINT__
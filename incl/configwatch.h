@@ -0,0 +1,53 @@
+#ifndef __CONFIG_WATCH__
+#define __CONFIG_WATCH__
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include "types.h"
+
+namespace configwatch {
+
+constexpr auto ERR_MSG_INOTIFY = "Unable to create inotify instance";
+constexpr auto ERR_MSG_WATCH = "Unable to watch config directory";
+
+// File name within the directory, no path
+using changed_t = std::function<void(const std::string &)>;
+
+// Watches the config directory with inotify and reports every file that
+// was written or renamed into it, once it has been left alone for
+// settle-ms, so an editor saving in several steps triggers one reload.
+// The callback runs on the watcher thread and may take its time (parse,
+// connect to a broker): it is never the streaming thread.
+class ConfigWatcher final {
+ public:
+  ConfigWatcher() = delete;
+  // Directory to watch, throws std::runtime_error
+  explicit ConfigWatcher(const std::string &, const config_watch_info_t &, const changed_t &);
+  ConfigWatcher(const ConfigWatcher &) = delete;
+  ConfigWatcher(ConfigWatcher &&) = delete;
+  // Waits for a callback in progress
+  ~ConfigWatcher();
+
+ private:
+  using steady_clock_t = std::chrono::steady_clock;
+
+  void run();
+  void readEvents();
+
+  std::string mDirectory;
+  config_watch_info_t mInfo;
+  changed_t mChanged;
+  int mInotifyFd;
+  // Changed files and when they were last written
+  std::map<std::string, steady_clock_t::time_point> mPending;
+  std::thread mThread;
+  std::atomic<bool> mEndPolling;
+};
+
+} // namespace configwatch
+
+#endif //__CONFIG_WATCH__
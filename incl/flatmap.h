@@ -0,0 +1,173 @@
+#ifndef __FLAT_MAP__
+#define __FLAT_MAP__
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace flatmap {
+
+// Open addressing map from 64-bit ids, linear probing with backward shift
+// deletion. Slots live in one array sized up front, so inserts and erases
+// never allocate until the map outgrows its capacity. ~0 is reserved as
+// the empty key, it is the tracker's id for untracked objects anyway.
+template <typename Value>
+class FlatMap final {
+ public:
+  using key_type = std::uint64_t;
+  using value_type = std::pair<key_type, Value>;
+  static constexpr key_type EMPTY_KEY = ~static_cast<key_type>(0);
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator(const value_type *slot, const value_type *end): mSlot{slot}, mEnd{end} { skip(); }
+    reference operator*() const { return *mSlot; }
+    pointer operator->() const { return mSlot; }
+    const_iterator &operator++() { ++mSlot; skip(); return *this; }
+    bool operator==(const const_iterator &other) const { return mSlot == other.mSlot; }
+    bool operator!=(const const_iterator &other) const { return mSlot != other.mSlot; }
+   private:
+    void skip() { while (mSlot != mEnd && EMPTY_KEY == mSlot->first) { ++mSlot; } }
+    const value_type *mSlot;
+    const value_type *mEnd;
+  };
+
+  explicit FlatMap(const std::size_t capacity = 1024): mSize{0} { this->rehash(capacity); }
+  FlatMap(const FlatMap &) = default;
+  FlatMap(FlatMap &&) = default;
+  FlatMap &operator=(const FlatMap &) = default;
+  FlatMap &operator=(FlatMap &&) = default;
+  ~FlatMap() = default;
+
+  const Value *find(const key_type key) const {
+    if (EMPTY_KEY == key) {
+      return nullptr;
+    }
+    for (auto idx = this->home(key); ; idx = (idx + 1) & mMask) {
+      if (key == mSlots[idx].first) {
+        return &mSlots[idx].second;
+      }
+      if (EMPTY_KEY == mSlots[idx].first) {
+        return nullptr;
+      }
+    }
+  }
+  Value *find(const key_type key) {
+    return const_cast<Value*>(static_cast<const FlatMap&>(*this).find(key));
+  }
+
+  // Returns false, leaving the map alone, if the key is already present
+  bool insert(const key_type key, const Value &value) {
+    if (EMPTY_KEY == key) {
+      return false;
+    }
+    if ((mSize + 1) * MAX_LOAD_DEN > mSlots.size() * MAX_LOAD_NUM) {
+      this->rehash(mSlots.size() * 2);
+    }
+    auto idx = this->home(key);
+    for (; EMPTY_KEY != mSlots[idx].first; idx = (idx + 1) & mMask) {
+      if (key == mSlots[idx].first) {
+        return false;
+      }
+    }
+    mSlots[idx] = value_type{key, value};
+    ++mSize;
+    return true;
+  }
+
+  bool erase(const key_type key) {
+    if (EMPTY_KEY == key) {
+      return false;
+    }
+    auto idx = this->home(key);
+    for (; key != mSlots[idx].first; idx = (idx + 1) & mMask) {
+      if (EMPTY_KEY == mSlots[idx].first) {
+        return false;
+      }
+    }
+    // Pull back the entries of the probe run that follows so that no
+    // lookup ever stops early at the hole
+    auto hole = idx;
+    for (auto next = (hole + 1) & mMask; EMPTY_KEY != mSlots[next].first; next = (next + 1) & mMask) {
+      auto want = this->home(mSlots[next].first);
+      if (((next - want) & mMask) >= ((next - hole) & mMask)) {
+        mSlots[hole] = mSlots[next];
+        hole = next;
+      }
+    }
+    mSlots[hole].first = EMPTY_KEY;
+    --mSize;
+    return true;
+  }
+
+  void reserve(const std::size_t count) {
+    if (count * MAX_LOAD_DEN > mSlots.size() * MAX_LOAD_NUM) {
+      this->rehash(count * MAX_LOAD_DEN / MAX_LOAD_NUM + 1);
+    }
+  }
+
+  void clear() {
+    for (auto &slot: mSlots) {
+      slot.first = EMPTY_KEY;
+    }
+    mSize = 0;
+  }
+
+  void swap(FlatMap &other) {
+    mSlots.swap(other.mSlots);
+    std::swap(mMask, other.mMask);
+    std::swap(mSize, other.mSize);
+  }
+
+  std::size_t size() const { return mSize; }
+  bool empty() const { return 0 == mSize; }
+  std::size_t capacity() const { return mSlots.size(); }
+  const_iterator begin() const { return const_iterator(mSlots.data(), mSlots.data() + mSlots.size()); }
+  const_iterator end() const {
+    return const_iterator(mSlots.data() + mSlots.size(), mSlots.data() + mSlots.size());
+  }
+
+ private:
+  // Grow past 7/8 full, probe runs get long beyond that
+  static constexpr std::size_t MAX_LOAD_NUM = 7;
+  static constexpr std::size_t MAX_LOAD_DEN = 8;
+
+  std::size_t home(const key_type key) const {
+    // Fibonacci hashing, tracker ids are sequential
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mMask;
+  }
+
+  void rehash(std::size_t capacity) {
+    std::size_t size = 16;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    std::vector<value_type> slots(size, value_type{EMPTY_KEY, Value()});
+    slots.swap(mSlots);
+    mMask = size - 1;
+    mSize = 0;
+    for (const auto &slot: slots) {
+      if (EMPTY_KEY != slot.first) {
+        this->insert(slot.first, slot.second);
+      }
+    }
+  }
+
+  std::vector<value_type> mSlots;
+  std::size_t mMask;
+  std::size_t mSize;
+};
+
+template <typename Value>
+constexpr typename FlatMap<Value>::key_type FlatMap<Value>::EMPTY_KEY;
+
+} // namespace flatmap
+
+#endif //__FLAT_MAP__
@@ -0,0 +1,15 @@
+#ifndef __GATE_NAMES__
+#define __GATE_NAMES__
+
+#include <cstddef>
+
+namespace gates {
+
+// The gates of the roundabout, in the order of the rows and columns of the
+// crossings matrix. Kept free of GLib so the offline tools share it.
+constexpr std::size_t COUNT = 5;
+constexpr const char *NAMES[COUNT] = {"N", "NE", "SE", "SV", "NV"};
+
+} // namespace gates
+
+#endif //__GATE_NAMES__
@@ -0,0 +1,56 @@
+#ifndef __GATES__
+#define __GATES__
+
+#include <glib.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace gates {
+
+constexpr auto ERR_MSG_LOAD = "Unable to load analytics config";
+constexpr auto ERR_MSG_LINE = "Line crossing needs 4 points (direction, then line)";
+constexpr auto ERR_MSG_NO_LINES = "No line crossing of a gate (N, NE, SE, SV, NV) enabled for any stream";
+
+// Name of a gate index, "" when out of range
+const char *name(const std::size_t);
+// Gate index of a name, N when unknown
+std::size_t index(const char *, const std::size_t);
+
+// The line crossings of config_nvdsanalytics.txt by stream, each mapped
+// to the gate its label starts with ("N-Entry" is gate N). Lines of no
+// gate are left to nvdsanalytics and ignored by the probe. Never changes
+// once built: a reload builds a new registry off the streaming thread and
+// swaps it in, see metadata::setGates.
+class GateRegistry final {
+ public:
+  GateRegistry() = delete;
+  // Throws std::invalid_argument
+  explicit GateRegistry(const std::string &);
+  // The first streams that have no group of their own take the lines of
+  // stream 0, for load tests of one intersection seen many times
+  explicit GateRegistry(const std::string &, const guint);
+  GateRegistry(const GateRegistry &) = default;
+  GateRegistry(GateRegistry &&) = default;
+  ~GateRegistry() = default;
+
+  // Gate of a crossing reported by nvdsanalytics, N when the label is not
+  // a line of the stream
+  std::size_t gate(const guint, const std::string &) const;
+  std::size_t lines() const { return mLineCount; }
+
+ private:
+  struct Line {
+    std::string mLabel;
+    std::size_t mGate;
+  };
+
+  // Indexed by source id
+  std::vector<std::vector<Line>> mStreams;
+  std::size_t mLineCount;
+};
+
+} // namespace gates
+
+#endif //__GATES__
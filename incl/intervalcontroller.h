@@ -0,0 +1,57 @@
+#ifndef __INTERVAL_CONTROLLER__
+#define __INTERVAL_CONTROLLER__
+
+#include <cstdint>
+#include "types.h"
+
+namespace intervalcontrol {
+
+constexpr auto ERR_MSG_INTERVAL_BOUNDS = "Interval bounds must satisfy min <= quiet <= max";
+constexpr auto ERR_MSG_LOAD_BOUNDS = "Low load thresholds must be below the high ones";
+
+// Decides the nvinfer interval from periodic load samples. Knows nothing
+// about GStreamer so it can be driven by a simulated load as well.
+//
+// Two inputs are combined: a load interval that steps up while the queues
+// or the latency stay above their high marks and steps back down while
+// both stay below their low marks, and a quiet flag raised when the scene
+// has been empty for a while. The effective interval is the load interval,
+// or at least the quiet interval while quiet. Objects showing up clear the
+// quiet flag on the very next sample so new vehicles get detected. A step
+// down that has to be taken back soon after doubles the wait before the
+// next one, so a load right at the edge settles instead of oscillating.
+class IntervalController final {
+ public:
+  IntervalController() = delete;
+  explicit IntervalController(const interval_control_info_t &);
+  IntervalController(const IntervalController &) = default;
+  IntervalController(IntervalController &&) = default;
+  ~IntervalController() = default;
+
+  // Returns true when the interval changed
+  bool update(const load_sample_t &);
+  std::uint32_t interval() const { return mInterval; }
+  const load_sample_t &smoothed() const { return mSmoothed; }
+  const char *reason() const { return mReason; }
+
+ private:
+  std::uint32_t stepLoad(const bool, const bool);
+
+  interval_control_info_t mInfo;
+  load_sample_t mSmoothed;
+  bool mStarted;
+  std::uint32_t mLoadInterval;
+  std::uint32_t mInterval;
+  std::uint32_t mUpStreak;
+  std::uint32_t mDownStreak;
+  std::uint32_t mQuietStreak;
+  std::uint32_t mCooldown;
+  std::uint32_t mDownHold;    // relaxed samples needed to step down
+  std::uint32_t mProbation;   // samples left to judge the last step down
+  bool mQuiet;
+  const char *mReason;
+};
+
+} // namespace intervalcontrol
+
+#endif //__INTERVAL_CONTROLLER__
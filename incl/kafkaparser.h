@@ -6,6 +6,8 @@
 
 namespace kafkaparser {
 
+constexpr auto KAFKA_CONFIG_FILE = "cfg/kafka_config.txt";
+
 bool setKafkaProperties (kafkaproducer::kafka_info_t&);
 
 } // namespace kafkaparser
@@ -18,6 +18,9 @@ constexpr auto ERR_MSG_INITIALIZE_CONFIG = "Unable to initialize config object";
 constexpr auto ERR_MSG_SET_ENDPOINT = "Unable to set broker endpoint";
 constexpr auto ERR_MSG_SET_CALLBACK = "Unable to set callback";
 constexpr auto ERR_MSG_INITIALIZE_PRODUCER = "Unable to initialize kafka producer";
+constexpr auto ERR_MSG_TOPIC_HANDLE = "Unable to create topic handle";
+
+constexpr auto FLUSH_TIMEOUT_MS = 5000;
 
 constexpr auto ERR_SUCCESS = 0;
 constexpr auto ERR_TOPIC_ALREADY_EXISTS = 1;
@@ -35,6 +38,8 @@ class KafkaProducer final {
   ~KafkaProducer();
 
   bool produce(const std::string &) const;
+  // Copies the payload, it may be reused as soon as this returns
+  bool produce(const char *, const std::size_t) const;
 
  private:
   void createTopic(const std::string &, const topiccb_t &) const;
@@ -42,6 +47,8 @@ class KafkaProducer final {
   std::unique_ptr<RdKafka::Producer> mProducer;
   std::string mEndpoint;
   std::string mTopic;
+  // Kept so that producing does not copy the topic name every message
+  std::unique_ptr<RdKafka::Topic> mTopicHandle;
 
   class EventCb : public RdKafka::EventCb {
    public:
@@ -50,7 +57,8 @@ class KafkaProducer final {
     EventCb(const EventCb &) = default;
     EventCb(EventCb &&) = default;
     ~EventCb() = default;
-    inline void event_cb(RdKafka::Event &event) { mKafkaCb(event); }
+    // Poll thread, counts the errors then hands the event on
+    void event_cb(RdKafka::Event &event) override;
    private:
     kafkacb_t mKafkaCb;
   } mEventCb;
@@ -0,0 +1,184 @@
+#ifndef __LOGGER__
+#define __LOGGER__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "types.h"
+
+#define VT_LOG_LEVEL_TRACE 0
+#define VT_LOG_LEVEL_DEBUG 1
+#define VT_LOG_LEVEL_INFO 2
+#define VT_LOG_LEVEL_WARN 3
+#define VT_LOG_LEVEL_ERROR 4
+
+// Records below VT_LOG_LEVEL are compiled out, see LOG_LEVEL in the Makefile
+#ifndef VT_LOG_LEVEL
+#define VT_LOG_LEVEL VT_LOG_LEVEL_DEBUG
+#endif
+
+#define VT_LOG(level, format, ...) \
+  do { \
+    if (level >= VT_LOG_LEVEL) { \
+      static ::logger::Site site_{__FILE__, __LINE__, static_cast<::logger::Level>(level), format}; \
+      ::logger::log(site_, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+// Format strings use {} for every argument and must be string literals:
+// only a pointer to them is stored, formatting happens on the logger thread.
+#define LOG_TRACE(format, ...) VT_LOG(VT_LOG_LEVEL_TRACE, format, ##__VA_ARGS__)
+#define LOG_DEBUG(format, ...) VT_LOG(VT_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) VT_LOG(VT_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) VT_LOG(VT_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) VT_LOG(VT_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+
+namespace logger {
+
+constexpr std::size_t MAX_ARGS = 8;
+constexpr std::size_t MAX_TEXT = 160;
+
+// One per log statement, constant-initialized, also holds the state of
+// the per-site rate limiter.
+struct Site {
+  constexpr Site(const char *file, const int line, const Level level, const char *format):
+    mFile{file}, mLine{line}, mLevel{level}, mFormat{format},
+    mWindow{0}, mCount{0}, mSuppressed{0} {}
+  const char *mFile;
+  const int mLine;
+  const Level mLevel;
+  const char *mFormat;
+  std::atomic<std::int64_t> mWindow;
+  std::atomic<std::uint32_t> mCount;
+  std::atomic<std::uint32_t> mSuppressed;
+};
+
+enum class ArgType : std::uint8_t { INT, UINT, DOUBLE, BOOL, TEXT };
+
+struct TextRef {
+  std::uint16_t mOffset;
+  std::uint16_t mLength;
+};
+
+union Arg {
+  std::int64_t mInt;
+  std::uint64_t mUint;
+  double mDouble;
+  TextRef mText;
+};
+
+// Binary log record: arguments are stored raw, strings are copied inline
+// (truncated to what fits) and nothing is formatted on the caller's thread.
+struct Record {
+  std::int64_t mTime;  // nanoseconds since epoch
+  const Site *mSite;
+  std::uint32_t mSuppressed;
+  std::uint8_t mCount;
+  std::uint16_t mTextUsed;
+  ArgType mTypes[MAX_ARGS];
+  Arg mArgs[MAX_ARGS];
+  char mText[MAX_TEXT];
+};
+
+void start(const log_info_t &);
+void stop();
+
+// Runs the logger thread for its lifetime, meant to outlive everything
+// that logs in main()
+class Logger final {
+ public:
+  Logger() = delete;
+  explicit Logger(const log_info_t &logInfo) { start(logInfo); }
+  Logger(const Logger &) = delete;
+  Logger(Logger &&) = delete;
+  ~Logger() { stop(); }
+};
+
+// Internals used by the macros
+bool enabled(const Level);
+bool admit(Site &, std::uint32_t &);
+Record *acquire(std::uint64_t &);
+void commit(Record *, const std::uint64_t);
+std::int64_t now();
+
+inline void encodeText(Record &record, const char *text, std::size_t length) {
+  auto &arg = record.mArgs[record.mCount];
+  record.mTypes[record.mCount++] = ArgType::TEXT;
+  length = std::min<std::size_t>(length, MAX_TEXT - record.mTextUsed);
+  std::memcpy(record.mText + record.mTextUsed, text, length);
+  arg.mText.mOffset = record.mTextUsed;
+  arg.mText.mLength = static_cast<std::uint16_t>(length);
+  record.mTextUsed += static_cast<std::uint16_t>(length);
+}
+
+inline void encodeArg(Record &record, const bool value) {
+  record.mArgs[record.mCount].mUint = value;
+  record.mTypes[record.mCount++] = ArgType::BOOL;
+}
+
+inline void encodeArg(Record &record, const char *value) {
+  encodeText(record, value ? value : "(null)", value ? std::strlen(value) : 6);
+}
+
+inline void encodeArg(Record &record, const std::string &value) {
+  encodeText(record, value.data(), value.size());
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+encodeArg(Record &record, const T value) {
+  record.mArgs[record.mCount].mInt = value;
+  record.mTypes[record.mCount++] = ArgType::INT;
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+encodeArg(Record &record, const T value) {
+  record.mArgs[record.mCount].mUint = value;
+  record.mTypes[record.mCount++] = ArgType::UINT;
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+encodeArg(Record &record, const T value) {
+  record.mArgs[record.mCount].mDouble = value;
+  record.mTypes[record.mCount++] = ArgType::DOUBLE;
+}
+
+inline void encodeArgs(Record &) {}
+
+template <typename T, typename... Args>
+void encodeArgs(Record &record, const T &value, const Args &...args) {
+  encodeArg(record, value);
+  encodeArgs(record, args...);
+}
+
+// Never blocks: records over the site's rate limit or that don't fit in
+// the ring are dropped and counted.
+template <typename... Args>
+void log(Site &site, const Args &...args) {
+  static_assert(sizeof...(Args) <= MAX_ARGS, "Too many log arguments");
+  std::uint32_t suppressed = 0;
+  if (!enabled(site.mLevel) || !admit(site, suppressed)) {
+    return;
+  }
+  std::uint64_t position = 0;
+  Record *record = acquire(position);
+  if (nullptr == record) {
+    return;
+  }
+  record->mTime = now();
+  record->mSite = &site;
+  record->mSuppressed = suppressed;
+  record->mCount = 0;
+  record->mTextUsed = 0;
+  encodeArgs(*record, args...);
+  commit(record, position);
+}
+
+} // namespace logger
+
+#endif //__LOGGER__
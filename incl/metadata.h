@@ -3,14 +3,54 @@
 #define __VEHICLE_METADATA__
 
 #include <gst/gst.h>
+#include <memory>
+#include <string>
+#include "gates.h"
 #include "types.h"
 
 namespace metadata {
 
 GstPadProbeReturn nvdsanalyticsSrcPadBufferProbe (GstPad *, GstPadProbeInfo *, gpointer);
+// Sources added to and removed from nvstreammux, same streaming thread
+GstPadProbeReturn nvdsanalyticsSrcPadEventProbe (GstPad *, GstPadProbeInfo *, gpointer);
+// Follows the fps sink's last-message for the on-screen display
+void watchFps(GstElement *);
+// Before the windows and the checkpoint, throws std::invalid_argument
+void setCube(const ::odcube::cube_info_t &);
+void setWindows(const ::odwindows::windows_info_t &);
+void flushWindows();
+void setCheckpoint(const ::checkpoint::checkpoint_info_t &);
+void checkpointNow();
+void setSharedCounters(const ::shmcounters::shared_counters_info_t &);
+void setStitching(const ::stitching::stitching_info_t &);
+void setOccupancy(const ::occupancy::occupancy_info_t &);
+void setArchive(const ::archive::archive_info_t &);
+// Throws std::invalid_argument and std::runtime_error
+void setMetaRing(const ::metaring::meta_ring_info_t &);
+// Swapped in whole, any thread. Each returns what it replaced: a probe
+// may still hold it until the end of its buffer.
+std::shared_ptr<const ::gates::GateRegistry> setGates(std::shared_ptr<const ::gates::GateRegistry>);
+std::shared_ptr<const sink_t> setSink(const sink_t &);
+// Tracker ids start over with the buffer of this PTS, the vehicles inside
+// are dropped when it reaches the probe
+void resetTracksAt(const GstClockTime);
+// Writes the last batch and the footer, after the pipeline has stopped
+void closeArchive();
 void printCrossingsMatrix();
 
-extern meta_producer_t producer;
+// Stats surface, safe to call from any thread
+crossings_t crossingsMatrix();
+std::string crossingsJson();
+std::string windowsJson();
+std::string statsJson();
+std::string cubeJson();
+std::string occupancyJson();
+std::string snapshotJson();
+
+// Latency and object count for the interval controller, queue fill is
+// left to the caller
+::intervalcontrol::load_sample_t loadSample();
+void setInferInterval(const std::uint32_t);
 
 } // namespace metadata
 
@@ -0,0 +1,148 @@
+#ifndef __META_RING__
+#define __META_RING__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace metaring {
+
+constexpr auto ERR_MSG_OPEN_RING = "Unable to open metadata ring";
+constexpr auto ERR_MSG_MAP_RING = "Unable to map metadata ring";
+constexpr auto ERR_MSG_RING_LAYOUT = "Metadata ring has an unknown layout";
+constexpr auto ERR_MSG_SLOTS = "slots must be a power of two";
+
+constexpr std::size_t MAX_OBJECTS = 64;
+constexpr std::size_t MAX_GATE_LEN = 8;
+constexpr std::uint8_t NO_GATE = 0xff;
+
+struct ObjectRecord {
+  std::uint64_t mId;  // tracker id
+  float mLeft;
+  float mTop;
+  float mWidth;
+  float mHeight;
+  std::int16_t mClass;
+  std::uint8_t mGate;  // line crossed in this frame, NO_GATE for none
+  std::uint8_t mReserved[5];
+};
+
+// One frame of one source, as the analytics probe saw it
+struct FrameRecord {
+  std::uint64_t mPts;
+  std::uint64_t mWallClock;  // ns since epoch
+  std::uint32_t mSource;
+  std::uint32_t mFrame;
+  std::uint32_t mObjects;    // filled in mObject
+  std::uint32_t mTruncated;  // objects past MAX_OBJECTS, not in the record
+  ObjectRecord mObject[MAX_OBJECTS];
+};
+
+// Sequence 2s - 1 while record s is written, 2s once it is complete
+struct alignas(64) Slot {
+  std::atomic<std::uint64_t> mSeq;
+  FrameRecord mFrame;
+};
+
+struct RingHeader {
+  std::atomic<std::uint64_t> mMagic;  // stamped last by the writer
+  std::uint32_t mVersion;
+  std::uint32_t mSlots;
+  std::uint32_t mMaxObjects;
+  std::int32_t mWriterPid;
+  std::uint32_t mGates;
+  char mGateNames[N][MAX_GATE_LEN];
+  alignas(64) std::atomic<std::uint64_t> mHead;  // last record published, 0 before the first
+};
+
+// Single producer ring of frame records in POSIX shared memory. The
+// analytics probe fills the next slot in place and publishes it with a
+// sequence number, it never waits for a reader. Readers map the ring
+// read-only, each with its own position, and read records in place: a
+// reader that falls a lap behind sees the sequence move and skips what
+// was overwritten, counting it as lost.
+//
+// Every writer starts a new ring under the name. The old one stays
+// mapped by its readers until they notice, see RingReader::replaced.
+class RingWriter final {
+ public:
+  RingWriter() = delete;
+  // Throws std::invalid_argument and std::runtime_error
+  explicit RingWriter(const meta_ring_info_t &, const std::vector<std::string> &);
+  RingWriter(const RingWriter &) = delete;
+  RingWriter(RingWriter &&) = delete;
+  // Leaves the ring for the readers to drain
+  ~RingWriter();
+
+  // Streaming thread. The next record to fill, readers see it once published.
+  inline FrameRecord &claim() {
+    auto &slot = mSlots[(mNext - 1) & mMask];
+    slot.mSeq.store(2 * mNext - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot.mFrame;
+  }
+
+  inline void publish() {
+    mSlots[(mNext - 1) & mMask].mSeq.store(2 * mNext, std::memory_order_release);
+    mHeader->mHead.store(mNext, std::memory_order_release);
+    ++mNext;
+  }
+
+  std::uint64_t published() const { return mNext - 1; }
+
+ private:
+  std::string mName;
+  int mFd;
+  std::size_t mSize;
+  RingHeader *mHeader;
+  Slot *mSlots;
+  std::uint64_t mMask;
+  std::uint64_t mNext;
+};
+
+class RingReader final {
+ public:
+  RingReader() = delete;
+  // Starts with the next record published, or with the oldest one still
+  // in the ring. Throws std::runtime_error.
+  explicit RingReader(const std::string &, const bool);
+  RingReader(const RingReader &) = delete;
+  RingReader(RingReader &&) = delete;
+  ~RingReader();
+
+  // The next record in place, nullptr when caught up. Only good until
+  // release(), which tells whether the writer overwrote it meanwhile.
+  const FrameRecord *next();
+  // False when the record has to be thrown away, it counts as lost then
+  bool release();
+
+  const RingHeader &header() const { return *mHeader; }
+  // Records overwritten before they were read
+  std::uint64_t lost() const { return mLost; }
+  std::uint64_t read() const { return mRead; }
+  // Sequence of the record handed out by next()
+  std::uint64_t sequence() const { return mCurrent; }
+  bool writerAlive() const;
+  // A new writer started a ring under the same name
+  bool replaced() const;
+
+ private:
+  void waitReady() const;
+
+  std::string mName;
+  int mFd;
+  std::size_t mSize;
+  const RingHeader *mHeader;
+  const Slot *mSlots;
+  std::uint64_t mMask;
+  std::uint64_t mNext;
+  std::uint64_t mCurrent;  // sequence of the record handed out by next()
+  std::uint64_t mLost;
+  std::uint64_t mRead;
+};
+
+} // namespace metaring
+
+#endif //__META_RING__
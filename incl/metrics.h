@@ -0,0 +1,118 @@
+#ifndef __METRICS__
+#define __METRICS__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace metrics {
+
+constexpr auto ERR_MSG_TYPE = "Metric already registered with another type";
+constexpr auto ERR_MSG_BUCKETS = "Histogram buckets must be ascending, at most";
+
+// Prometheus text exposition format
+constexpr auto CONTENT_TYPE = "text/plain; version=0.0.4";
+
+constexpr std::size_t SHARDS = 16;
+constexpr std::size_t MAX_BUCKETS = 16;
+constexpr std::size_t CACHE_LINE = 64;
+
+// Spreads the threads over the shards, first come first served
+std::size_t takeShard();
+// Shard of the calling thread, fixed on its first update
+inline std::size_t shard() {
+  thread_local const std::size_t index = takeShard();
+  return index;
+}
+
+// Updates are a relaxed add on the calling thread's own cache line, the
+// shards are only summed when scraped
+class Counter final {
+ public:
+  Counter() = default;
+  Counter(const Counter &) = delete;
+  Counter(Counter &&) = delete;
+  ~Counter() = default;
+
+  void inc(const std::uint64_t by = 1) {
+    mShards[shard()].mValue.fetch_add(by, std::memory_order_relaxed);
+  }
+  std::uint64_t value() const;
+
+ private:
+  // Padded rather than aligned, over-aligned new is C++17
+  struct Shard {
+    std::atomic<std::uint64_t> mValue{0};
+    char mPadding[CACHE_LINE - sizeof(std::atomic<std::uint64_t>)];
+  };
+  std::array<Shard, SHARDS> mShards;
+};
+
+// Last value set, by whichever thread
+class Gauge final {
+ public:
+  Gauge() = default;
+  Gauge(const Gauge &) = delete;
+  Gauge(Gauge &&) = delete;
+  ~Gauge() = default;
+
+  void set(const double value) { mValue.store(value, std::memory_order_relaxed); }
+  double value() const { return mValue.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> mValue{0.0};
+};
+
+class Histogram final {
+ public:
+  struct Totals {
+    // Not cumulative, the one past the bounds is +Inf
+    std::array<std::uint64_t, MAX_BUCKETS + 1> mCounts;
+    std::uint64_t mCount;
+    double mSum;
+  };
+
+  Histogram() = delete;
+  // Upper bounds, ascending, throws std::invalid_argument
+  explicit Histogram(const std::vector<double> &);
+  Histogram(const Histogram &) = delete;
+  Histogram(Histogram &&) = delete;
+  ~Histogram() = default;
+
+  void observe(const double);
+  const std::vector<double> &bounds() const { return mBounds; }
+  Totals totals() const;
+
+ private:
+  struct Shard {
+    std::array<std::atomic<std::uint64_t>, MAX_BUCKETS + 1> mCounts{};
+    // A shard is seldom shared, the loop almost never goes round twice
+    std::atomic<double> mSum{0.0};
+    char mPadding[CACHE_LINE];
+  };
+
+  std::vector<double> mBounds;
+  std::array<Shard, SHARDS> mShards;
+};
+
+// Registered once per name and labels, the same metric comes back when
+// asked again. Registration takes a lock, updates never do. Metrics live
+// as long as the process. Labels are Prometheus label pairs without the
+// braces, e.g. type="eos". Throws std::invalid_argument.
+Counter &counter(const std::string &, const std::string &, const std::string & = "");
+Gauge &gauge(const std::string &, const std::string &, const std::string & = "");
+Histogram &histogram(const std::string &, const std::string &, const std::vector<double> &,
+  const std::string & = "");
+
+// Every metric in the text exposition format, any thread
+std::string prometheusText();
+// For node_exporter's textfile collector: written next to the file and
+// renamed over it, a scrape never sees half of it
+bool writeTextfile(const std::string &);
+
+} // namespace metrics
+
+#endif //__METRICS__
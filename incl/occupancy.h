@@ -0,0 +1,108 @@
+#ifndef __ROI_OCCUPANCY__
+#define __ROI_OCCUPANCY__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "types.h"
+
+namespace occupancy {
+
+constexpr auto ERR_MSG_RAW = "Occupancy raw-seconds and max-fps must be positive";
+constexpr auto ERR_MSG_BUCKETS = "Occupancy minutes and hours must be positive";
+
+inline void clear(bucket_t &bucket, const std::uint64_t start = 0) {
+  bucket = bucket_t{start, 0, ~static_cast<std::uint32_t>(0), 0, 0};
+}
+
+inline void add(bucket_t &bucket, const std::uint32_t vehicles) {
+  bucket.mSum += vehicles;
+  bucket.mMin = vehicles < bucket.mMin ? vehicles : bucket.mMin;
+  bucket.mMax = vehicles > bucket.mMax ? vehicles : bucket.mMax;
+  ++bucket.mSamples;
+}
+
+inline void merge(bucket_t &into, const bucket_t &from) {
+  into.mSum += from.mSum;
+  into.mMin = from.mMin < into.mMin ? from.mMin : into.mMin;
+  into.mMax = from.mMax > into.mMax ? from.mMax : into.mMax;
+  into.mSamples += from.mSamples;
+}
+
+inline double mean(const bucket_t &bucket) {
+  return bucket.mSamples ? static_cast<double>(bucket.mSum) / bucket.mSamples : 0.0;
+}
+
+// {"min":..,"max":..,"mean":..}, zeros when empty
+void bucketToJson(std::ostream &, const bucket_t &);
+
+// Vehicles in every ROI of nvdsanalytics, per frame, at three resolutions:
+// each frame for the last raw-seconds, then min/max/mean per minute and
+// per hour, the hour buckets merged from the closed minute ones. All of it
+// lives in rings sized up front for MAX_ROIS, so memory stays the same
+// however long the pipeline runs and recording never allocates. ROIs past
+// MAX_ROIS are not recorded.
+//
+// Recorded from the streaming thread, read by the stats server. The ROIs
+// and every series are published like a seqlock.h value: the writer never
+// waits, a reader copies them out and copies again when a sample came in
+// meanwhile, then formats its copy.
+class OccupancyRecorder final {
+ public:
+  OccupancyRecorder() = delete;
+  explicit OccupancyRecorder(const occupancy_info_t &);
+  OccupancyRecorder(const OccupancyRecorder &) = delete;
+  OccupancyRecorder(OccupancyRecorder &&) = delete;
+  ~OccupancyRecorder() = default;
+
+  // Index of the ROI of a stream, registered on first sight. MAX_ROIS once
+  // they are all taken.
+  std::size_t roi(const std::uint32_t, const char *);
+  // Stream time, nanoseconds
+  void record(const std::uint64_t, const std::size_t, const std::uint32_t);
+  // Streaming thread only
+  const rois_t &rois() const { return mRois; }
+
+  void toJson(std::ostream &) const;
+
+ private:
+  struct Sample {
+    std::uint64_t mTime;
+    std::uint32_t mVehicles;
+  };
+
+  // Closed buckets of one width, oldest first from mHead, and the one
+  // still filling
+  struct Tier {
+    std::uint64_t mWidth;  // nanoseconds
+    std::vector<bucket_t> mRing;
+    std::size_t mHead;
+    std::size_t mSize;
+    bucket_t mOpen;
+  };
+
+  struct Series {
+    std::vector<Sample> mRaw;
+    std::size_t mRawHead;
+    std::size_t mRawSize;
+    Tier mMinutes;
+    Tier mHours;
+  };
+
+  static void push(Tier &, const bucket_t &);
+  static bool roll(Tier &, const std::uint64_t, bucket_t &);
+  static void tierToJson(std::ostream &, const Tier &);
+
+  occupancy_info_t mInfo;
+  rois_t mRois;
+  std::vector<Series> mSeries;
+  // Odd while the streaming thread writes the ROIs or a series
+  std::atomic<std::uint64_t> mRoisSeq{0};
+  std::array<std::atomic<std::uint64_t>, MAX_ROIS> mSeriesSeq{};
+};
+
+} // namespace occupancy
+
+#endif //__ROI_OCCUPANCY__
@@ -0,0 +1,76 @@
+#ifndef __OD_CUBE__
+#define __OD_CUBE__
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "types.h"
+
+namespace odcube {
+
+constexpr auto ERR_MSG_STREAMS = "Cube streams out of range";
+constexpr auto ERR_MSG_CLASSES = "Too many cube classes, one is kept for the others";
+
+// Selections are bit masks over streams and classes
+constexpr std::uint32_t ALL = ~static_cast<std::uint32_t>(0);
+
+struct GateTotals {
+  std::array<std::uint64_t, N> mEntries;
+  std::array<std::uint64_t, N> mExits;
+};
+using gate_totals_t = struct GateTotals;
+
+// Throws std::invalid_argument unless the dimensions fit the cube
+void validate(const cube_info_t &);
+// Stream and class of a detection, folded into the last stream and the
+// "other" class when out of range
+std::size_t streamIndex(const cube_info_t &, const std::uint32_t);
+std::size_t classIndex(const cube_info_t &, const int);
+
+inline void count(cube_t &cube, const std::size_t stream, const std::size_t cls,
+  const std::size_t entry, const std::size_t exit) {
+  cube.mCounts[stream][cls][entry * N + exit] += 1;
+}
+
+// Reductions run over 128-bit lanes (SSE2 on x86-64, NEON on aarch64),
+// eight vectors per block
+void clear(cube_t &);
+void accumulate(cube_t &, const cube_t &);
+bool empty(const cube_t &);
+odwindows::matrix_t reduce(const cube_t &, const std::uint32_t streams = ALL,
+  const std::uint32_t classes = ALL);
+std::uint64_t total(const cube_t &, const std::uint32_t streams = ALL,
+  const std::uint32_t classes = ALL);
+std::array<std::uint64_t, MAX_CLASSES> classTotals(const cube_t &);
+std::array<std::uint64_t, MAX_STREAMS> streamTotals(const cube_t &);
+gate_totals_t gateTotals(const odwindows::matrix_t &);
+
+// Heap storage for cubes keeping their cache line alignment, which plain
+// operator new does not guarantee before C++17
+template <typename T>
+struct CacheAlignedAllocator {
+  using value_type = T;
+  CacheAlignedAllocator() = default;
+  template <typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+  T *allocate(const std::size_t count) {
+    void *block = nullptr;
+    if (0 != posix_memalign(&block, alignof(T) < 64 ? 64 : alignof(T), count * sizeof(T))) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(block);
+  }
+  void deallocate(T *block, const std::size_t) {
+    std::free(block);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const CacheAlignedAllocator<T> &, const CacheAlignedAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const CacheAlignedAllocator<T> &, const CacheAlignedAllocator<U> &) { return false; }
+
+} // namespace odcube
+
+#endif //__OD_CUBE__
@@ -0,0 +1,90 @@
+#ifndef __OD_WINDOWS__
+#define __OD_WINDOWS__
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include "checkpoint.h"
+#include "occupancy.h"
+#include "odcube.h"
+#include "types.h"
+
+namespace odwindows {
+
+constexpr auto ERR_MSG_WINDOW_LENGTH = "Window length must be a positive multiple of its hop";
+
+using windowcb_t = std::function<void(const window_aggregate_t &)>;
+
+// A window of `length` seconds that advances by `hop` seconds. The window
+// is kept as a ring of length/hop pre-sized slot cubes, one per hop, so
+// closing a window is a block copy and a vector sum over the ring and
+// rolling forward only clears the slot being reused. Tumbling windows are
+// the special case hop == length. ROI occupancy is kept alongside, one
+// bucket per ROI and slot; it is not checkpointed, so a window that spans
+// a restart only has occupancy from after it.
+class WindowRing final {
+ public:
+  WindowRing() = delete;
+  explicit WindowRing(const std::uint32_t, const std::uint32_t);
+  WindowRing(const WindowRing &) = default;
+  WindowRing(WindowRing &&) = default;
+  ~WindowRing() = default;
+
+  // Callers advance() to pts before add() so the slot written is current.
+  // Stream, class, entry and exit, see odcube::count
+  void add(const std::uint64_t, const std::size_t, const std::size_t, const std::size_t,
+    const std::size_t);
+  // ROI index and vehicles in it, see occupancy::OccupancyRecorder
+  void addOccupancy(const std::uint64_t, const std::size_t, const std::uint32_t);
+  void advance(const std::uint64_t, const windowcb_t &);
+  void flush(const windowcb_t &);
+  void save(::checkpoint::Encoder &) const;
+  bool restore(::checkpoint::Decoder &);
+  std::size_t stateSize() const;
+
+ private:
+  void close(const bool, const windowcb_t &);
+  void clearSlot(const std::size_t);
+  bool empty() const;
+
+  std::uint64_t mLength;
+  std::uint64_t mHop;
+  std::vector<::odcube::cube_t, ::odcube::CacheAlignedAllocator<::odcube::cube_t>> mSlots;
+  std::vector<::occupancy::buckets_t> mOccupancy;
+  std::size_t mCurrent;
+  std::uint64_t mFilled;
+  std::uint64_t mOrigin;
+  std::uint64_t mSlotStart;
+  std::uint64_t mLastPts;
+  bool mStarted;
+};
+
+class WindowAggregator final {
+ public:
+  WindowAggregator() = default;
+  WindowAggregator(const WindowAggregator &) = default;
+  WindowAggregator(WindowAggregator &&) = default;
+  ~WindowAggregator() = default;
+
+  void configure(const windows_info_t &, const windowcb_t &);
+  void add(const std::uint64_t, const std::size_t, const std::size_t, const std::size_t,
+    const std::size_t);
+  void addOccupancy(const std::uint64_t, const std::size_t, const std::uint32_t);
+  void advance(const std::uint64_t);
+  void flush();
+  bool enabled() const { return !mRings.empty(); }
+
+  // Window state for checkpoints. Restore only succeeds against the same
+  // window configuration and leaves the windows untouched otherwise.
+  void save(::checkpoint::Encoder &) const;
+  bool restore(::checkpoint::Decoder &);
+  std::size_t stateSize() const;
+
+ private:
+  std::vector<WindowRing> mRings;
+  windowcb_t mWindowCb;
+};
+
+} // namespace odwindows
+
+#endif //__OD_WINDOWS__
@@ -0,0 +1,53 @@
+#ifndef __PLACEMENT__
+#define __PLACEMENT__
+
+#include <sched.h>
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace placement {
+
+constexpr auto ERR_MSG_CPU_SPEC = "Invalid cpu spec";
+constexpr auto ERR_MSG_NUMA_NODE = "Unknown NUMA node";
+constexpr auto ERR_MSG_REALTIME_PRIORITY = "Realtime priority out of range";
+
+struct CpuSpec {
+  std::vector<int> mCpus;  // empty leaves the affinity alone
+  int mNode{-1};           // preferred memory node, -1 for none
+};
+using cpu_spec_t = struct CpuSpec;
+
+cpu_spec_t parseCpuSpec(const std::string &);
+
+// Parses every spec up front so that mistakes fail at startup, not when
+// a thread happens to start. Throws std::invalid_argument.
+void configure(const placement_info_t &);
+bool enabled();
+
+// Called on the thread to place, as it starts
+void placeStreamingThread(const std::string &);
+void placeWorker(const std::string &);
+
+// Pins the calling thread to the kafka spec for its lifetime. Threads
+// started meanwhile inherit the cpus and memory policy, which is the only
+// way to reach the threads librdkafka starts internally.
+class ScopedKafkaPlacement final {
+ public:
+  ScopedKafkaPlacement();
+  ScopedKafkaPlacement(const ScopedKafkaPlacement &) = delete;
+  ScopedKafkaPlacement(ScopedKafkaPlacement &&) = delete;
+  ~ScopedKafkaPlacement();
+ private:
+  bool mActive;
+  cpu_set_t mSaved;
+};
+
+// Host nodes and cpus, and where every placed thread actually runs
+std::string describeHost();
+std::string reportJson();
+
+} // namespace placement
+
+#endif //__PLACEMENT__
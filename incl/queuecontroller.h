@@ -0,0 +1,62 @@
+#ifndef __QUEUE_CONTROLLER__
+#define __QUEUE_CONTROLLER__
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "types.h"
+
+namespace queuecontrol {
+
+constexpr auto ERR_MSG_BUFFER_BOUNDS = "Queue buffer bounds must satisfy 1 <= min <= max";
+constexpr auto ERR_MSG_HEADROOM = "Queue headroom must be at least 1";
+constexpr auto ERR_MSG_LEAKY_QUEUE = "Leaky queue index out of range";
+
+constexpr auto NO_BOTTLENECK = -1;
+
+// Sizes a chain of queues from their sampled levels (buffers queued).
+//
+// A queue that reaches its limit is grown right away, doubling up to the
+// maximum, since a full queue stalls everything upstream. Once at the
+// maximum, queues allowed to leak start dropping their oldest buffers
+// instead. A queue is shrunk only after a whole window of samples without
+// hitting its limit, halfway towards headroom times the peak it saw, so
+// it settles on the smallest limit that absorbs its bursts. A shrink that
+// has to be grown back soon after doubles the history the next one needs,
+// which catches bursts further apart than a window. The queue with the
+// highest mean level feeds the bottleneck stage.
+class QueueController final {
+ public:
+  QueueController() = delete;
+  explicit QueueController(const queue_control_info_t &, const std::size_t);
+  QueueController(const QueueController &) = default;
+  QueueController(QueueController &&) = default;
+  ~QueueController() = default;
+
+  // Levels in queue order, returns the indices whose setting changed
+  std::vector<std::size_t> update(const std::vector<std::uint32_t> &);
+  const queue_setting_t &setting(const std::size_t idx) const { return mQueues[idx].mSetting; }
+  std::uint32_t peak(const std::size_t) const;
+  int bottleneck() const { return mBottleneck; }
+
+ private:
+  struct Queue {
+    queue_setting_t mSetting;
+    bool mLeakAllowed;
+    std::deque<std::uint32_t> mLevels;   // samples since the last change or hit
+    std::uint32_t mRequired;             // samples needed before shrinking
+    std::uint32_t mProbation;            // samples left to judge the last shrink
+    double mMean;                        // moving average of the level
+  };
+
+  bool adjust(Queue &, const std::uint32_t);
+  void restart(Queue &);
+
+  queue_control_info_t mInfo;
+  std::vector<Queue> mQueues;
+  int mBottleneck;
+};
+
+} // namespace queuecontrol
+
+#endif //__QUEUE_CONTROLLER__
@@ -0,0 +1,59 @@
+#ifndef __SEQ_LOCK__
+#define __SEQ_LOCK__
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace seqlock {
+
+// Single writer, many readers. The writer never waits: it bumps the
+// sequence to odd, copies the value and bumps it back to even. Readers copy
+// the value and retry if the sequence was odd or moved under them, so they
+// always get a consistent snapshot and never hold up the writer.
+template <typename T>
+class SeqLock final {
+  static_assert(std::is_trivially_copyable<T>::value,
+    "SeqLock values are copied with memcpy");
+ public:
+  SeqLock() : mSeq{0}, mValue{} {}
+  SeqLock(const SeqLock &) = delete;
+  SeqLock(SeqLock &&) = delete;
+  ~SeqLock() = default;
+
+  void store(const T &value) {
+    auto seq = mSeq.load(std::memory_order_relaxed);
+    mSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&mValue, &value, sizeof(T));
+    mSeq.store(seq + 2, std::memory_order_release);
+  }
+
+  T load() const {
+    T value;
+    for (;;) {
+      auto before = mSeq.load(std::memory_order_acquire);
+      if (before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      std::memcpy(&value, &mValue, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (before == mSeq.load(std::memory_order_relaxed)) {
+        return value;
+      }
+    }
+  }
+
+  std::uint64_t sequence() const { return mSeq.load(std::memory_order_acquire) / 2; }
+
+ private:
+  std::atomic<std::uint64_t> mSeq;
+  T mValue;
+};
+
+} // namespace seqlock
+
+#endif //__SEQ_LOCK__
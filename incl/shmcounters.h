@@ -0,0 +1,82 @@
+#ifndef __SHM_COUNTERS__
+#define __SHM_COUNTERS__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace shmcounters {
+
+constexpr auto ERR_MSG_OPEN_SEGMENT = "Unable to open shared counters segment";
+constexpr auto ERR_MSG_MAP_SEGMENT = "Unable to map shared counters segment";
+constexpr auto ERR_MSG_SEGMENT_LAYOUT = "Shared counters segment has an unknown layout";
+constexpr auto ERR_MSG_NO_FREE_SLOT = "No free slot in shared counters segment";
+
+constexpr std::size_t MAX_PROCESSES = 32;
+constexpr std::size_t MAX_LABEL_LEN = 32;
+constexpr std::size_t MAX_GATE_LEN = 8;
+
+// One slice per process, cache-line aligned so that processes counting at
+// the same time never write to the same line. A slice outlives its
+// process: a restarted pipeline with the same label adopts it and keeps
+// counting on top, and the aggregator keeps reporting it meanwhile. Once
+// no slot is free, the slice of a gone process is reclaimed, counts and
+// all, for a new label.
+struct alignas(64) ProcessSlot {
+  std::atomic<std::int32_t> mPid;          // 0 when never claimed, -pid while being claimed
+  std::atomic<std::uint64_t> mUpdated;     // ns since epoch, last count
+  char mLabel[MAX_LABEL_LEN];
+  std::atomic<std::uint64_t> mCounts[N][N];
+};
+
+struct Segment {
+  std::atomic<std::uint64_t> mMagic;  // stamped last by the creating process
+  std::uint32_t mVersion;
+  std::uint32_t mProcesses;
+  std::uint32_t mGates;
+  char mGateNames[N][MAX_GATE_LEN];
+  alignas(64) ProcessSlot mSlots[MAX_PROCESSES];
+};
+
+using od_totals_t = std::array<std::array<std::uint64_t, N>, N>;
+
+class SharedCounters final {
+ public:
+  SharedCounters() = delete;
+  // Writer: creates the segment if needed and claims a slice for label
+  explicit SharedCounters(const shared_counters_info_t &, const std::vector<std::string> &);
+  // Reader: maps an existing segment read-only
+  explicit SharedCounters(const std::string &);
+  SharedCounters(const SharedCounters &) = delete;
+  SharedCounters(SharedCounters &&) = delete;
+  ~SharedCounters();
+
+  inline void add(const std::size_t entry, const std::size_t exit, const std::uint64_t now) {
+    mSlot->mCounts[entry][exit].fetch_add(1, std::memory_order_relaxed);
+    mSlot->mUpdated.store(now, std::memory_order_relaxed);
+  }
+
+  const Segment &segment() const { return *mSegment; }
+  std::size_t slot() const { return mSlotIdx; }
+  od_totals_t totals() const;
+  static bool alive(const ProcessSlot &);
+
+ private:
+  void map(const bool);
+  void waitReady() const;
+  void claim(const std::string &);
+  // Publishes the slot under this process' pid once label and counts are set
+  void publish(const std::size_t, const std::string &, const bool);
+
+  std::string mName;
+  int mFd;
+  Segment *mSegment;
+  ProcessSlot *mSlot;
+  std::size_t mSlotIdx;
+};
+
+} // namespace shmcounters
+
+#endif //__SHM_COUNTERS__
@@ -0,0 +1,67 @@
+#ifndef __SOURCE_MANAGER__
+#define __SOURCE_MANAGER__
+
+#include <gst/gst.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include "types.h"
+
+namespace sources {
+
+constexpr auto ERR_MSG_ID = "Source id out of range of max-sources";
+constexpr auto ERR_MSG_RUNNING = "Source id already running";
+constexpr auto ERR_MSG_ELEMENT = "Unable to create source element";
+constexpr auto ERR_MSG_PAD = "Unable to get nvstreammux pad";
+constexpr auto ERR_MSG_LINK = "Unable to link source to nvstreammux";
+constexpr auto ERR_MSG_STATE = "Unable to start source";
+
+// Source id and its bin, every time one is added
+using added_t = std::function<void(const std::uint32_t, GstElement *)>;
+
+// Source bins (filesrc, h264parse, nvv4l2decoder) on nvstreammux request
+// pads sink_<id>, added and removed while the pipeline plays. Source 0 is
+// the file of the command line: added by the pipeline before it plays and
+// never removed by update(). nvstreammux tells the elements downstream
+// with its pad-added and pad-deleted events, see metadata.
+// Main loop thread only.
+class SourceManager final {
+ public:
+  SourceManager() = delete;
+  // Pipeline and nvstreammux, both outlive the manager
+  explicit SourceManager(GstElement *, GstElement *, const sources_info_t &, const added_t & = added_t());
+  SourceManager(const SourceManager &) = delete;
+  SourceManager(SourceManager &&) = delete;
+  ~SourceManager() = default;
+
+  // Throws std::runtime_error, nothing of the source is left in the pipeline
+  void add(const std::uint32_t, const std::string &);
+  // Until its last buffer is out of nvstreammux's sink pad
+  void remove(const std::uint32_t);
+  // Adds and removes until the running sources are the list, a source of
+  // another location is started over. Logs the sources it couldn't add.
+  void update(const source_list_t &);
+  // A new bin for the same location, resumed at the key frame before the
+  // last frame of the old one. Throws std::runtime_error, the source is
+  // gone then.
+  void restart(const std::uint32_t);
+  // A flushing seek of every source to its own position, everything
+  // downstream is flushed in stream order
+  void flush();
+  const source_list_t &running() const { return mRunning; }
+  // nullptr when not running
+  GstElement *bin(const std::uint32_t) const;
+
+ private:
+  GstElement *mPipeline;
+  GstElement *mStreammux;
+  sources_info_t mInfo;
+  added_t mAdded;
+  source_list_t mRunning;
+  std::map<std::uint32_t, GstElement*> mBins;
+};
+
+} // namespace sources
+
+#endif //__SOURCE_MANAGER__
@@ -0,0 +1,16 @@
+#ifndef __SOURCE_PARSER__
+#define __SOURCE_PARSER__
+
+#include "types.h"
+
+namespace sourceparser {
+
+constexpr auto SOURCES_CONFIG_FILE = "cfg/sources_config.txt";
+
+// Reads the [source-<id>] groups, ids from 1 to max-sources - 1. No file
+// is no sources besides the command line.
+bool parseSourcesConfig (sources::source_list_t&, const std::uint32_t);
+
+} // namespace sourceparser
+
+#endif //__SOURCE_PARSER__
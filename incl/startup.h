@@ -0,0 +1,30 @@
+#ifndef __STARTUP__
+#define __STARTUP__
+
+#include <cstdint>
+#include <string>
+
+namespace startup {
+
+// In the order a healthy start reaches them
+enum class Phase : std::uint8_t {
+  Config,      // every config file parsed
+  GstInit,
+  Pipeline,    // elements created and linked
+  Kafka,       // producer connected and topic created
+  Playing,
+  FirstFrame,  // first batch through the analytics probe
+  FirstEvent   // first vehicle counted, entry to exit
+};
+constexpr std::size_t PHASES = 7;
+
+// Any thread, only the first mark of a phase counts. Logged and kept in
+// vt_startup_seconds{phase="<name>"}, both from process start.
+void mark(const Phase);
+// Milliseconds from process start, negative until reached
+double elapsedMs(const Phase);
+std::string json();
+
+} // namespace startup
+
+#endif //__STARTUP__
@@ -0,0 +1,62 @@
+#ifndef __STATS_SERVER__
+#define __STATS_SERVER__
+
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include "types.h"
+
+namespace statsserver {
+
+constexpr auto ERR_MSG_CREATE_SOCKET = "Unable to create stats server socket";
+constexpr auto ERR_MSG_BIND_SOCKET = "Unable to bind stats server socket";
+constexpr auto ERR_MSG_LISTEN_SOCKET = "Unable to listen on stats server socket";
+
+using handler_t = std::function<std::string()>;
+
+// Minimal HTTP/1.0 server for GET requests on a loopback or unix socket.
+// Every request is served from a single thread with poll(), so a slow or
+// stalled client can't hold up the others and no handler ever runs on the
+// streaming thread. Handlers are expected to read lock-free snapshots.
+class StatsServer final {
+ public:
+  StatsServer() = delete;
+  explicit StatsServer(const stats_info_t &);
+  StatsServer(const StatsServer &) = delete;
+  StatsServer(StatsServer &&) = delete;
+  ~StatsServer();
+
+  // Routes must be added before start()
+  void addRoute(const std::string &, const std::string &, const handler_t &);
+  void start();
+
+ private:
+  struct Route {
+    std::string mContentType;
+    handler_t mHandler;
+  };
+  struct Client {
+    int mFd;
+    std::int64_t mDeadline;
+    std::string mRequest;
+  };
+
+  int listen();
+  void serve();
+  bool readRequest(Client &);
+  void respond(const Client &);
+
+  stats_info_t mStatsInfo;
+  std::map<std::string, Route> mRoutes;
+  std::vector<Client> mClients;
+  int mListenFd;
+  std::thread mThread;
+  std::atomic<bool> mEndPolling;
+};
+
+} // namespace statsserver
+
+#endif //__STATS_SERVER__
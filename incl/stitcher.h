@@ -0,0 +1,100 @@
+#ifndef __TRACK_STITCHER__
+#define __TRACK_STITCHER__
+
+#include <cstdint>
+#include <vector>
+#include "flatmap.h"
+#include "types.h"
+
+namespace stitching {
+
+constexpr auto ERR_MSG_WINDOW = "Stitching window must be positive";
+constexpr auto ERR_MSG_MAX_DISTANCE = "Stitching max-distance must be positive";
+constexpr auto ERR_MSG_MAX_SPEED = "Stitching max-speed must be positive";
+
+constexpr std::size_t NO_ENTRY = ~static_cast<std::size_t>(0);
+
+struct Stitch {
+  std::uint64_t mLostId;
+  std::size_t mEntry;
+};
+using stitch_t = struct Stitch;
+
+// Carries the entry gate of a vehicle over a tracker id switch.
+//
+// Tracks that were inside the intersection (given an entry gate) and go
+// missing are kept for a short window with their last position and
+// velocity. A new id that shows up within max-distance of where a lost
+// track would be by now, its velocity capped at max-speed, continues the
+// closest one. Lost tracks sit in a uniform grid of max-distance cells,
+// keyed by that predicted position and moved along at every frame, so the
+// 3x3 cells around the new track hold every candidate and few others;
+// lookups stay constant time with hundreds of tracks in view.
+class TrackStitcher final {
+ public:
+  TrackStitcher() = delete;
+  explicit TrackStitcher(const stitching_info_t &);
+  TrackStitcher(const TrackStitcher &) = default;
+  TrackStitcher(TrackStitcher &&) = default;
+  ~TrackStitcher() = default;
+
+  // Stream time of the frame, nanoseconds
+  void beginFrame(const std::uint64_t);
+  // Center of the object's box. True when a new id continues a lost track.
+  bool observe(const std::uint64_t, const double, const double, stitch_t &);
+  void setEntry(const std::uint64_t, const std::size_t);
+  // Tracks not observed since beginFrame are lost, old lost ones dropped
+  void endFrame();
+
+  std::size_t active() const { return mActive.size(); }
+  std::size_t lost() const { return mLostById.size(); }
+  std::uint64_t stitched() const { return mStitched; }
+
+ private:
+  static constexpr std::uint32_t NIL = ~static_cast<std::uint32_t>(0);
+
+  struct Track {
+    std::uint64_t mId;
+    double mX;
+    double mY;
+    double mVx;       // pixels per second
+    double mVy;
+    std::uint64_t mSeen;
+    std::size_t mEntry;
+  };
+
+  struct Lost {
+    Track mTrack;
+    std::uint64_t mCell;   // of the predicted position
+    std::uint32_t mPrev;  // within the cell
+    std::uint32_t mNext;
+  };
+
+  std::uint64_t cellOf(const double, const double) const;
+  void move(Track &, const double, const double);
+  void predict(const Track &, double &, double &) const;
+  bool match(const double, const double, std::uint32_t &) const;
+  void addLost(const Track &);
+  void removeLost(const std::uint32_t);
+  void link(const std::uint32_t, const std::uint64_t);
+  void unlink(const std::uint32_t);
+
+  stitching_info_t mInfo;
+  std::uint64_t mWindow;   // nanoseconds
+  double mCellSize;
+  std::uint64_t mNow;
+
+  std::vector<Track> mActive;
+  ::flatmap::FlatMap<std::uint32_t> mActiveById;
+
+  std::vector<Lost> mLost;              // pool, unused slots chained on mFree
+  std::uint32_t mFree;
+  ::flatmap::FlatMap<std::uint32_t> mLostById;
+  ::flatmap::FlatMap<std::uint32_t> mCells;   // cell -> first lost track
+
+  std::uint64_t mStitched;
+};
+
+} // namespace stitching
+
+#endif //__TRACK_STITCHER__
@@ -3,10 +3,17 @@
 #define __TRACKER_PARSING__
 
 #include <gst/gst.h>
+#include "types.h"
 
 namespace trackerparsing {
 
-bool setTrackerProperties (GstElement *);
+constexpr auto TRACKER_CONFIG_FILE = "cfg/tracker_config.txt";
+
+// Reads cfg/tracker_config.txt, never touches the element
+bool parseTrackerConfig (tracker_info_t &);
+// nvtracker reads them when it starts, before the pipeline plays or
+// while the element is stopped
+void applyTrackerProperties (GstElement *, const tracker_info_t &);
 
 } // namespace trackerparsing
 
@@ -7,8 +7,9 @@
 #include <string>
 #include <map>
 #include <array>
-#include <unordered_map>
+#include <vector>
 #include <memory>
+#include "flatmap.h"
 #include "kafkaproducer.h"
 
 namespace {
@@ -28,10 +29,365 @@ struct KafkaInfo {
   ~KafkaInfo() = default;
   std::string mEndpoint;
   std::string mTopic;
+  bool mPerEvent{true};
 };
 using kafka_info_t = struct KafkaInfo;
 } // namespace kafkaproducer
 
+namespace odcube {
+
+constexpr std::size_t MAX_STREAMS = 4;
+constexpr std::size_t MAX_CLASSES = 4;
+// One entry x exit matrix, row major, padded to whole cache lines
+constexpr std::size_t BLOCK = 32;
+static_assert(N * N <= BLOCK, "O/D matrix must fit a cube block");
+
+// Crossings by stream, class, entry and exit in one dense, cache aligned
+// block of memory, see odcube.h for the reductions over it
+struct alignas(64) Cube {
+  std::array<std::array<std::array<std::uint32_t, BLOCK>, MAX_CLASSES>, MAX_STREAMS> mCounts;
+};
+using cube_t = struct Cube;
+
+struct CubeInfo {
+  CubeInfo() = default;
+  CubeInfo(const CubeInfo &) = default;
+  CubeInfo(CubeInfo &&) = default;
+  ~CubeInfo() = default;
+  std::uint32_t mStreams{1};  // source ids past the last stream count in it
+  std::vector<std::string> mClasses{"bus", "car"};  // by class_id, the rest is "other"
+};
+using cube_info_t = struct CubeInfo;
+} // namespace odcube
+
+namespace occupancy {
+
+constexpr std::size_t MAX_ROIS = 8;
+constexpr std::size_t MAX_ROI_NAME = 32;
+
+// Vehicles in one ROI over a stretch of stream time, empty while mSamples
+// is 0. See occupancy.h for the helpers.
+struct Bucket {
+  std::uint64_t mStart;     // stream time, nanoseconds
+  std::uint64_t mSum;
+  std::uint32_t mMin;
+  std::uint32_t mMax;
+  std::uint32_t mSamples;
+};
+using bucket_t = struct Bucket;
+using buckets_t = std::array<bucket_t, MAX_ROIS>;
+
+struct Roi {
+  std::uint32_t mStream;
+  std::uint32_t mVehicles;  // last frame
+  char mName[MAX_ROI_NAME];
+};
+using roi_t = struct Roi;
+
+// ROIs in the order they were first seen, indexes into buckets_t
+struct Rois {
+  std::array<roi_t, MAX_ROIS> mRoi;
+  std::uint32_t mCount;
+};
+using rois_t = struct Rois;
+
+struct OccupancyInfo {
+  OccupancyInfo() = default;
+  OccupancyInfo(const OccupancyInfo &) = default;
+  OccupancyInfo(OccupancyInfo &&) = default;
+  ~OccupancyInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mRawSeconds{60};  // every frame's count is kept this long
+  std::uint32_t mMaxFps{30};      // per stream, sizes the raw ring
+  std::uint32_t mMinutes{1440};   // one minute buckets kept, a day
+  std::uint32_t mHours{720};      // one hour buckets kept, 30 days
+};
+using occupancy_info_t = struct OccupancyInfo;
+} // namespace occupancy
+
+namespace odwindows {
+
+using matrix_t = std::array<std::array<std::uint32_t, N>, N>;
+
+struct WindowsInfo {
+  WindowsInfo() = default;
+  WindowsInfo(const WindowsInfo &) = default;
+  WindowsInfo(WindowsInfo &&) = default;
+  ~WindowsInfo() = default;
+  std::vector<std::uint32_t> mTumbling;   // window lengths, seconds
+  std::vector<std::uint32_t> mSliding;    // window lengths, seconds
+  std::uint32_t mSlidingHop{60};          // seconds
+};
+using windows_info_t = struct WindowsInfo;
+
+struct WindowAggregate {
+  std::uint32_t mLength;  // seconds
+  bool mSliding;
+  bool mPartial;
+  std::uint64_t mStart;   // PTS, nanoseconds
+  std::uint64_t mEnd;     // PTS, nanoseconds
+  std::uint32_t mTotal;
+  matrix_t mMatrix;             // every stream and class
+  ::odcube::cube_t mCube;
+  ::occupancy::buckets_t mOccupancy;  // by ROI, see metadata::Snapshot::mRois
+};
+using window_aggregate_t = struct WindowAggregate;
+} // namespace odwindows
+
+namespace logger {
+
+enum class Level : std::uint8_t { Trace, Debug, Info, Warn, Error };
+
+struct LogInfo {
+  LogInfo() = default;
+  LogInfo(const LogInfo &) = default;
+  LogInfo(LogInfo &&) = default;
+  ~LogInfo() = default;
+  Level mLevel{Level::Info};
+  std::uint32_t mRateLimit{20};  // records per second per log statement, 0 = unlimited
+};
+using log_info_t = struct LogInfo;
+} // namespace logger
+
+namespace checkpoint {
+
+struct CheckpointInfo {
+  CheckpointInfo() = default;
+  CheckpointInfo(const CheckpointInfo &) = default;
+  CheckpointInfo(CheckpointInfo &&) = default;
+  ~CheckpointInfo() = default;
+  bool mEnable{false};
+  std::string mPath{"/var/tmp/vehicle-tracking.ckpt"};
+  std::uint32_t mInterval{5};       // seconds
+};
+using checkpoint_info_t = struct CheckpointInfo;
+} // namespace checkpoint
+
+namespace shmcounters {
+
+struct SharedCountersInfo {
+  SharedCountersInfo() = default;
+  SharedCountersInfo(const SharedCountersInfo &) = default;
+  SharedCountersInfo(SharedCountersInfo &&) = default;
+  ~SharedCountersInfo() = default;
+  bool mEnable{false};
+  std::string mName{"/vehicle-tracking-od"};
+  std::string mLabel{"pipeline"};  // restarts with the same label adopt the same slice
+};
+using shared_counters_info_t = struct SharedCountersInfo;
+} // namespace shmcounters
+
+namespace intervalcontrol {
+
+struct IntervalControlInfo {
+  IntervalControlInfo() = default;
+  IntervalControlInfo(const IntervalControlInfo &) = default;
+  IntervalControlInfo(IntervalControlInfo &&) = default;
+  ~IntervalControlInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mMinInterval{0};     // frames skipped between inferences
+  std::uint32_t mMaxInterval{4};
+  std::uint32_t mQuietInterval{2};   // used while the scene is empty
+  double mQueueHigh{0.5};            // fraction of the fullest queue
+  double mQueueLow{0.1};
+  double mLatencyHighMs{250.0};      // streammux to analytics
+  double mLatencyLowMs{100.0};
+  std::uint32_t mQuietObjects{0};    // at most this many objects is quiet
+  std::uint32_t mHold{4};            // samples a condition must last
+  std::uint32_t mPeriodMs{500};      // sampling period
+};
+using interval_control_info_t = struct IntervalControlInfo;
+
+struct LoadSample {
+  double mQueueFill;   // 0..1, fullest queue
+  double mLatencyMs;
+  double mObjects;     // per frame
+};
+using load_sample_t = struct LoadSample;
+} // namespace intervalcontrol
+
+namespace queuecontrol {
+
+struct QueueControlInfo {
+  QueueControlInfo() = default;
+  QueueControlInfo(const QueueControlInfo &) = default;
+  QueueControlInfo(QueueControlInfo &&) = default;
+  ~QueueControlInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mMinBuffers{2};
+  std::uint32_t mMaxBuffers{200};
+  double mHeadroom{2.0};                  // limit kept above the observed peak
+  std::uint32_t mWindow{30};              // samples a shrink decision looks back on
+  std::uint32_t mPeriodMs{1000};          // sampling period
+  std::vector<std::uint32_t> mLeakyQueues;  // 1-based, may drop buffers when at the limit
+};
+using queue_control_info_t = struct QueueControlInfo;
+
+enum class Leaky : std::uint8_t { No = 0, Upstream = 1, Downstream = 2 };
+
+struct QueueSetting {
+  std::uint32_t mMaxBuffers;
+  Leaky mLeaky;
+};
+using queue_setting_t = struct QueueSetting;
+} // namespace queuecontrol
+
+namespace stitching {
+
+struct StitchingInfo {
+  StitchingInfo() = default;
+  StitchingInfo(const StitchingInfo &) = default;
+  StitchingInfo(StitchingInfo &&) = default;
+  ~StitchingInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mWindowMs{1500};  // how long a lost track can be continued
+  double mMaxDistance{80.0};      // pixels from where the lost track would be
+  double mMaxSpeed{600.0};        // pixels per second, caps the prediction
+};
+using stitching_info_t = struct StitchingInfo;
+} // namespace stitching
+
+namespace archive {
+
+struct ArchiveInfo {
+  ArchiveInfo() = default;
+  ArchiveInfo(const ArchiveInfo &) = default;
+  ArchiveInfo(ArchiveInfo &&) = default;
+  ~ArchiveInfo() = default;
+  bool mEnable{false};
+  std::string mDirectory{"/var/tmp/vehicle-tracking-archive"};
+  std::uint32_t mBatchRows{4096};   // events per batch
+  std::uint32_t mBatches{4};        // batches filling or waiting for the disk
+  std::uint32_t mFlushSeconds{10};  // a batch is written at the latest this old
+};
+using archive_info_t = struct ArchiveInfo;
+} // namespace archive
+
+namespace configwatch {
+
+struct ConfigWatchInfo {
+  ConfigWatchInfo() = default;
+  ConfigWatchInfo(const ConfigWatchInfo &) = default;
+  ConfigWatchInfo(ConfigWatchInfo &&) = default;
+  ~ConfigWatchInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mSettleMs{500};  // quiet time after the last write before reloading
+};
+using config_watch_info_t = struct ConfigWatchInfo;
+} // namespace configwatch
+
+namespace metrics {
+
+struct MetricsInfo {
+  MetricsInfo() = default;
+  MetricsInfo(const MetricsInfo &) = default;
+  MetricsInfo(MetricsInfo &&) = default;
+  ~MetricsInfo() = default;
+  std::string mTextfile;  // none when empty, the stats server serves /metrics
+  std::uint32_t mTextfilePeriodMs{15000};
+};
+using metrics_info_t = struct MetricsInfo;
+} // namespace metrics
+
+namespace watchdog {
+
+struct WatchdogInfo {
+  WatchdogInfo() = default;
+  WatchdogInfo(const WatchdogInfo &) = default;
+  WatchdogInfo(WatchdogInfo &&) = default;
+  ~WatchdogInfo() = default;
+  bool mEnable{false};
+  std::uint32_t mPeriodMs{1000};       // how often the heartbeats are checked
+  std::uint32_t mStallMs{5000};        // no buffer out while buffers came in
+  std::uint32_t mRecoveryAttempts{1};  // targeted recoveries before a full restart
+  std::uint32_t mStartupMs{300000};    // first buffer at the latest, 0 waits forever
+};
+using watchdog_info_t = struct WatchdogInfo;
+} // namespace watchdog
+
+namespace metaring {
+
+struct MetaRingInfo {
+  MetaRingInfo() = default;
+  MetaRingInfo(const MetaRingInfo &) = default;
+  MetaRingInfo(MetaRingInfo &&) = default;
+  ~MetaRingInfo() = default;
+  bool mEnable{false};
+  std::string mName{"/vehicle-tracking-meta"};
+  std::uint32_t mSlots{1024};    // frames, a power of two
+  bool mInProcess{true};         // the probe still counts, off leaves it to the consumers
+};
+using meta_ring_info_t = struct MetaRingInfo;
+} // namespace metaring
+
+namespace sources {
+
+struct SourcesInfo {
+  SourcesInfo() = default;
+  SourcesInfo(const SourcesInfo &) = default;
+  SourcesInfo(SourcesInfo &&) = default;
+  ~SourcesInfo() = default;
+  std::uint32_t mMaxSources{1};  // nvstreammux and nvinfer batch size
+};
+using sources_info_t = struct SourcesInfo;
+
+// nvstreammux source id -> location of the elementary H264 file
+using source_list_t = std::map<std::uint32_t, std::string>;
+} // namespace sources
+
+namespace trackerparsing {
+
+// Properties of nvtracker read from cfg/tracker_config.txt, only the ones
+// present there are set on the element
+struct TrackerInfo {
+  TrackerInfo() = default;
+  TrackerInfo(const TrackerInfo &) = default;
+  TrackerInfo(TrackerInfo &&) = default;
+  ~TrackerInfo() = default;
+  gint mWidth{-1};
+  gint mHeight{-1};
+  gint mGpuId{-1};
+  std::string mLlConfigFile;  // absolute
+  std::string mLlLibFile;     // absolute
+  gint mEnableBatchProcess{-1};
+};
+using tracker_info_t = struct TrackerInfo;
+} // namespace trackerparsing
+
+namespace placement {
+
+// CPU specs are cpu lists ("0-3,8") or "node:N" for every cpu of NUMA node N
+struct PlacementInfo {
+  PlacementInfo() = default;
+  PlacementInfo(const PlacementInfo &) = default;
+  PlacementInfo(PlacementInfo &&) = default;
+  ~PlacementInfo() = default;
+  bool mEnable{false};
+  std::map<std::string, std::string> mElements;  // element name -> cpu spec
+  std::string mStreaming;   // other streaming threads
+  std::string mKafka;       // producer poll thread and the librdkafka threads
+  std::string mWorkers;     // logger, stats server
+  int mRealtimePriority{0}; // SCHED_FIFO for realtime-elements, 0 = off
+  std::vector<std::string> mRealtimeElements;
+};
+using placement_info_t = struct PlacementInfo;
+} // namespace placement
+
+namespace statsserver {
+
+struct StatsInfo {
+  StatsInfo() = default;
+  StatsInfo(const StatsInfo &) = default;
+  StatsInfo(StatsInfo &&) = default;
+  ~StatsInfo() = default;
+  bool mEnable{false};
+  std::string mAddress{"127.0.0.1"};
+  std::uint16_t mPort{8080};
+  std::string mUnixSocket;  // takes precedence over address/port when set
+};
+using stats_info_t = struct StatsInfo;
+} // namespace statsserver
+
 namespace vehicletracking {
 
 using arg_count_t = int;
@@ -44,23 +400,87 @@ using buscb_t = gboolean(*)(GstBus *, GstMessage *, gpointer);
 
 using producer_t = std::shared_ptr<::kafkaproducer::KafkaProducer>;
 
+// Settings read from cfg/app_config.txt, one member per group
+struct AppInfo {
+  AppInfo() = default;
+  AppInfo(const AppInfo &) = default;
+  AppInfo(AppInfo &&) = default;
+  ~AppInfo() = default;
+  ::odwindows::windows_info_t mWindows;
+  ::statsserver::stats_info_t mStatsServer;
+  ::checkpoint::checkpoint_info_t mCheckpoint;
+  ::logger::log_info_t mLogging;
+  ::shmcounters::shared_counters_info_t mSharedCounters;
+  ::intervalcontrol::interval_control_info_t mIntervalControl;
+  ::queuecontrol::queue_control_info_t mQueueControl;
+  ::placement::placement_info_t mPlacement;
+  ::stitching::stitching_info_t mStitching;
+  ::odcube::cube_info_t mCube;
+  ::occupancy::occupancy_info_t mOccupancy;
+  ::archive::archive_info_t mArchive;
+  ::configwatch::config_watch_info_t mConfigWatch;
+  ::sources::sources_info_t mSources;
+  ::metrics::metrics_info_t mMetrics;
+  ::watchdog::watchdog_info_t mWatchdog;
+  ::metaring::meta_ring_info_t mMetaRing;
+};
+using app_info_t = struct AppInfo;
+
 } // namespace vehicletracking
 
 namespace metadata {
 
-struct DisplayInfo {
-  std::string fps{"FPS Info: "};
-  std::string roi;
-  std::map<std::string, std::uint32_t> crossings;
+// Wide enough for a busy site summed over many streams
+using crossing_t = std::array<std::uint32_t, N>;
+using crossings_t = std::array<crossing_t, N>;
+
+// Where and when a vehicle inside the intersection came in
+struct Entry {
+  std::size_t mGate;
+  std::uint64_t mTime;    // stream time, nanoseconds
+  std::uint32_t mSource;  // dropped with the stream
 };
-using display_info_t = struct DisplayInfo;
+using entry_t = struct Entry;
 
-using crossing_t = std::array<std::uint16_t, N>;
-using crossings_t = std::array<crossing_t, N>;
+// Tracker id -> entry of the vehicles inside the intersection
+using object_entry_t = ::flatmap::FlatMap<entry_t>;
 
-using object_entry_t = std::unordered_map<std::uint64_t, std::size_t>;
+constexpr auto MAX_SNAPSHOT_WINDOWS = 8;
+constexpr auto MAX_FPS_TEXT_LEN = 64;
 
-using meta_producer_t = std::weak_ptr<::kafkaproducer::KafkaProducer>;
+// Everything the stats surface serves, copied out of the probe once per
+// buffer. Must stay trivially copyable, see seqlock::SeqLock.
+struct Snapshot {
+  crossings_t mCrossings;
+  ::odcube::cube_t mCube;
+  std::array<::odwindows::window_aggregate_t, MAX_SNAPSHOT_WINDOWS> mWindows;
+  std::uint32_t mWindowCount;
+  std::uint64_t mBuffers;
+  std::uint64_t mFrames;
+  std::uint64_t mExits;
+  std::uint64_t mLastPts;
+  std::uint32_t mObjects;
+  std::uint32_t mPendingEntries;
+  double mLatencyMs;  // streammux to analytics, last frame
+  std::uint32_t mInferInterval;
+  char mFps[MAX_FPS_TEXT_LEN];
+  std::uint64_t mArenaHighWater;  // bytes of per buffer scratch, at most
+  std::uint64_t mArenaSpills;     // scratch requests that went to the heap
+  std::uint64_t mStitched;        // id switches bridged
+  std::uint32_t mLostTracks;      // vehicles inside waiting to be continued
+  ::occupancy::rois_t mRois;
+  std::uint64_t mArchived;        // events written to the archive
+  std::uint64_t mArchiveDropped;  // events lost with every batch waiting for the disk
+};
+using snapshot_t = struct Snapshot;
+
+// Where the probe publishes, replaced as a whole when kafka_config.txt
+// changes, see metadata::setSink
+struct Sink {
+  std::shared_ptr<::kafkaproducer::KafkaProducer> mProducer;
+  bool mPerEvent;
+};
+using sink_t = struct Sink;
 
 } // namespace metadata
 
@@ -3,8 +3,22 @@
 
 #include <glib.h>
 #include <gst/gst.h>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "configwatch.h"
+#include "intervalcontroller.h"
 #include "kafkaproducer.h"
+#include "queuecontroller.h"
+#include "sourcemanager.h"
+#include "statsserver.h"
+#include "watchdog.h"
 #include "types.h"
 
 namespace vehicletracking {
@@ -36,11 +50,29 @@ constexpr auto ERR_SET_PROPERTIES_NVTRACKER = 23;
 constexpr auto ERR_LINK_SRC_PARSER_DECODER = 24;
 constexpr auto ERR_LINK_ALL = 25;
 constexpr auto ERR_INITIALIZE_PRODUCER = 25;
+constexpr auto ERR_INITIALIZE_WINDOWS = 26;
+constexpr auto ERR_INITIALIZE_STATS_SERVER = 27;
+constexpr auto ERR_INITIALIZE_CHECKPOINT = 28;
+constexpr auto ERR_INITIALIZE_SHARED_COUNTERS = 29;
+constexpr auto ERR_INITIALIZE_INTERVAL_CONTROL = 30;
+constexpr auto ERR_INITIALIZE_QUEUE_CONTROL = 31;
+constexpr auto ERR_INITIALIZE_STITCHING = 32;
+constexpr auto ERR_INITIALIZE_CUBE = 33;
+constexpr auto ERR_INITIALIZE_OCCUPANCY = 34;
+constexpr auto ERR_INITIALIZE_ARCHIVE = 35;
+constexpr auto ERR_INITIALIZE_GATES = 36;
+constexpr auto ERR_INITIALIZE_CONFIG_WATCH = 37;
+constexpr auto ERR_INITIALIZE_TILER = 38;
+constexpr auto ERR_INITIALIZE_WATCHDOG = 39;
+// Exit code after the watchdog gave up on a stall, restart the process
+constexpr auto ERR_STALLED = 40;
+constexpr auto ERR_INITIALIZE_META_RING = 41;
 
 class VehicleTrackingPipeline final {
  public:
   VehicleTrackingPipeline() = delete;
-  explicit VehicleTrackingPipeline(const arg_count_t, arg_var_t, const ::kafkaproducer::kafka_info_t &);
+  explicit VehicleTrackingPipeline(const arg_count_t, arg_var_t, const ::kafkaproducer::kafka_info_t &,
+    const app_info_t &);
   VehicleTrackingPipeline(const VehicleTrackingPipeline &) = default;
   VehicleTrackingPipeline(VehicleTrackingPipeline &&) = default;
   ~VehicleTrackingPipeline();
@@ -48,18 +80,81 @@ class VehicleTrackingPipeline final {
   std::uint8_t initialize(const buscb_t, const ::kafkaproducer::kafkacb_t &);
   void run();
   void printCrossings();
+  // Set when the main loop was quit on a failure, ERR_STALLED after the
+  // watchdog gave up or ERR_INITIALIZE_PRODUCER
+  std::uint8_t exitCode() const { return mExitCode; }
  
  private:
   void cleanup();
+  // To NULL, which joins the streaming threads. False when a wedged
+  // element held it up past STOP_TIMEOUT after a stall.
+  bool stop();
   void addMessageHandler(const buscb_t);
-  
+  static gboolean adjustInterval(gpointer);
+  static gboolean adjustQueues(gpointer);
+  static gboolean writeMetrics(gpointer);
+  static gboolean checkStalls(gpointer);
+  // Until the producer connecting in the background is ready
+  static gboolean awaitProducer(gpointer);
+  // False when it gave up and quit the main loop
+  bool recover(const ::watchdog::Stall &);
+  // Every time the source manager adds one
+  void sourceAdded(const std::uint32_t, GstElement *);
+  void watchSource(const std::uint32_t, GstElement *);
+  // Stages of removed sources
+  void retireSources();
+  // Watcher thread
+  void reload(const std::string &);
+  void reloadAnalytics();
+  void reloadTracker();
+  void reloadKafka();
+  void reloadSources();
+  // Runs the change while the queue's source pad is idle, so the element
+  // after it is between two frames
+  void whileIdle(GstElement *, const std::function<void(GstPad *)> &);
+
   arg_count_t mArgc;
   loop_t mLoop;
   pipeline_t mPipeline;
   bus_id_t mBusWatchId;
   bool mCleanup;
+  // Left to the exiting process, a thread still waits for its NULL state
+  bool mWedged;
   ::kafkaproducer::kafka_info_t mKafkaInfo;
+  app_info_t mAppInfo;
+  ::kafkaproducer::kafkacb_t mKafkaCall;
+  // Also in the metadata sink, replaced by reloadKafka()
   producer_t mProducer;
+  std::future<producer_t> mPendingProducer;
+  std::atomic<bool> mProducerReady;
+  // Analytics is held at its queue until then, nothing is counted unpublished
+  GstPad *mHoldPad;
+  gulong mHoldProbeId;
+  // Watched along with the tracker config
+  std::string mTrackerLlConfigFile;
+  std::unique_ptr<::statsserver::StatsServer> mStatsServer;
+  std::unique_ptr<::intervalcontrol::IntervalController> mIntervalController;
+  std::unique_ptr<::queuecontrol::QueueController> mQueueController;
+  std::unique_ptr<::configwatch::ConfigWatcher> mConfigWatcher;
+  std::unique_ptr<::watchdog::Watchdog> mWatchdog;
+  // Destroyed before the watchdog, its sources hold stages
+  std::unique_ptr<::sources::SourceManager> mSourceManager;
+  std::map<std::uint32_t, ::watchdog::Stage*> mSourceStages;
+  // Sources past the streams of the O/D cube, warned of once
+  std::set<std::uint32_t> mFoldedSources;
+  std::vector<GstElement*> mQueues;
+  GstElement *mPgie;
+  GstElement *mTracker;
+  GstElement *mAnalytics;
+  GstElement *mTrackerQueue;
+  GstElement *mAnalyticsQueue;
+  guint mIntervalSourceId;
+  guint mQueueSourceId;
+  guint mMetricsSourceId;
+  guint mWatchdogSourceId;
+  guint mProducerSourceId;
+  std::uint8_t mExitCode;
+  int mBottleneck;
   arg_var_t mArgv;
 };
 
@@ -0,0 +1,103 @@
+#ifndef __WATCHDOG__
+#define __WATCHDOG__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "metrics.h"
+#include "types.h"
+
+namespace watchdog {
+
+constexpr auto ERR_MSG_STALL = "stall-ms must be at least period-ms";
+
+constexpr std::uint32_t NO_SOURCE = ~static_cast<std::uint32_t>(0);
+
+// One element of the pipeline, seen from the buffers on its src pad
+class Stage final {
+ public:
+  Stage() = delete;
+  explicit Stage(const std::string &, const Stage *, const std::uint32_t, const bool);
+  Stage(const Stage &) = delete;
+  Stage(Stage &&) = delete;
+  ~Stage() = default;
+
+  // Streaming threads, from pad probes
+  void beat() { mBeats.inc(); }
+  // EOS: no more buffers to wait for. A restarted source starts again.
+  void finish(const bool finished) { mFinished.store(finished, std::memory_order_relaxed); }
+
+  const std::string &name() const { return mName; }
+  // The nvstreammux source id of a source branch, NO_SOURCE otherwise
+  std::uint32_t source() const { return mSource; }
+
+ private:
+  friend class Watchdog;
+
+  std::string mName;
+  const Stage *mUpstream;
+  std::uint32_t mSource;
+  bool mWatched;  // only a heartbeat for the stages after it
+  // Also vt_stage_buffers_total{stage="<name>"}
+  metrics::Counter &mBeats;
+  std::atomic<bool> mFinished;
+  // Main loop only
+  std::uint64_t mSeenBeats;
+  std::int64_t mProgressMs;     // last check that saw new buffers
+  std::int64_t mNextAttemptMs;  // a recovery gets stall-ms to work
+  double mRate;                 // buffers per second over the last period
+  std::uint32_t mAttempts;
+  bool mStarted;  // passed a buffer since it was added
+  bool mRetired;
+};
+
+struct Stall {
+  Stage *mStage;
+  std::int64_t mStalledMs;
+  bool mRestart;  // targeted recovery didn't help, restart everything
+};
+
+// Finds the stage that wedged the pipeline from per-stage heartbeats.
+// Knows nothing about GStreamer: the pipeline feeds it pad probe counts
+// and carries out the recovery.
+//
+// A stage is stalled when no buffer came out of it for stall-ms while
+// the stage before it went on producing. Backpressure stalls everything
+// upstream of a wedged element too, so only the last stalled stage of a
+// chain is reported, and source stalls only when the rest of the
+// pipeline is fine. A stage that hasn't passed its first buffer gets
+// startup-ms instead, once the stage before it has started; one that
+// reached EOS is never stalled. Each stall gets recovery-attempts
+// targeted recoveries, stall-ms apart, then a full restart.
+class Watchdog final {
+ public:
+  Watchdog() = delete;
+  // Throws std::invalid_argument
+  explicit Watchdog(const watchdog_info_t &);
+  Watchdog(const Watchdog &) = delete;
+  Watchdog(Watchdog &&) = delete;
+  ~Watchdog() = default;
+
+  // Main loop thread. Stages live as long as the watchdog, pad probes
+  // hold them. A source stage goes before the stages it feeds.
+  Stage *addStage(const std::string &, const Stage * = nullptr, const std::uint32_t = NO_SOURCE,
+    const bool = true);
+  // Its source was removed, never checked again
+  void retire(Stage *);
+  std::vector<Stall> check(const std::int64_t);
+  // One line per stage: buffers, rate, time since the last one
+  std::vector<std::string> describe(const std::int64_t) const;
+
+ private:
+  bool stalled(const Stage &, const std::int64_t) const;
+
+  watchdog_info_t mInfo;
+  std::vector<std::unique_ptr<Stage>> mStages;
+  std::int64_t mLastCheckMs;
+};
+
+} // namespace watchdog
+
+#endif //__WATCHDOG__
@@ -0,0 +1,139 @@
+#include "allocaccounting.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#include "logger.h"
+
+namespace {
+
+std::atomic<std::uint64_t> invocations{0};
+std::atomic<std::uint64_t> allocations{0};
+std::atomic<std::uint64_t> maxPerInvocation{0};
+std::atomic<std::uint64_t> steadyStateRegressions{0};
+
+#ifdef VT_ALLOC_ACCOUNTING
+thread_local std::uint64_t threadCount = 0;
+
+void *countedAllocate(const std::size_t size) {
+  ++threadCount;
+  for (;;) {
+    if (void *block = std::malloc(size ? size : 1)) {
+      return block;
+    }
+    auto handler = std::get_new_handler();
+    if (nullptr == handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+#endif
+
+} // namespace
+
+#ifdef VT_ALLOC_ACCOUNTING
+void *operator new(std::size_t size) {
+  return countedAllocate(size);
+}
+
+void *operator new[](std::size_t size) {
+  return countedAllocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return countedAllocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return countedAllocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *block) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void *block) noexcept {
+  std::free(block);
+}
+
+void operator delete(void *block, std::size_t) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void *block, std::size_t) noexcept {
+  std::free(block);
+}
+
+void operator delete(void *block, const std::nothrow_t &) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept {
+  std::free(block);
+}
+#endif
+
+namespace allocaccounting {
+
+std::uint64_t threadAllocations() {
+#ifdef VT_ALLOC_ACCOUNTING
+  return threadCount;
+#else
+  return 0;
+#endif
+}
+
+ProbeScope::ProbeScope():
+  mStart{threadAllocations()}
+{
+}
+
+ProbeScope::~ProbeScope() {
+  if (!ENABLED) {
+    return;
+  }
+  auto count = threadAllocations() - mStart;
+  auto invocation = ++invocations;
+  if (0 == count) {
+    return;
+  }
+  allocations += count;
+  auto max = maxPerInvocation.load(std::memory_order_relaxed);
+  while (count > max && !maxPerInvocation.compare_exchange_weak(max, count)) {
+  }
+  if (invocation > WARMUP_BUFFERS) {
+    ++steadyStateRegressions;
+    LOG_ERROR("Probe allocated {} times on buffer {}, expected none in steady state", count, invocation);
+  }
+}
+
+std::uint64_t regressions() {
+  return steadyStateRegressions.load();
+}
+
+std::string statsJson() {
+  if (!ENABLED) {
+    return "{\"enabled\":false}";
+  }
+  std::stringstream out;
+  out << "{\"enabled\":true";
+  out << ", \"buffers\":" << invocations.load();
+  out << ", \"allocations\":" << allocations.load();
+  out << ", \"max_per_buffer\":" << maxPerInvocation.load();
+  out << ", \"steady_state_regressions\":" << steadyStateRegressions.load();
+  out << "}";
+  return out.str();
+}
+
+} // namespace allocaccounting
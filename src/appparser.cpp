@@ -0,0 +1,1222 @@
+#include "appparser.h"
+
+#include <glib.h>
+#include <array>
+#include <iostream>
+
+namespace {
+
+constexpr auto APP_CONFIG_FILE = "cfg/app_config.txt";
+constexpr auto CONFIG_GROUP_AGGREGATION = "aggregation";
+constexpr auto CONFIG_GROUP_AGGREGATION_TUMBLING = "tumbling-windows";
+constexpr auto CONFIG_GROUP_AGGREGATION_SLIDING = "sliding-windows";
+constexpr auto CONFIG_GROUP_AGGREGATION_SLIDING_HOP = "sliding-hop";
+constexpr auto CONFIG_GROUP_CHECKPOINT = "checkpoint";
+constexpr auto CONFIG_GROUP_CHECKPOINT_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_CHECKPOINT_PATH = "path";
+constexpr auto CONFIG_GROUP_CHECKPOINT_INTERVAL = "interval";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL = "interval-control";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_MIN_INTERVAL = "min-interval";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_MAX_INTERVAL = "max-interval";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_QUIET_INTERVAL = "quiet-interval";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_QUEUE_HIGH = "queue-high";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_QUEUE_LOW = "queue-low";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_LATENCY_HIGH = "latency-high-ms";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_LATENCY_LOW = "latency-low-ms";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_QUIET_OBJECTS = "quiet-objects";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_HOLD = "hold";
+constexpr auto CONFIG_GROUP_INTERVAL_CONTROL_PERIOD = "period-ms";
+constexpr auto CONFIG_GROUP_LOGGING = "logging";
+constexpr auto CONFIG_GROUP_LOGGING_LEVEL = "level";
+constexpr auto CONFIG_GROUP_LOGGING_RATE_LIMIT = "rate-limit";
+constexpr auto CONFIG_GROUP_CUBE = "od-cube";
+constexpr auto CONFIG_GROUP_CUBE_STREAMS = "streams";
+constexpr auto CONFIG_GROUP_CUBE_CLASSES = "classes";
+constexpr auto CONFIG_GROUP_OCCUPANCY = "occupancy";
+constexpr auto CONFIG_GROUP_OCCUPANCY_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_OCCUPANCY_RAW_SECONDS = "raw-seconds";
+constexpr auto CONFIG_GROUP_OCCUPANCY_MAX_FPS = "max-fps";
+constexpr auto CONFIG_GROUP_OCCUPANCY_MINUTES = "minutes";
+constexpr auto CONFIG_GROUP_OCCUPANCY_HOURS = "hours";
+constexpr auto CONFIG_GROUP_ARCHIVE = "archive";
+constexpr auto CONFIG_GROUP_ARCHIVE_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_ARCHIVE_DIRECTORY = "directory";
+constexpr auto CONFIG_GROUP_ARCHIVE_BATCH_ROWS = "batch-rows";
+constexpr auto CONFIG_GROUP_ARCHIVE_BATCHES = "batches";
+constexpr auto CONFIG_GROUP_ARCHIVE_FLUSH_SECONDS = "flush-seconds";
+constexpr auto CONFIG_GROUP_CONFIG_WATCH = "config-watch";
+constexpr auto CONFIG_GROUP_CONFIG_WATCH_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_CONFIG_WATCH_SETTLE = "settle-ms";
+constexpr auto CONFIG_GROUP_SOURCES = "sources";
+constexpr auto CONFIG_GROUP_SOURCES_MAX_SOURCES = "max-sources";
+constexpr auto CONFIG_GROUP_METRICS = "metrics";
+constexpr auto CONFIG_GROUP_METRICS_TEXTFILE = "textfile";
+constexpr auto CONFIG_GROUP_METRICS_TEXTFILE_PERIOD = "textfile-period-ms";
+
+constexpr auto CONFIG_GROUP_WATCHDOG = "watchdog";
+constexpr auto CONFIG_GROUP_WATCHDOG_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_WATCHDOG_PERIOD = "period-ms";
+constexpr auto CONFIG_GROUP_WATCHDOG_STALL = "stall-ms";
+constexpr auto CONFIG_GROUP_WATCHDOG_RECOVERY_ATTEMPTS = "recovery-attempts";
+constexpr auto CONFIG_GROUP_WATCHDOG_STARTUP = "startup-ms";
+
+constexpr auto CONFIG_GROUP_META_RING = "meta-ring";
+constexpr auto CONFIG_GROUP_META_RING_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_META_RING_NAME = "name";
+constexpr auto CONFIG_GROUP_META_RING_SLOTS = "slots";
+constexpr auto CONFIG_GROUP_META_RING_IN_PROCESS = "in-process";
+constexpr auto CONFIG_GROUP_STITCHING = "stitching";
+constexpr auto CONFIG_GROUP_STITCHING_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_STITCHING_WINDOW = "window-ms";
+constexpr auto CONFIG_GROUP_STITCHING_MAX_DISTANCE = "max-distance";
+constexpr auto CONFIG_GROUP_STITCHING_MAX_SPEED = "max-speed";
+constexpr auto CONFIG_GROUP_PLACEMENT = "placement";
+constexpr auto CONFIG_GROUP_PLACEMENT_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_PLACEMENT_QUEUE_PREFIX = "queue";
+constexpr auto CONFIG_GROUP_PLACEMENT_STREAMING = "streaming";
+constexpr auto CONFIG_GROUP_PLACEMENT_KAFKA = "kafka";
+constexpr auto CONFIG_GROUP_PLACEMENT_WORKERS = "workers";
+constexpr auto CONFIG_GROUP_PLACEMENT_REALTIME_PRIORITY = "realtime-priority";
+constexpr auto CONFIG_GROUP_PLACEMENT_REALTIME_ELEMENTS = "realtime-elements";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL = "queue-control";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_MIN_BUFFERS = "min-buffers";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_MAX_BUFFERS = "max-buffers";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_HEADROOM = "headroom";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_WINDOW = "window";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_PERIOD = "period-ms";
+constexpr auto CONFIG_GROUP_QUEUE_CONTROL_LEAKY_QUEUES = "leaky-queues";
+constexpr auto CONFIG_GROUP_SHARED_COUNTERS = "shared-counters";
+constexpr auto CONFIG_GROUP_SHARED_COUNTERS_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_SHARED_COUNTERS_NAME = "name";
+constexpr auto CONFIG_GROUP_SHARED_COUNTERS_LABEL = "label";
+constexpr auto CONFIG_GROUP_STATS_SERVER = "stats-server";
+constexpr auto CONFIG_GROUP_STATS_SERVER_ENABLE = "enable";
+constexpr auto CONFIG_GROUP_STATS_SERVER_ADDRESS = "address";
+constexpr auto CONFIG_GROUP_STATS_SERVER_PORT = "port";
+constexpr auto CONFIG_GROUP_STATS_SERVER_UNIX_SOCKET = "unix-socket";
+
+#define CHECK_ERROR(error) \
+  if (error) { \
+    std::cerr << "Error while parsing config file: " << error->message << std::endl; \
+    goto done; \
+  }
+
+bool getPositiveList (GKeyFile *key_file, const gchar *group, const gchar *key,
+  std::vector<std::uint32_t> &list, GError **error) {
+  gsize length = 0;
+  gint *values = g_key_file_get_integer_list (key_file, group, key, &length, error);
+  if (nullptr == values) {
+    return false;
+  }
+  list.clear();
+  for (gsize i = 0; i < length; ++i) {
+    if (values[i] <= 0) {
+      std::cerr << "Invalid value " << values[i] << " for key '" << key << "'" << std::endl;
+      g_free (values);
+      return false;
+    }
+    list.push_back(static_cast<std::uint32_t>(values[i]));
+  }
+  g_free (values);
+  return true;
+}
+
+// Reads a non-negative integer, min_value guards keys where 0 makes no sense
+bool getCount (GKeyFile *key_file, const gchar *group, const gchar *key,
+  std::uint32_t &count, GError **error, const gint min_value = 0) {
+  gint value = g_key_file_get_integer (key_file, group, key, error);
+  if (*error != nullptr) {
+    return false;
+  }
+  if (value < min_value) {
+    std::cerr << "Invalid value " << value << " for key '" << key << "'" << std::endl;
+    return false;
+  }
+  count = static_cast<std::uint32_t>(value);
+  return true;
+}
+
+bool getDouble (GKeyFile *key_file, const gchar *group, const gchar *key,
+  double &result, GError **error, const gdouble max_value) {
+  gdouble value = g_key_file_get_double (key_file, group, key, error);
+  if (*error != nullptr) {
+    return false;
+  }
+  if (value < 0.0 || value > max_value) {
+    std::cerr << "Invalid value " << value << " for key '" << key << "'" << std::endl;
+    return false;
+  }
+  result = value;
+  return true;
+}
+
+// Read once by setAppProperties, every group is taken from that copy
+GKeyFile *appConfig = nullptr;
+
+GKeyFile *loadAppConfig (GError **error) {
+  if (nullptr != appConfig) {
+    return g_key_file_ref (appConfig);
+  }
+  GKeyFile *key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, APP_CONFIG_FILE, G_KEY_FILE_NONE, error)) {
+    g_key_file_unref (key_file);
+    return nullptr;
+  }
+  return key_file;
+}
+
+bool getLevel (const gchar *name, logger::Level &level) {
+  constexpr std::array<const char*, 5> names{{"trace", "debug", "info", "warn", "error"}};
+  for (std::size_t idx = 0; idx < names.size(); ++idx) {
+    if (!g_strcmp0 (name, names[idx])) {
+      level = static_cast<logger::Level>(idx);
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace appparser {
+
+bool setAppProperties (vehicletracking::app_info_t& appInfo) {
+  GError *error = nullptr;
+  appConfig = loadAppConfig (&error);
+  if (nullptr == appConfig) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = setAggregationProperties (appInfo.mWindows) &&
+    setStatsServerProperties (appInfo.mStatsServer) &&
+    setCheckpointProperties (appInfo.mCheckpoint) &&
+    setLoggingProperties (appInfo.mLogging) &&
+    setSharedCountersProperties (appInfo.mSharedCounters) &&
+    setIntervalControlProperties (appInfo.mIntervalControl) &&
+    setQueueControlProperties (appInfo.mQueueControl) &&
+    setPlacementProperties (appInfo.mPlacement) &&
+    setStitchingProperties (appInfo.mStitching) &&
+    setCubeProperties (appInfo.mCube) &&
+    setOccupancyProperties (appInfo.mOccupancy) &&
+    setArchiveProperties (appInfo.mArchive) &&
+    setConfigWatchProperties (appInfo.mConfigWatch) &&
+    setSourcesProperties (appInfo.mSources) &&
+    setMetricsProperties (appInfo.mMetrics) &&
+    setWatchdogProperties (appInfo.mWatchdog) &&
+    setMetaRingProperties (appInfo.mMetaRing);
+  g_key_file_unref (appConfig);
+  appConfig = nullptr;
+  return ret;
+}
+
+bool setAggregationProperties (odwindows::windows_info_t& windowsInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_AGGREGATION)) {
+    // Aggregation is optional, no windows configured
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_AGGREGATION, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_AGGREGATION_TUMBLING)) {
+      if (!getPositiveList (key_file, CONFIG_GROUP_AGGREGATION,
+            CONFIG_GROUP_AGGREGATION_TUMBLING, windowsInfo.mTumbling, &error)) {
+        CHECK_ERROR (error);
+        goto done;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_AGGREGATION_SLIDING)) {
+      if (!getPositiveList (key_file, CONFIG_GROUP_AGGREGATION,
+            CONFIG_GROUP_AGGREGATION_SLIDING, windowsInfo.mSliding, &error)) {
+        CHECK_ERROR (error);
+        goto done;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_AGGREGATION_SLIDING_HOP)) {
+      gint hop = g_key_file_get_integer (key_file, CONFIG_GROUP_AGGREGATION,
+                    CONFIG_GROUP_AGGREGATION_SLIDING_HOP, &error);
+      CHECK_ERROR (error);
+      if (hop <= 0) {
+        std::cerr << "Invalid value " << hop << " for key '" << *key << "'" << std::endl;
+        goto done;
+      }
+      windowsInfo.mSlidingHop = static_cast<std::uint32_t>(hop);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_AGGREGATION << "]" << std::endl;
+    }
+  }
+  for (const auto length: windowsInfo.mSliding) {
+    if (0 != length % windowsInfo.mSlidingHop) {
+      std::cerr << "Sliding window " << length << "s is not a multiple of the "
+                << windowsInfo.mSlidingHop << "s hop" << std::endl;
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setStatsServerProperties (statsserver::stats_info_t& statsInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_STATS_SERVER)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_STATS_SERVER, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_STATS_SERVER_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_STATS_SERVER,
+                    CONFIG_GROUP_STATS_SERVER_ENABLE, &error);
+      CHECK_ERROR (error);
+      statsInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STATS_SERVER_ADDRESS)) {
+      gchar *address = g_key_file_get_string (key_file, CONFIG_GROUP_STATS_SERVER,
+                    CONFIG_GROUP_STATS_SERVER_ADDRESS, &error);
+      CHECK_ERROR (error);
+      statsInfo.mAddress = std::string(address);
+      g_free (address);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STATS_SERVER_PORT)) {
+      gint port = g_key_file_get_integer (key_file, CONFIG_GROUP_STATS_SERVER,
+                    CONFIG_GROUP_STATS_SERVER_PORT, &error);
+      CHECK_ERROR (error);
+      if (port <= 0 || port > 65535) {
+        std::cerr << "Invalid value " << port << " for key '" << *key << "'" << std::endl;
+        goto done;
+      }
+      statsInfo.mPort = static_cast<std::uint16_t>(port);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STATS_SERVER_UNIX_SOCKET)) {
+      gchar *path = g_key_file_get_string (key_file, CONFIG_GROUP_STATS_SERVER,
+                    CONFIG_GROUP_STATS_SERVER_UNIX_SOCKET, &error);
+      CHECK_ERROR (error);
+      statsInfo.mUnixSocket = std::string(path);
+      g_free (path);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_STATS_SERVER << "]" << std::endl;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setCheckpointProperties (checkpoint::checkpoint_info_t& checkpointInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_CHECKPOINT)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_CHECKPOINT, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_CHECKPOINT_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_CHECKPOINT,
+                    CONFIG_GROUP_CHECKPOINT_ENABLE, &error);
+      CHECK_ERROR (error);
+      checkpointInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_CHECKPOINT_PATH)) {
+      gchar *path = g_key_file_get_string (key_file, CONFIG_GROUP_CHECKPOINT,
+                    CONFIG_GROUP_CHECKPOINT_PATH, &error);
+      CHECK_ERROR (error);
+      checkpointInfo.mPath = std::string(path);
+      g_free (path);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_CHECKPOINT_INTERVAL)) {
+      gint interval = g_key_file_get_integer (key_file, CONFIG_GROUP_CHECKPOINT,
+                    CONFIG_GROUP_CHECKPOINT_INTERVAL, &error);
+      CHECK_ERROR (error);
+      if (interval <= 0) {
+        std::cerr << "Invalid value " << interval << " for key '" << *key << "'" << std::endl;
+        goto done;
+      }
+      checkpointInfo.mInterval = static_cast<std::uint32_t>(interval);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_CHECKPOINT << "]" << std::endl;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setLoggingProperties (logger::log_info_t& logInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_LOGGING)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_LOGGING, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_LOGGING_LEVEL)) {
+      gchar *level = g_key_file_get_string (key_file, CONFIG_GROUP_LOGGING,
+                    CONFIG_GROUP_LOGGING_LEVEL, &error);
+      CHECK_ERROR (error);
+      bool known = getLevel (level, logInfo.mLevel);
+      if (!known) {
+        std::cerr << "Unknown log level '" << level << "'" << std::endl;
+      }
+      g_free (level);
+      if (!known) {
+        goto done;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_LOGGING_RATE_LIMIT)) {
+      gint rateLimit = g_key_file_get_integer (key_file, CONFIG_GROUP_LOGGING,
+                    CONFIG_GROUP_LOGGING_RATE_LIMIT, &error);
+      CHECK_ERROR (error);
+      if (rateLimit < 0) {
+        std::cerr << "Invalid value " << rateLimit << " for key '" << *key << "'" << std::endl;
+        goto done;
+      }
+      logInfo.mRateLimit = static_cast<std::uint32_t>(rateLimit);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_LOGGING << "]" << std::endl;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setSharedCountersProperties (shmcounters::shared_counters_info_t& countersInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_SHARED_COUNTERS)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_SHARED_COUNTERS, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_SHARED_COUNTERS_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_SHARED_COUNTERS,
+                    CONFIG_GROUP_SHARED_COUNTERS_ENABLE, &error);
+      CHECK_ERROR (error);
+      countersInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_SHARED_COUNTERS_NAME)) {
+      gchar *name = g_key_file_get_string (key_file, CONFIG_GROUP_SHARED_COUNTERS,
+                    CONFIG_GROUP_SHARED_COUNTERS_NAME, &error);
+      CHECK_ERROR (error);
+      countersInfo.mName = std::string(name);
+      g_free (name);
+      if (countersInfo.mName.size() < 2 || countersInfo.mName[0] != '/' ||
+          countersInfo.mName.find('/', 1) != std::string::npos) {
+        std::cerr << "Invalid value " << countersInfo.mName << " for key '" << *key
+                  << "', expected /name" << std::endl;
+        goto done;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_SHARED_COUNTERS_LABEL)) {
+      gchar *label = g_key_file_get_string (key_file, CONFIG_GROUP_SHARED_COUNTERS,
+                    CONFIG_GROUP_SHARED_COUNTERS_LABEL, &error);
+      CHECK_ERROR (error);
+      countersInfo.mLabel = std::string(label);
+      g_free (label);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_SHARED_COUNTERS << "]" << std::endl;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setIntervalControlProperties (intervalcontrol::interval_control_info_t& controlInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_INTERVAL_CONTROL)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_INTERVAL_CONTROL, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_INTERVAL_CONTROL,
+                    CONFIG_GROUP_INTERVAL_CONTROL_ENABLE, &error);
+      CHECK_ERROR (error);
+      controlInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_MIN_INTERVAL)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mMinInterval, &error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_MAX_INTERVAL)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mMaxInterval, &error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_QUIET_INTERVAL)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mQuietInterval, &error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_QUEUE_HIGH)) {
+      valid = getDouble (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mQueueHigh, &error, 1.0);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_QUEUE_LOW)) {
+      valid = getDouble (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mQueueLow, &error, 1.0);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_LATENCY_HIGH)) {
+      valid = getDouble (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mLatencyHighMs, &error, G_MAXDOUBLE);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_LATENCY_LOW)) {
+      valid = getDouble (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mLatencyLowMs, &error, G_MAXDOUBLE);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_QUIET_OBJECTS)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mQuietObjects, &error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_HOLD)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mHold, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INTERVAL_CONTROL_PERIOD)) {
+      valid = getCount (key_file, CONFIG_GROUP_INTERVAL_CONTROL, *key, controlInfo.mPeriodMs, &error, 1);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_INTERVAL_CONTROL << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setQueueControlProperties (queuecontrol::queue_control_info_t& controlInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_QUEUE_CONTROL)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_QUEUE_CONTROL, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_QUEUE_CONTROL,
+                    CONFIG_GROUP_QUEUE_CONTROL_ENABLE, &error);
+      CHECK_ERROR (error);
+      controlInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_MIN_BUFFERS)) {
+      valid = getCount (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mMinBuffers, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_MAX_BUFFERS)) {
+      valid = getCount (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mMaxBuffers, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_HEADROOM)) {
+      valid = getDouble (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mHeadroom, &error, G_MAXDOUBLE);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_WINDOW)) {
+      valid = getCount (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mWindow, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_PERIOD)) {
+      valid = getCount (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mPeriodMs, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_QUEUE_CONTROL_LEAKY_QUEUES)) {
+      valid = getPositiveList (key_file, CONFIG_GROUP_QUEUE_CONTROL, *key, controlInfo.mLeakyQueues, &error);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_QUEUE_CONTROL << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setPlacementProperties (placement::placement_info_t& placementInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_PLACEMENT)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_PLACEMENT, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_PLACEMENT,
+                    CONFIG_GROUP_PLACEMENT_ENABLE, &error);
+      CHECK_ERROR (error);
+      placementInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_REALTIME_PRIORITY)) {
+      gint priority = g_key_file_get_integer (key_file, CONFIG_GROUP_PLACEMENT,
+                    CONFIG_GROUP_PLACEMENT_REALTIME_PRIORITY, &error);
+      CHECK_ERROR (error);
+      placementInfo.mRealtimePriority = priority;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_REALTIME_ELEMENTS)) {
+      gchar **elements = g_key_file_get_string_list (key_file, CONFIG_GROUP_PLACEMENT,
+                    CONFIG_GROUP_PLACEMENT_REALTIME_ELEMENTS, nullptr, &error);
+      CHECK_ERROR (error);
+      placementInfo.mRealtimeElements.clear();
+      for (gchar **element = elements; *element != nullptr; ++element) {
+        placementInfo.mRealtimeElements.push_back(std::string(*element));
+      }
+      g_strfreev (elements);
+    } else {
+      gchar *spec = g_key_file_get_string (key_file, CONFIG_GROUP_PLACEMENT, *key, &error);
+      CHECK_ERROR (error);
+      if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_STREAMING)) {
+        placementInfo.mStreaming = std::string(spec);
+      } else if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_KAFKA)) {
+        placementInfo.mKafka = std::string(spec);
+      } else if (!g_strcmp0 (*key, CONFIG_GROUP_PLACEMENT_WORKERS)) {
+        placementInfo.mWorkers = std::string(spec);
+      } else if (g_str_has_prefix (*key, CONFIG_GROUP_PLACEMENT_QUEUE_PREFIX)) {
+        // Keyed by the queue element name, queue1 to queue6
+        placementInfo.mElements[std::string(*key)] = std::string(spec);
+      } else {
+        std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_PLACEMENT << "]" << std::endl;
+      }
+      g_free (spec);
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setStitchingProperties (stitching::stitching_info_t& stitchingInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_STITCHING)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_STITCHING, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_STITCHING_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_STITCHING,
+                    CONFIG_GROUP_STITCHING_ENABLE, &error);
+      CHECK_ERROR (error);
+      stitchingInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STITCHING_WINDOW)) {
+      valid = getCount (key_file, CONFIG_GROUP_STITCHING, *key, stitchingInfo.mWindowMs, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STITCHING_MAX_DISTANCE)) {
+      valid = getDouble (key_file, CONFIG_GROUP_STITCHING, *key, stitchingInfo.mMaxDistance, &error, G_MAXDOUBLE);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_STITCHING_MAX_SPEED)) {
+      valid = getDouble (key_file, CONFIG_GROUP_STITCHING, *key, stitchingInfo.mMaxSpeed, &error, G_MAXDOUBLE);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_STITCHING << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setCubeProperties (odcube::cube_info_t& cubeInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_CUBE)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_CUBE, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_CUBE_STREAMS)) {
+      valid = getCount (key_file, CONFIG_GROUP_CUBE, *key, cubeInfo.mStreams, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_CUBE_CLASSES)) {
+      gchar **classes = g_key_file_get_string_list (key_file, CONFIG_GROUP_CUBE,
+                    CONFIG_GROUP_CUBE_CLASSES, nullptr, &error);
+      CHECK_ERROR (error);
+      cubeInfo.mClasses.clear();
+      for (gchar **name = classes; *name != nullptr; ++name) {
+        cubeInfo.mClasses.push_back(std::string(*name));
+      }
+      g_strfreev (classes);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_CUBE << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setOccupancyProperties (occupancy::occupancy_info_t& occupancyInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_OCCUPANCY)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_OCCUPANCY, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_OCCUPANCY_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_OCCUPANCY,
+                    CONFIG_GROUP_OCCUPANCY_ENABLE, &error);
+      CHECK_ERROR (error);
+      occupancyInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_OCCUPANCY_RAW_SECONDS)) {
+      valid = getCount (key_file, CONFIG_GROUP_OCCUPANCY, *key, occupancyInfo.mRawSeconds, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_OCCUPANCY_MAX_FPS)) {
+      valid = getCount (key_file, CONFIG_GROUP_OCCUPANCY, *key, occupancyInfo.mMaxFps, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_OCCUPANCY_MINUTES)) {
+      valid = getCount (key_file, CONFIG_GROUP_OCCUPANCY, *key, occupancyInfo.mMinutes, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_OCCUPANCY_HOURS)) {
+      valid = getCount (key_file, CONFIG_GROUP_OCCUPANCY, *key, occupancyInfo.mHours, &error, 1);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_OCCUPANCY << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setArchiveProperties (archive::archive_info_t& archiveInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_ARCHIVE)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_ARCHIVE, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_ARCHIVE_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_ARCHIVE,
+                    CONFIG_GROUP_ARCHIVE_ENABLE, &error);
+      CHECK_ERROR (error);
+      archiveInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_ARCHIVE_DIRECTORY)) {
+      gchar *directory = g_key_file_get_string (key_file, CONFIG_GROUP_ARCHIVE,
+                    CONFIG_GROUP_ARCHIVE_DIRECTORY, &error);
+      CHECK_ERROR (error);
+      archiveInfo.mDirectory = std::string(directory);
+      g_free (directory);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_ARCHIVE_BATCH_ROWS)) {
+      valid = getCount (key_file, CONFIG_GROUP_ARCHIVE, *key, archiveInfo.mBatchRows, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_ARCHIVE_BATCHES)) {
+      valid = getCount (key_file, CONFIG_GROUP_ARCHIVE, *key, archiveInfo.mBatches, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_ARCHIVE_FLUSH_SECONDS)) {
+      valid = getCount (key_file, CONFIG_GROUP_ARCHIVE, *key, archiveInfo.mFlushSeconds, &error, 1);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_ARCHIVE << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setConfigWatchProperties (configwatch::config_watch_info_t& watchInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_CONFIG_WATCH)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_CONFIG_WATCH, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_CONFIG_WATCH_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_CONFIG_WATCH,
+                    CONFIG_GROUP_CONFIG_WATCH_ENABLE, &error);
+      CHECK_ERROR (error);
+      watchInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_CONFIG_WATCH_SETTLE)) {
+      valid = getCount (key_file, CONFIG_GROUP_CONFIG_WATCH, *key, watchInfo.mSettleMs, &error, 0);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_CONFIG_WATCH << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setSourcesProperties (sources::sources_info_t& sourcesInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_SOURCES)) {
+    // The one stream of the command line
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_SOURCES, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_SOURCES_MAX_SOURCES)) {
+      valid = getCount (key_file, CONFIG_GROUP_SOURCES, *key, sourcesInfo.mMaxSources, &error, 1);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_SOURCES << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setMetricsProperties (metrics::metrics_info_t& metricsInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_METRICS)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_METRICS, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_METRICS_TEXTFILE)) {
+      gchar *path = g_key_file_get_string (key_file, CONFIG_GROUP_METRICS,
+                    CONFIG_GROUP_METRICS_TEXTFILE, &error);
+      CHECK_ERROR (error);
+      metricsInfo.mTextfile = std::string(path);
+      g_free (path);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_METRICS_TEXTFILE_PERIOD)) {
+      valid = getCount (key_file, CONFIG_GROUP_METRICS, *key, metricsInfo.mTextfilePeriodMs, &error, 1);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_METRICS << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setWatchdogProperties (watchdog::watchdog_info_t& watchdogInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_WATCHDOG)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_WATCHDOG, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_WATCHDOG_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_WATCHDOG,
+                    CONFIG_GROUP_WATCHDOG_ENABLE, &error);
+      CHECK_ERROR (error);
+      watchdogInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_WATCHDOG_PERIOD)) {
+      valid = getCount (key_file, CONFIG_GROUP_WATCHDOG, *key, watchdogInfo.mPeriodMs, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_WATCHDOG_STALL)) {
+      valid = getCount (key_file, CONFIG_GROUP_WATCHDOG, *key, watchdogInfo.mStallMs, &error, 1);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_WATCHDOG_RECOVERY_ATTEMPTS)) {
+      valid = getCount (key_file, CONFIG_GROUP_WATCHDOG, *key, watchdogInfo.mRecoveryAttempts, &error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_WATCHDOG_STARTUP)) {
+      valid = getCount (key_file, CONFIG_GROUP_WATCHDOG, *key, watchdogInfo.mStartupMs, &error);
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_WATCHDOG << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+bool setMetaRingProperties (metaring::meta_ring_info_t& ringInfo) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = loadAppConfig (&error);
+  if (nullptr == key_file) {
+    std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    return false;
+  }
+  bool ret = false;
+  gchar **keys = nullptr;
+  if (!g_key_file_has_group (key_file, CONFIG_GROUP_META_RING)) {
+    ret = true;
+    goto done;
+  }
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP_META_RING, nullptr, &error);
+  CHECK_ERROR (error);
+
+  for(gchar** key = keys; *key != nullptr; ++key) {
+    bool valid = true;
+    if (!g_strcmp0 (*key, CONFIG_GROUP_META_RING_ENABLE)) {
+      gboolean enable = g_key_file_get_boolean (key_file, CONFIG_GROUP_META_RING,
+                    CONFIG_GROUP_META_RING_ENABLE, &error);
+      CHECK_ERROR (error);
+      ringInfo.mEnable = enable;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_META_RING_NAME)) {
+      gchar *name = g_key_file_get_string (key_file, CONFIG_GROUP_META_RING,
+                    CONFIG_GROUP_META_RING_NAME, &error);
+      CHECK_ERROR (error);
+      ringInfo.mName = std::string(name);
+      g_free (name);
+      if (ringInfo.mName.size() < 2 || ringInfo.mName[0] != '/' ||
+          ringInfo.mName.find('/', 1) != std::string::npos) {
+        std::cerr << "Invalid value " << ringInfo.mName << " for key '" << *key
+                  << "', expected /name" << std::endl;
+        goto done;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_META_RING_SLOTS)) {
+      valid = getCount (key_file, CONFIG_GROUP_META_RING, *key, ringInfo.mSlots, &error, 1);
+      if (valid && 0 != (ringInfo.mSlots & (ringInfo.mSlots - 1))) {
+        std::cerr << "Invalid value " << ringInfo.mSlots << " for key '" << *key
+                  << "', expected a power of two" << std::endl;
+        valid = false;
+      }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_META_RING_IN_PROCESS)) {
+      gboolean inProcess = g_key_file_get_boolean (key_file, CONFIG_GROUP_META_RING,
+                    CONFIG_GROUP_META_RING_IN_PROCESS, &error);
+      CHECK_ERROR (error);
+      ringInfo.mInProcess = inProcess;
+    } else {
+      std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_META_RING << "]" << std::endl;
+    }
+    CHECK_ERROR (error);
+    if (!valid) {
+      goto done;
+    }
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  if (keys != nullptr) {
+    g_strfreev (keys);
+  }
+  g_key_file_unref (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+} // namespace appparser
@@ -0,0 +1,298 @@
+#include "archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t ALIGNMENT = 8;
+// Longest varint of a 64-bit value
+constexpr std::size_t MAX_VARINT = 10;
+
+std::size_t alignUp(const std::size_t size) {
+  return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+std::uint64_t zigzag(const std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(const std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+std::uint8_t *putVarint(std::uint8_t *out, std::uint64_t value) {
+  while (value >= 0x80) {
+    *out++ = static_cast<std::uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  *out++ = static_cast<std::uint8_t>(value);
+  return out;
+}
+
+bool getVarint(const std::uint8_t *&in, const std::uint8_t *end, std::uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; in != end && shift < 64; shift += 7) {
+    auto byte = *in++;
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (0 == (byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Appends one chunk, padded, and records where it went
+template <typename T>
+void putPlain(const std::vector<T> &values, const std::uint64_t base, std::vector<std::uint8_t> &out,
+  archive::ChunkIndex &chunk) {
+  auto offset = out.size();
+  auto size = values.size() * sizeof(T);
+  out.resize(alignUp(offset + size));
+  if (size) {
+    std::memcpy(out.data() + offset, values.data(), size);
+  }
+  chunk = archive::ChunkIndex{base + offset, static_cast<std::uint32_t>(size), archive::Encoding::Plain,
+    static_cast<std::uint8_t>(sizeof(T)), 0};
+}
+
+template <typename T>
+void putVarints(const std::vector<T> &values, const bool delta, const std::uint64_t base,
+  std::vector<std::uint8_t> &out, archive::ChunkIndex &chunk) {
+  auto offset = out.size();
+  out.resize(offset + values.size() * MAX_VARINT);
+  auto *next = out.data() + offset;
+  std::uint64_t previous = 0;
+  for (const auto value: values) {
+    if (delta) {
+      next = putVarint(next, zigzag(static_cast<std::int64_t>(value - previous)));
+      previous = value;
+    } else {
+      next = putVarint(next, value);
+    }
+  }
+  auto size = static_cast<std::size_t>(next - (out.data() + offset));
+  out.resize(alignUp(offset + size));
+  std::fill(out.begin() + offset + size, out.end(), 0);
+  chunk = archive::ChunkIndex{base + offset, static_cast<std::uint32_t>(size),
+    delta ? archive::Encoding::DeltaVarint : archive::Encoding::Varint, static_cast<std::uint8_t>(sizeof(T)), 0};
+}
+
+template <typename T>
+bool getChunk(const std::uint8_t *base, const archive::ChunkIndex &chunk, const std::size_t rows,
+  std::vector<T> &values) {
+  values.resize(rows);
+  const auto *in = base + chunk.mOffset;
+  const auto *end = in + chunk.mSize;
+  if (sizeof(T) != chunk.mWidth) {
+    return false;
+  }
+  if (archive::Encoding::Plain == chunk.mEncoding) {
+    if (rows * sizeof(T) != chunk.mSize) {
+      return false;
+    }
+    if (rows) {
+      std::memcpy(values.data(), in, chunk.mSize);
+    }
+    return true;
+  }
+  bool delta = archive::Encoding::DeltaVarint == chunk.mEncoding;
+  std::uint64_t previous = 0;
+  for (auto &value: values) {
+    std::uint64_t raw = 0;
+    if (!getVarint(in, end, raw)) {
+      return false;
+    }
+    if (delta) {
+      previous += static_cast<std::uint64_t>(unzigzag(raw));
+      raw = previous;
+    }
+    value = static_cast<T>(raw);
+  }
+  return true;
+}
+
+} // namespace
+
+namespace archive {
+
+void Columns::reserve(const std::size_t rows) {
+  mTime.reserve(rows);
+  mStream.reserve(rows);
+  mEntry.reserve(rows);
+  mExit.reserve(rows);
+  mObjectId.reserve(rows);
+  mClass.reserve(rows);
+  mTravelMs.reserve(rows);
+}
+
+void Columns::clear() {
+  mTime.clear();
+  mStream.clear();
+  mEntry.clear();
+  mExit.clear();
+  mObjectId.clear();
+  mClass.clear();
+  mTravelMs.clear();
+}
+
+void Columns::push(const event_t &event) {
+  mTime.push_back(event.mTime);
+  mStream.push_back(event.mStream);
+  mEntry.push_back(event.mEntry);
+  mExit.push_back(event.mExit);
+  mObjectId.push_back(event.mObjectId);
+  mClass.push_back(event.mClass);
+  mTravelMs.push_back(event.mTravelMs);
+}
+
+event_t Columns::event(const std::size_t idx) const {
+  return event_t{mTime[idx], mObjectId[idx], mTravelMs[idx], mStream[idx], mClass[idx],
+    mEntry[idx], mExit[idx]};
+}
+
+void encode(const columns_t &columns, const std::uint64_t base, std::vector<std::uint8_t> &out) {
+  BatchIndex index{};
+  index.mMagic = BATCH_MAGIC;
+  index.mRows = static_cast<std::uint32_t>(columns.size());
+  if (columns.size()) {
+    auto range = std::minmax_element(columns.mTime.begin(), columns.mTime.end());
+    index.mFirstTime = *range.first;
+    index.mLastTime = *range.second;
+  }
+  out.resize(sizeof(BatchIndex));
+  putVarints(columns.mTime, true, base, out, index.mChunks[TIME]);
+  putPlain(columns.mStream, base, out, index.mChunks[STREAM]);
+  putPlain(columns.mEntry, base, out, index.mChunks[ENTRY]);
+  putPlain(columns.mExit, base, out, index.mChunks[EXIT]);
+  putVarints(columns.mObjectId, true, base, out, index.mChunks[OBJECT_ID]);
+  putPlain(columns.mClass, base, out, index.mChunks[CLASS]);
+  putVarints(columns.mTravelMs, false, base, out, index.mChunks[TRAVEL_MS]);
+  std::memcpy(out.data(), &index, sizeof(index));
+}
+
+ArchiveReader::ArchiveReader(const std::string &path):
+  mPath{path},
+  mBase{nullptr},
+  mSize{0},
+  mRecovered{false}
+{
+  int fd = open(mPath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_FILE) + ": " + mPath);
+  }
+  struct stat st{};
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_FILE) + ": " + mPath);
+  }
+  mSize = static_cast<std::size_t>(st.st_size);
+  FileHeader header{};
+  if (mSize >= sizeof(header)) {
+    void *base = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == base) {
+      close(fd);
+      throw std::runtime_error(std::string(ERR_MSG_MAP_FILE) + ": " + mPath);
+    }
+    mBase = static_cast<const std::uint8_t*>(base);
+    // Batches are read front to back
+    madvise(base, mSize, MADV_SEQUENTIAL);
+    std::memcpy(&header, mBase, sizeof(header));
+  }
+  close(fd);
+  if (MAGIC != header.mMagic || VERSION != header.mVersion || COLUMNS != header.mColumns) {
+    if (mBase) {
+      munmap(const_cast<std::uint8_t*>(mBase), mSize);
+    }
+    throw std::runtime_error(std::string(ERR_MSG_FORMAT) + ": " + mPath);
+  }
+  if (!readFooter()) {
+    mRecovered = true;
+    walkBatches();
+  }
+}
+
+ArchiveReader::~ArchiveReader() {
+  munmap(const_cast<std::uint8_t*>(mBase), mSize);
+}
+
+bool ArchiveReader::validChunk(const ChunkIndex &chunk) const {
+  return chunk.mOffset >= sizeof(FileHeader) && chunk.mOffset <= mSize &&
+    chunk.mSize <= mSize - chunk.mOffset && 0 == chunk.mOffset % ALIGNMENT;
+}
+
+bool ArchiveReader::readFooter() {
+  if (mSize < sizeof(FileHeader) + sizeof(Trailer)) {
+    return false;
+  }
+  Trailer trailer{};
+  std::memcpy(&trailer, mBase + mSize - sizeof(trailer), sizeof(trailer));
+  auto indexSize = static_cast<std::uint64_t>(trailer.mBatches) * sizeof(BatchIndex);
+  if (MAGIC != trailer.mMagic || VERSION != trailer.mVersion ||
+      trailer.mIndexOffset + indexSize + sizeof(trailer) != mSize) {
+    return false;
+  }
+  mIndex.resize(trailer.mBatches);
+  if (indexSize) {
+    std::memcpy(mIndex.data(), mBase + trailer.mIndexOffset, indexSize);
+  }
+  for (const auto &batch: mIndex) {
+    for (const auto &chunk: batch.mChunks) {
+      if (BATCH_MAGIC != batch.mMagic || !validChunk(chunk)) {
+        mIndex.clear();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ArchiveReader::walkBatches() {
+  mIndex.clear();
+  std::size_t offset = sizeof(FileHeader);
+  while (offset + sizeof(BatchIndex) <= mSize) {
+    BatchIndex batch;
+    std::memcpy(&batch, mBase + offset, sizeof(batch));
+    if (BATCH_MAGIC != batch.mMagic) {
+      return;
+    }
+    std::size_t next = offset + sizeof(batch);
+    for (const auto &chunk: batch.mChunks) {
+      if (!validChunk(chunk)) {
+        return;
+      }
+      next = std::max(next, alignUp(chunk.mOffset + chunk.mSize));
+    }
+    mIndex.push_back(batch);
+    offset = next;
+  }
+}
+
+bool ArchiveReader::decode(const std::size_t idx, columns_t &columns, const std::uint32_t select) const {
+  const auto &batch = mIndex[idx];
+  auto rows = batch.mRows;
+  auto wanted = [select](const Column column) { return 0 != (select & (1U << column)); };
+  return (!wanted(TIME) || getChunk(mBase, batch.mChunks[TIME], rows, columns.mTime)) &&
+    (!wanted(STREAM) || getChunk(mBase, batch.mChunks[STREAM], rows, columns.mStream)) &&
+    (!wanted(ENTRY) || getChunk(mBase, batch.mChunks[ENTRY], rows, columns.mEntry)) &&
+    (!wanted(EXIT) || getChunk(mBase, batch.mChunks[EXIT], rows, columns.mExit)) &&
+    (!wanted(OBJECT_ID) || getChunk(mBase, batch.mChunks[OBJECT_ID], rows, columns.mObjectId)) &&
+    (!wanted(CLASS) || getChunk(mBase, batch.mChunks[CLASS], rows, columns.mClass)) &&
+    (!wanted(TRAVEL_MS) || getChunk(mBase, batch.mChunks[TRAVEL_MS], rows, columns.mTravelMs));
+}
+
+const void *ArchiveReader::plain(const std::size_t idx, const Column column) const {
+  const auto &chunk = mIndex[idx].mChunks[column];
+  if (Encoding::Plain != chunk.mEncoding) {
+    return nullptr;
+  }
+  return mBase + chunk.mOffset;
+}
+
+} // namespace archive
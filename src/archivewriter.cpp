@@ -0,0 +1,216 @@
+#include "archivewriter.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <experimental/filesystem>
+#include <stdexcept>
+
+#include "logger.h"
+#include "placement.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace {
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+constexpr std::uint64_t NSEC_PER_HOUR = 3600 * NSEC_PER_SEC;
+constexpr auto FILE_PREFIX = "crossings-";
+constexpr auto FILE_SUFFIX = ".vtoc";
+} // namespace
+
+namespace archive {
+
+ArchiveWriter::ArchiveWriter(const archive_info_t &info):
+  mInfo{info},
+  mFlushAfter{static_cast<std::uint64_t>(info.mFlushSeconds) * NSEC_PER_SEC},
+  mOpen{nullptr},
+  mStopping{false},
+  mFd{-1},
+  mFileHour{0},
+  mOffset{0},
+  mArchived{0},
+  mDropped{0}
+{
+  if (0 == info.mBatchRows || 0 == info.mBatches || 0 == info.mFlushSeconds) {
+    throw std::invalid_argument(ERR_MSG_BATCHES);
+  }
+  std::error_code error;
+  fs::create_directories(mInfo.mDirectory, error);
+  if (error) {
+    throw std::runtime_error(std::string(ERR_MSG_DIRECTORY) + ": " + mInfo.mDirectory);
+  }
+  mPool.resize(info.mBatches);
+  mFree.reserve(info.mBatches);
+  mFull.reserve(info.mBatches);
+  for (auto &batch: mPool) {
+    batch.mColumns.reserve(info.mBatchRows);
+    mFree.push_back(&batch);
+  }
+  mThread = std::thread(&ArchiveWriter::run, this);
+}
+
+ArchiveWriter::~ArchiveWriter() {
+  if (mOpen) {
+    handOff();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWake.notify_one();
+  mThread.join();
+}
+
+void ArchiveWriter::append(const event_t &event) {
+  auto hour = event.mTime / NSEC_PER_HOUR;
+  if (mOpen && mOpen->mHour != hour) {
+    // Files never share a batch
+    handOff();
+  }
+  if (!mOpen) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFree.empty()) {
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+      LOG_WARN("Archive is behind, crossing of obj {} dropped", event.mObjectId);
+      return;
+    }
+    mOpen = mFree.back();
+    mFree.pop_back();
+    mOpen->mHour = hour;
+    mOpen->mOpened = event.mTime;
+  }
+  mOpen->mColumns.push(event);
+  if (mOpen->mColumns.size() >= mInfo.mBatchRows) {
+    handOff();
+  }
+}
+
+void ArchiveWriter::tick(const std::uint64_t now) {
+  if (mOpen && now >= mOpen->mOpened + mFlushAfter) {
+    handOff();
+  }
+}
+
+void ArchiveWriter::handOff() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFull.push_back(mOpen);
+  }
+  mOpen = nullptr;
+  mWake.notify_one();
+}
+
+void ArchiveWriter::run() {
+  placement::placeWorker("archive");
+  for (;;) {
+    Batch *batch = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [this]() { return mStopping || !mFull.empty(); });
+      if (mFull.empty()) {
+        break;
+      }
+      batch = mFull.front();
+      mFull.erase(mFull.begin());
+    }
+    write(*batch);
+    batch->mColumns.clear();
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(batch);
+  }
+  closeFile();
+}
+
+void ArchiveWriter::write(Batch &batch) {
+  auto rows = batch.mColumns.size();
+  if (mFd >= 0 && mFileHour != batch.mHour) {
+    closeFile();
+  }
+  if (mFd < 0) {
+    openFile(batch.mHour);
+  }
+  if (mFd < 0) {
+    mDropped.fetch_add(rows, std::memory_order_relaxed);
+    return;
+  }
+  encode(batch.mColumns, mOffset, mScratch);
+  if (!writeAll(mScratch.data(), mScratch.size())) {
+    LOG_ERROR("Unable to write archive batch: {}", std::strerror(errno));
+    mDropped.fetch_add(rows, std::memory_order_relaxed);
+    // Readers walk the batches written so far
+    close(mFd);
+    mFd = -1;
+    return;
+  }
+  BatchIndex index;
+  std::memcpy(&index, mScratch.data(), sizeof(index));
+  mIndex.push_back(index);
+  mOffset += mScratch.size();
+  mArchived.fetch_add(rows, std::memory_order_relaxed);
+}
+
+void ArchiveWriter::openFile(const std::uint64_t hour) {
+  time_t seconds = static_cast<time_t>(hour * NSEC_PER_HOUR / NSEC_PER_SEC);
+  struct tm tm{};
+  gmtime_r(&seconds, &tm);
+  char stamp[32];
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H", &tm);
+  // A restart within the hour starts a file of its own
+  std::string path;
+  for (unsigned part = 0; mFd < 0; ++part) {
+    path = mInfo.mDirectory + "/" + FILE_PREFIX + stamp + (part ? "-" + std::to_string(part) : "") + FILE_SUFFIX;
+    mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (mFd < 0 && EEXIST != errno) {
+      LOG_ERROR("Unable to create archive file {}: {}", path, std::strerror(errno));
+      return;
+    }
+  }
+  FileHeader header{MAGIC, VERSION, COLUMNS};
+  mFileHour = hour;
+  mOffset = 0;
+  mIndex.clear();
+  if (!writeAll(&header, sizeof(header))) {
+    LOG_ERROR("Unable to write archive file {}: {}", path, std::strerror(errno));
+    close(mFd);
+    mFd = -1;
+    return;
+  }
+  mOffset = sizeof(header);
+  LOG_INFO("Archiving crossings to {}", path);
+}
+
+void ArchiveWriter::closeFile() {
+  if (mFd < 0) {
+    return;
+  }
+  Trailer trailer{mOffset, static_cast<std::uint32_t>(mIndex.size()), VERSION, MAGIC};
+  if (!writeAll(mIndex.data(), mIndex.size() * sizeof(BatchIndex)) ||
+      !writeAll(&trailer, sizeof(trailer))) {
+    LOG_ERROR("Unable to write archive footer: {}", std::strerror(errno));
+  }
+  fdatasync(mFd);
+  close(mFd);
+  mFd = -1;
+}
+
+bool ArchiveWriter::writeAll(const void *data, const std::size_t size) {
+  const auto *next = static_cast<const std::uint8_t*>(data);
+  std::size_t left = size;
+  while (left > 0) {
+    auto written = ::write(mFd, next, left);
+    if (written < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      return false;
+    }
+    next += written;
+    left -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+} // namespace archive
@@ -0,0 +1,101 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr std::size_t MAX_SPILLS_KEPT = 16;
+constexpr std::size_t MIN_TEXT_GROWTH = 64;
+} // namespace
+
+namespace arena {
+
+Arena::Arena(const std::size_t capacity):
+  mCapacity{capacity},
+  mUsed{0},
+  mHighWater{0},
+  mLast{nullptr},
+  mSpills{0}
+{
+  if (0 == capacity) {
+    throw std::invalid_argument(ERR_MSG_ARENA_CAPACITY);
+  }
+  mBlock.reset(new char[capacity]);
+  mSpilled.reserve(MAX_SPILLS_KEPT);
+}
+
+void *Arena::allocate(const std::size_t size, const std::size_t align) {
+  auto base = reinterpret_cast<std::uintptr_t>(mBlock.get());
+  auto start = (base + mUsed + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+  auto offset = static_cast<std::size_t>(start - base);
+  if (offset + size <= mCapacity) {
+    mUsed = offset + size;
+    mHighWater = std::max(mHighWater, mUsed);
+    mLast = mBlock.get() + offset;
+    return mLast;
+  }
+  // operator new[] memory is aligned for any fundamental type
+  ++mSpills;
+  mSpilled.emplace_back(new char[size]);
+  return mSpilled.back().get();
+}
+
+bool Arena::extend(void *block, const std::size_t size, const std::size_t newSize) {
+  if (block != mLast || nullptr == mLast) {
+    return false;
+  }
+  auto offset = static_cast<std::size_t>(mLast - mBlock.get());
+  if (offset + size != mUsed || offset + newSize > mCapacity) {
+    return false;
+  }
+  mUsed = offset + newSize;
+  mHighWater = std::max(mHighWater, mUsed);
+  return true;
+}
+
+void Arena::reset() {
+  mUsed = 0;
+  mLast = nullptr;
+  mSpilled.clear();
+}
+
+TextBuffer::TextBuffer(Arena &arena, const std::size_t reserve):
+  mArena{arena}
+{
+  auto begin = static_cast<char*>(mArena.allocate(reserve, 1));
+  setp(begin, begin + reserve);
+}
+
+TextBuffer::int_type TextBuffer::overflow(int_type ch) {
+  if (traits_type::eq_int_type(ch, traits_type::eof())) {
+    return traits_type::not_eof(ch);
+  }
+  if (!this->grow(std::max(2 * static_cast<std::size_t>(epptr() - pbase()), MIN_TEXT_GROWTH))) {
+    return traits_type::eof();
+  }
+  *pptr() = traits_type::to_char_type(ch);
+  pbump(1);
+  return ch;
+}
+
+bool TextBuffer::grow(const std::size_t capacity) {
+  auto begin = pbase();
+  auto used = this->size();
+  auto current = static_cast<std::size_t>(epptr() - begin);
+  if (!mArena.extend(begin, current, capacity)) {
+    auto moved = static_cast<char*>(mArena.allocate(capacity, 1));
+    if (nullptr == moved) {
+      return false;
+    }
+    if (used) {
+      std::memcpy(moved, begin, used);
+    }
+    begin = moved;
+  }
+  setp(begin, begin + capacity);
+  pbump(static_cast<int>(used));
+  return true;
+}
+
+} // namespace arena
@@ -0,0 +1,190 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <iostream>
+
+namespace {
+
+constexpr std::uint64_t CHECKPOINT_MAGIC = 0x31544b43444f5456ULL; // "VTODCKT1"
+constexpr std::uint32_t CHECKPOINT_VERSION = 1;
+constexpr std::size_t PAGE_SIZE = 4096;
+
+struct FileHeader {
+  std::uint64_t mMagic;
+  std::uint32_t mVersion;
+  std::uint32_t mReserved;
+  std::uint64_t mSlotSize;
+};
+
+struct SlotHeader {
+  std::atomic<std::uint64_t> mGeneration;  // 0 while the slot is being written
+  std::uint64_t mSize;
+  std::uint64_t mChecksum;
+  std::uint64_t mReserved;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Slot generations must be lock-free in shared memory");
+
+std::size_t roundUp(const std::size_t size) {
+  return (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+std::size_t slotStride(const std::size_t slotSize) {
+  return roundUp(sizeof(SlotHeader) + slotSize);
+}
+
+std::size_t fileSize(const std::size_t slotSize) {
+  return PAGE_SIZE + 2 * slotStride(slotSize);
+}
+
+SlotHeader *slotAt(std::uint8_t *base, const std::size_t slotSize, const std::uint64_t generation) {
+  return reinterpret_cast<SlotHeader*>(base + PAGE_SIZE + (generation % 2) * slotStride(slotSize));
+}
+
+std::uint64_t checksum(const std::uint8_t *data, const std::size_t size) {
+  // FNV-1a
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    hash ^= data[idx];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+} // namespace
+
+namespace checkpoint {
+
+CheckpointFile::CheckpointFile(const std::string &path, const std::size_t slotSize):
+  mPath{path},
+  mSlotSize{slotSize},
+  mFd{-1},
+  mBase{nullptr},
+  mMappedSize{0},
+  mGeneration{0}
+{
+  mFd = open(mPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (mFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_FILE) + ": " + mPath);
+  }
+  // Keep the layout of an existing checkpoint so it can still be restored
+  // after a configuration change; the file is resized on the first write.
+  struct stat st{};
+  FileHeader header{};
+  if (0 == fstat(mFd, &st) && static_cast<std::size_t>(st.st_size) >= PAGE_SIZE &&
+      sizeof(header) == pread(mFd, &header, sizeof(header), 0) &&
+      CHECKPOINT_MAGIC == header.mMagic && CHECKPOINT_VERSION == header.mVersion &&
+      static_cast<std::size_t>(st.st_size) >= fileSize(header.mSlotSize)) {
+    this->map(header.mSlotSize);
+    for (std::uint64_t idx = 0; idx < 2; ++idx) {
+      auto *slot = slotAt(mBase, header.mSlotSize, idx);
+      auto generation = slot->mGeneration.load(std::memory_order_acquire);
+      mGeneration = std::max(mGeneration, generation);
+    }
+  } else {
+    this->map(mSlotSize);
+  }
+}
+
+CheckpointFile::~CheckpointFile() {
+  if (nullptr != mBase) {
+    msync(mBase, mMappedSize, MS_SYNC);
+  }
+  this->unmap();
+  if (mFd >= 0) {
+    close(mFd);
+  }
+}
+
+void CheckpointFile::map(const std::size_t slotSize) {
+  this->unmap();
+  auto size = fileSize(slotSize);
+  struct stat st{};
+  bool fresh = 0 != fstat(mFd, &st) || static_cast<std::size_t>(st.st_size) < size;
+  if (fresh && 0 != ftruncate(mFd, size)) {
+    throw std::runtime_error(std::string(ERR_MSG_RESIZE_FILE) + ": " + mPath);
+  }
+  void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+  if (MAP_FAILED == base) {
+    throw std::runtime_error(std::string(ERR_MSG_MAP_FILE) + ": " + mPath);
+  }
+  mBase = static_cast<std::uint8_t*>(base);
+  mMappedSize = size;
+  auto *header = reinterpret_cast<FileHeader*>(mBase);
+  if (CHECKPOINT_MAGIC != header->mMagic || header->mSlotSize != slotSize) {
+    header->mMagic = CHECKPOINT_MAGIC;
+    header->mVersion = CHECKPOINT_VERSION;
+    header->mSlotSize = slotSize;
+    for (std::uint64_t idx = 0; idx < 2; ++idx) {
+      slotAt(mBase, slotSize, idx)->mGeneration.store(0, std::memory_order_relaxed);
+    }
+    msync(mBase, mMappedSize, MS_SYNC);
+  }
+}
+
+void CheckpointFile::unmap() {
+  if (nullptr != mBase) {
+    munmap(mBase, mMappedSize);
+    mBase = nullptr;
+    mMappedSize = 0;
+  }
+}
+
+bool CheckpointFile::restore(std::vector<std::uint8_t> &state, std::uint64_t &generation) const {
+  auto *header = reinterpret_cast<const FileHeader*>(mBase);
+  SlotHeader *latest = nullptr;
+  std::uint64_t latestGeneration = 0;
+  for (std::uint64_t idx = 0; idx < 2; ++idx) {
+    auto *slot = slotAt(mBase, header->mSlotSize, idx);
+    auto slotGeneration = slot->mGeneration.load(std::memory_order_acquire);
+    if (0 == slotGeneration || slotGeneration <= latestGeneration ||
+        slot->mSize > header->mSlotSize) {
+      continue;
+    }
+    auto *data = reinterpret_cast<const std::uint8_t*>(slot + 1);
+    if (slot->mChecksum != checksum(data, slot->mSize)) {
+      std::cerr << "Checkpoint generation " << slotGeneration << " is corrupt, skipping" << std::endl;
+      continue;
+    }
+    latest = slot;
+    latestGeneration = slotGeneration;
+  }
+  if (nullptr == latest) {
+    return false;
+  }
+  auto *data = reinterpret_cast<const std::uint8_t*>(latest + 1);
+  state.assign(data, data + latest->mSize);
+  generation = latestGeneration;
+  return true;
+}
+
+void CheckpointFile::write(const std::vector<std::uint8_t> &state) {
+  if (reinterpret_cast<FileHeader*>(mBase)->mSlotSize != mSlotSize) {
+    this->map(mSlotSize);
+  }
+  if (state.size() > mSlotSize) {
+    throw std::length_error(ERR_MSG_STATE_SIZE);
+  }
+  auto next = mGeneration + 1;
+  auto *slot = slotAt(mBase, mSlotSize, next);
+  slot->mGeneration.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  auto *data = reinterpret_cast<std::uint8_t*>(slot + 1);
+  std::memcpy(data, state.data(), state.size());
+  slot->mSize = state.size();
+  slot->mChecksum = checksum(data, state.size());
+  slot->mGeneration.store(next, std::memory_order_release);
+  // The page cache survives a process crash; MS_ASYNC only schedules the
+  // write back so the caller never waits on the disk.
+  msync(mBase, mMappedSize, MS_ASYNC);
+  mGeneration = next;
+}
+
+} // namespace checkpoint
@@ -0,0 +1,95 @@
+#include "configwatch.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "logger.h"
+#include "placement.h"
+
+namespace {
+constexpr auto POLL_TIMEOUT_MS = 100;
+// Written in place or saved to a temporary and renamed over
+constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+} // namespace
+
+namespace configwatch {
+
+ConfigWatcher::ConfigWatcher(const std::string &directory, const config_watch_info_t &info,
+  const changed_t &changed):
+  mDirectory{directory},
+  mInfo{info},
+  mChanged{changed},
+  mInotifyFd{-1},
+  mEndPolling{false}
+{
+  mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (mInotifyFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_INOTIFY) + ": " + std::strerror(errno));
+  }
+  if (inotify_add_watch(mInotifyFd, mDirectory.c_str(), WATCH_MASK) < 0) {
+    auto err = errno;
+    close(mInotifyFd);
+    throw std::runtime_error(std::string(ERR_MSG_WATCH) + " " + mDirectory + ": " + std::strerror(err));
+  }
+  mThread = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+  mEndPolling = true;
+  mThread.join();
+  close(mInotifyFd);
+}
+
+void ConfigWatcher::run() {
+  placement::placeWorker("configwatch");
+  const auto settle = std::chrono::milliseconds(mInfo.mSettleMs);
+  while (!mEndPolling) {
+    pollfd pfd{mInotifyFd, POLLIN, 0};
+    if (poll(&pfd, 1, POLL_TIMEOUT_MS) > 0) {
+      this->readEvents();
+    }
+    auto now = steady_clock_t::now();
+    for (auto file = mPending.begin(); file != mPending.end();) {
+      if (now - file->second < settle) {
+        ++file;
+        continue;
+      }
+      auto name = file->first;
+      file = mPending.erase(file);
+      mChanged(name);
+    }
+  }
+}
+
+void ConfigWatcher::readEvents() {
+  alignas(inotify_event) char buffer[4096];
+  for (;;) {
+    auto length = read(mInotifyFd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      if (length < 0 && EAGAIN != errno && EINTR != errno) {
+        LOG_ERROR("Unable to read config changes: {}", std::strerror(errno));
+      }
+      return;
+    }
+    for (char *next = buffer; next < buffer + length;) {
+      const auto *event = reinterpret_cast<const inotify_event*>(next);
+      next += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_IGNORED) {
+        LOG_ERROR("Config directory {} is gone, no more reloads", mDirectory);
+        mEndPolling = true;
+        return;
+      }
+      if (0 == event->len || !(event->mask & WATCH_MASK)) {
+        continue;
+      }
+      mPending[event->name] = steady_clock_t::now();
+    }
+  }
+}
+
+} // namespace configwatch
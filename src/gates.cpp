@@ -0,0 +1,130 @@
+#include "gates.h"
+#include "gatenames.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+static_assert(N == gates::COUNT, "The crossings matrix has a row per gate");
+
+constexpr auto CONFIG_GROUP_LINE_CROSSING_PREFIX = "line-crossing-stream-";
+constexpr auto CONFIG_KEY_LINE_CROSSING_PREFIX = "line-crossing-";
+constexpr auto CONFIG_KEY_ENABLE = "enable";
+// Direction then line, two points each
+constexpr gsize LINE_COORDINATES = 8;
+
+using key_file_t = std::unique_ptr<GKeyFile, decltype(&g_key_file_free)>;
+
+std::string takeMessage(GError *error) {
+  std::string message = error->message;
+  g_error_free (error);
+  return message;
+}
+
+} // namespace
+
+namespace gates {
+
+const char *name(const std::size_t gate) {
+  return gate < COUNT ? NAMES[gate] : "";
+}
+
+std::size_t index(const char *gate, const std::size_t length) {
+  for (std::size_t idx = 0; idx < COUNT; ++idx) {
+    if (length == std::strlen(NAMES[idx]) && 0 == std::strncmp(gate, NAMES[idx], length)) {
+      return idx;
+    }
+  }
+  return N;
+}
+
+GateRegistry::GateRegistry(const std::string &path):
+  mLineCount{0}
+{
+  key_file_t keyFile{g_key_file_new (), g_key_file_free};
+  GError *error = nullptr;
+  if (!g_key_file_load_from_file (keyFile.get(), path.c_str(), G_KEY_FILE_NONE, &error)) {
+    throw std::invalid_argument(std::string(ERR_MSG_LOAD) + " " + path + ": " + takeMessage(error));
+  }
+  gchar **groups = g_key_file_get_groups (keyFile.get(), nullptr);
+  std::unique_ptr<gchar*, decltype(&g_strfreev)> groupsGuard{groups, g_strfreev};
+  for (gchar **group = groups; *group != nullptr; ++group) {
+    if (!g_str_has_prefix (*group, CONFIG_GROUP_LINE_CROSSING_PREFIX)) {
+      continue;
+    }
+    const char *id = *group + std::strlen(CONFIG_GROUP_LINE_CROSSING_PREFIX);
+    char *end = nullptr;
+    auto source = std::strtoul(id, &end, 10);
+    if (end == id || '\0' != *end) {
+      continue;
+    }
+    if (g_key_file_has_key (keyFile.get(), *group, CONFIG_KEY_ENABLE, nullptr) &&
+        !g_key_file_get_boolean (keyFile.get(), *group, CONFIG_KEY_ENABLE, nullptr)) {
+      continue;
+    }
+    gchar **keys = g_key_file_get_keys (keyFile.get(), *group, nullptr, &error);
+    if (nullptr == keys) {
+      throw std::invalid_argument(std::string(ERR_MSG_LOAD) + " " + path + ": " + takeMessage(error));
+    }
+    std::unique_ptr<gchar*, decltype(&g_strfreev)> keysGuard{keys, g_strfreev};
+    for (gchar **key = keys; *key != nullptr; ++key) {
+      if (!g_str_has_prefix (*key, CONFIG_KEY_LINE_CROSSING_PREFIX)) {
+        continue;
+      }
+      const char *label = *key + std::strlen(CONFIG_KEY_LINE_CROSSING_PREFIX);
+      auto gate = index(label, std::strcspn(label, "-"));
+      if (gate >= N) {
+        continue;
+      }
+      // nvdsanalytics would take the file and stop counting on that line
+      gsize count = 0;
+      gint *points = g_key_file_get_integer_list (keyFile.get(), *group, *key, &count, &error);
+      g_free (points);
+      if (nullptr != error) {
+        throw std::invalid_argument(std::string(ERR_MSG_LINE) + ": " + *key + ": " + takeMessage(error));
+      }
+      if (LINE_COORDINATES != count) {
+        throw std::invalid_argument(std::string(ERR_MSG_LINE) + ": " + *key);
+      }
+      if (source >= mStreams.size()) {
+        mStreams.resize(source + 1);
+      }
+      mStreams[source].push_back(Line{label, gate});
+      ++mLineCount;
+    }
+  }
+  if (0 == mLineCount) {
+    throw std::invalid_argument(std::string(ERR_MSG_NO_LINES) + ": " + path);
+  }
+}
+
+GateRegistry::GateRegistry(const std::string &path, const guint streams):
+  GateRegistry(path)
+{
+  if (mStreams.size() < streams) {
+    mStreams.resize(streams);
+  }
+  for (std::size_t source = 1; source < streams; ++source) {
+    if (mStreams[source].empty()) {
+      mStreams[source] = mStreams[0];
+      mLineCount += mStreams[0].size();
+    }
+  }
+}
+
+std::size_t GateRegistry::gate(const guint source, const std::string &label) const {
+  if (source >= mStreams.size()) {
+    return N;
+  }
+  for (const auto &line: mStreams[source]) {
+    if (line.mLabel == label) {
+      return line.mGate;
+    }
+  }
+  return N;
+}
+
+} // namespace gates
@@ -0,0 +1,113 @@
+#include "intervalcontroller.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+// Weight of the newest sample in the moving averages
+constexpr auto SMOOTHING = 0.5;
+// Cap on how far a failed step down pushes out the next one, in holds
+constexpr std::uint32_t MAX_BACKOFF = 16;
+
+double smooth(const double average, const double sample) {
+  return average + SMOOTHING * (sample - average);
+}
+} // namespace
+
+namespace intervalcontrol {
+
+IntervalController::IntervalController(const interval_control_info_t &info):
+  mInfo{info},
+  mSmoothed{0.0, 0.0, 0.0},
+  mStarted{false},
+  mLoadInterval{info.mMinInterval},
+  mInterval{info.mMinInterval},
+  mUpStreak{0},
+  mDownStreak{0},
+  mQuietStreak{0},
+  mCooldown{0},
+  mDownHold{std::max<std::uint32_t>(info.mHold, 1)},
+  mProbation{0},
+  mQuiet{false},
+  mReason{"start"}
+{
+  if (info.mMinInterval > info.mQuietInterval || info.mQuietInterval > info.mMaxInterval) {
+    throw std::invalid_argument(ERR_MSG_INTERVAL_BOUNDS);
+  }
+  if (info.mQueueLow >= info.mQueueHigh || info.mLatencyLowMs >= info.mLatencyHighMs) {
+    throw std::invalid_argument(ERR_MSG_LOAD_BOUNDS);
+  }
+  mInfo.mHold = std::max<std::uint32_t>(mInfo.mHold, 1);
+}
+
+bool IntervalController::update(const load_sample_t &sample) {
+  if (mStarted) {
+    mSmoothed.mQueueFill = smooth(mSmoothed.mQueueFill, sample.mQueueFill);
+    mSmoothed.mLatencyMs = smooth(mSmoothed.mLatencyMs, sample.mLatencyMs);
+    mSmoothed.mObjects = smooth(mSmoothed.mObjects, sample.mObjects);
+  } else {
+    mSmoothed = sample;
+    mStarted = true;
+  }
+
+  bool overloaded = mSmoothed.mQueueFill >= mInfo.mQueueHigh ||
+    mSmoothed.mLatencyMs >= mInfo.mLatencyHighMs;
+  bool relaxed = mSmoothed.mQueueFill <= mInfo.mQueueLow &&
+    mSmoothed.mLatencyMs <= mInfo.mLatencyLowMs;
+  auto previous = mInterval;
+  auto loadInterval = this->stepLoad(overloaded, relaxed);
+
+  // Entering quiet waits for hold samples, leaving it takes one raw sample
+  if (sample.mObjects > mInfo.mQuietObjects) {
+    if (mQuiet) {
+      mReason = "traffic";
+    }
+    mQuiet = false;
+    mQuietStreak = 0;
+  } else if (!mQuiet && ++mQuietStreak >= mInfo.mHold) {
+    mQuiet = true;
+    mReason = "quiet";
+  }
+
+  if (loadInterval != mLoadInterval) {
+    mReason = loadInterval > mLoadInterval ? "overload" : "relaxed";
+    mLoadInterval = loadInterval;
+  }
+  mInterval = mQuiet ? std::max(mLoadInterval, mInfo.mQuietInterval) : mLoadInterval;
+  return mInterval != previous;
+}
+
+std::uint32_t IntervalController::stepLoad(const bool overloaded, const bool relaxed) {
+  if (mProbation > 0 && 0 == --mProbation) {
+    // The last step down held, the next one may come quickly again
+    mDownHold = mInfo.mHold;
+  }
+  if (mCooldown > 0) {
+    // Give the queues time to drain and the averages time to follow
+    --mCooldown;
+    return mLoadInterval;
+  }
+  mUpStreak = overloaded ? mUpStreak + 1 : 0;
+  mDownStreak = relaxed ? mDownStreak + 1 : 0;
+  // Falling behind is worse than spending compute, react to it twice as fast
+  if (mUpStreak >= (mInfo.mHold + 1) / 2 && mLoadInterval < mInfo.mMaxInterval) {
+    if (mProbation > 0) {
+      // The lower interval could not keep up, wait longer before retrying
+      // it instead of flapping between the two
+      mDownHold = std::min(mDownHold * 2, mInfo.mHold * MAX_BACKOFF);
+      mProbation = 0;
+    }
+    mUpStreak = 0;
+    mCooldown = mInfo.mHold;
+    return mLoadInterval + 1;
+  }
+  if (mDownStreak >= mDownHold && mLoadInterval > mInfo.mMinInterval) {
+    mDownStreak = 0;
+    mCooldown = mInfo.mHold;
+    mProbation = mDownHold * 2;
+    return mLoadInterval - 1;
+  }
+  return mLoadInterval;
+}
+
+} // namespace intervalcontrol
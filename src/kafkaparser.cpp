@@ -5,10 +5,10 @@
 
 namespace {
 
-constexpr auto KAFKA_CONFIG_FILE = "cfg/kafka_config.txt";
 constexpr auto CONFIG_GROUP_KAFKA = "kafka";
 constexpr auto CONFIG_GROUP_KAFKA_ENDPOINT = "endpoint";
 constexpr auto CONFIG_GROUP_KAFKA_TOPIC = "topic";
+constexpr auto CONFIG_GROUP_KAFKA_PER_EVENT = "per-event";
 
 #define CHECK_ERROR(error) \
   if (error) { \
@@ -47,6 +47,12 @@ bool setKafkaProperties (kafkaproducer::kafka_info_t& kafkaInfo) {
                     CONFIG_GROUP_KAFKA_TOPIC, &error);
       CHECK_ERROR (error);
       kafkaInfo.mTopic = std::string(topic);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_KAFKA_PER_EVENT)) {
+      gboolean perEvent = g_key_file_get_boolean (key_file,
+                    CONFIG_GROUP_KAFKA,
+                    CONFIG_GROUP_KAFKA_PER_EVENT, &error);
+      CHECK_ERROR (error);
+      kafkaInfo.mPerEvent = perEvent;
     } else {
       std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_KAFKA << "]" << std::endl;
     }
@@ -3,6 +3,20 @@
 #include <stdexcept>
 #include <iostream>
 
+#include "metrics.h"
+
+namespace {
+
+// Shared by every producer, a reload keeps counting on the same series
+metrics::Counter &messagesTotal = metrics::counter("vt_kafka_messages_total", "Messages queued for the broker");
+metrics::Counter &bytesTotal = metrics::counter("vt_kafka_bytes_total", "Payload bytes queued for the broker");
+metrics::Counter &produceFailedTotal = metrics::counter("vt_kafka_produce_failed_total",
+  "Messages refused by the producer, mostly a full queue");
+metrics::Counter &errorsTotal = metrics::counter("vt_kafka_errors_total", "Error events of librdkafka");
+metrics::Gauge &queueGauge = metrics::gauge("vt_kafka_queue_messages", "Messages waiting for the broker");
+
+} // namespace
+
 namespace kafkaproducer
 {
 KafkaProducer::KafkaProducer(const std::string &endpoint, const std::string &topic,
@@ -32,6 +46,7 @@ KafkaProducer::KafkaProducer(const std::string &endpoint, const std::string &top
   mThread = std::thread([this]() {
     while (!mEndPooling) {
       mProducer->poll(100);
+      queueGauge.set(mProducer->outq_len());
     }
   });
   this->createTopic(mTopic, [](const std::uint8_t retCode, const std::string& errstr) {
@@ -39,20 +54,43 @@ KafkaProducer::KafkaProducer(const std::string &endpoint, const std::string &top
       throw std::invalid_argument(errstr);
     }
   });
+  mTopicHandle.reset(RdKafka::Topic::create(mProducer.get(), mTopic, nullptr, err));
+  if (nullptr == mTopicHandle.get()) {
+    throw std::invalid_argument(std::string(ERR_MSG_TOPIC_HANDLE) + ": " + err);
+  }
 }
 
 KafkaProducer::~KafkaProducer() {
+  // Deliver what is still queued (e.g. the windows flushed at EOS)
+  mProducer->flush(FLUSH_TIMEOUT_MS);
   mEndPooling = true;
   mThread.join();
+  mTopicHandle.reset();
   mProducer.reset();
 }
 
 bool KafkaProducer::produce(const std::string &message) const {
-  auto err = mProducer->produce(mTopic, RdKafka::Topic::PARTITION_UA,
-    RdKafka::Producer::RK_MSG_COPY,
-    reinterpret_cast<void*>(const_cast<char*>(message.c_str())), message.length(),
-    nullptr, 0, 0, nullptr);
-  return RdKafka::ERR_NO_ERROR == err;
+  return this->produce(message.c_str(), message.length());
+}
+
+bool KafkaProducer::produce(const char *message, const std::size_t length) const {
+  auto err = mProducer->produce(mTopicHandle.get(), RdKafka::Topic::PARTITION_UA,
+    RdKafka::Producer::RK_MSG_COPY, reinterpret_cast<void*>(const_cast<char*>(message)), length,
+    nullptr, nullptr);
+  if (RdKafka::ERR_NO_ERROR != err) {
+    produceFailedTotal.inc();
+    return false;
+  }
+  messagesTotal.inc();
+  bytesTotal.inc(length);
+  return true;
+}
+
+void KafkaProducer::EventCb::event_cb(RdKafka::Event &event) {
+  if (RdKafka::Event::EVENT_ERROR == event.type()) {
+    errorsTotal.inc();
+  }
+  mKafkaCb(event);
 }
 
 void KafkaProducer::createTopic(const std::string &topicName, const topiccb_t &cb) const
@@ -0,0 +1,234 @@
+#include "logger.h"
+
+#include <time.h>
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+#include "placement.h"
+
+namespace {
+
+// Power of two, 1 MB of records in static storage so that statements
+// logged before start() are kept rather than lost.
+constexpr std::size_t RING_SIZE = 4096;
+constexpr std::size_t RING_MASK = RING_SIZE - 1;
+constexpr auto IDLE_SLEEP = std::chrono::milliseconds(2);
+constexpr std::size_t FLUSH_SIZE = 64 * 1024;
+constexpr std::int64_t NSEC_PER_SEC = 1000000000LL;
+
+constexpr std::array<const char*, 5> LEVEL_NAMES{{"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR"}};
+
+// Bounded multi-producer queue (D. Vyukov): every cell carries a sequence
+// number telling producers and the consumer whose turn it is, so claiming
+// a cell is a single CAS and nobody ever waits on a lock.
+struct alignas(64) Cell {
+  std::atomic<std::uint64_t> mSequence;
+  logger::Record mRecord;
+};
+
+std::array<Cell, RING_SIZE> ring;
+alignas(64) std::atomic<std::uint64_t> enqueuePos{0};
+alignas(64) std::uint64_t dequeuePos = 0;
+
+std::atomic<int> level{static_cast<int>(logger::Level::Info)};
+std::atomic<std::uint32_t> rateLimit{0};
+std::atomic<std::uint64_t> dropped{0};
+std::atomic<bool> running{false};
+std::thread worker;
+
+struct RingInit {
+  RingInit() {
+    for (std::size_t idx = 0; idx < RING_SIZE; ++idx) {
+      ring[idx].mSequence.store(idx, std::memory_order_relaxed);
+    }
+  }
+} ringInit;
+
+const char *baseName(const char *path) {
+  const char *slash = std::strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+void appendArg(std::string &out, const logger::Record &record, const std::size_t idx) {
+  char buffer[32];
+  const auto &arg = record.mArgs[idx];
+  switch (record.mTypes[idx]) {
+    case logger::ArgType::INT:
+      snprintf(buffer, sizeof(buffer), "%" PRId64, arg.mInt);
+      out += buffer;
+      break;
+    case logger::ArgType::UINT:
+      snprintf(buffer, sizeof(buffer), "%" PRIu64, arg.mUint);
+      out += buffer;
+      break;
+    case logger::ArgType::DOUBLE:
+      snprintf(buffer, sizeof(buffer), "%g", arg.mDouble);
+      out += buffer;
+      break;
+    case logger::ArgType::BOOL:
+      out += arg.mUint ? "true" : "false";
+      break;
+    case logger::ArgType::TEXT:
+      out.append(record.mText + arg.mText.mOffset, arg.mText.mLength);
+      break;
+  }
+}
+
+void format(std::string &out, const logger::Record &record) {
+  char stamp[64];
+  time_t seconds = static_cast<time_t>(record.mTime / NSEC_PER_SEC);
+  struct tm tm{};
+  localtime_r(&seconds, &tm);
+  auto length = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+  snprintf(stamp + length, sizeof(stamp) - length, ".%06" PRId64 " ",
+    (record.mTime % NSEC_PER_SEC) / 1000);
+  const auto *site = record.mSite;
+  out += stamp;
+  out += LEVEL_NAMES[static_cast<std::size_t>(site->mLevel)];
+  out += " ";
+  out += baseName(site->mFile);
+  out += ":";
+  out += std::to_string(site->mLine);
+  out += " ";
+  std::size_t next = 0;
+  for (const char *c = site->mFormat; *c != '\0'; ++c) {
+    if (c[0] == '{' && c[1] == '}' && next < record.mCount) {
+      appendArg(out, record, next++);
+      ++c;
+    } else {
+      out += *c;
+    }
+  }
+  if (0 != record.mSuppressed) {
+    out += " (";
+    out += std::to_string(record.mSuppressed);
+    out += " similar suppressed)";
+  }
+  out += "\n";
+}
+
+void write(std::string &out, std::FILE *stream) {
+  if (!out.empty()) {
+    std::fwrite(out.data(), 1, out.size(), stream);
+    std::fflush(stream);
+    out.clear();
+  }
+}
+
+// Formats and writes everything queued so far, returns false if idle
+bool drain(std::string &out, std::string &err) {
+  bool busy = false;
+  for (;;) {
+    auto &cell = ring[dequeuePos & RING_MASK];
+    if (cell.mSequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+      break;
+    }
+    const auto &record = cell.mRecord;
+    format(record.mSite->mLevel >= logger::Level::Warn ? err : out, record);
+    cell.mSequence.store(dequeuePos + RING_SIZE, std::memory_order_release);
+    ++dequeuePos;
+    busy = true;
+    if (out.size() > FLUSH_SIZE) {
+      write(out, stdout);
+    }
+    if (err.size() > FLUSH_SIZE) {
+      write(err, stderr);
+    }
+  }
+  auto lost = dropped.exchange(0, std::memory_order_relaxed);
+  if (0 != lost) {
+    err += std::to_string(lost) + " log records dropped, logger ring full\n";
+  }
+  write(out, stdout);
+  write(err, stderr);
+  return busy;
+}
+
+} // namespace
+
+namespace logger {
+
+void start(const log_info_t &logInfo) {
+  level = static_cast<int>(logInfo.mLevel);
+  rateLimit = logInfo.mRateLimit;
+  if (running.exchange(true)) {
+    return;
+  }
+  worker = std::thread([]() {
+    placement::placeWorker("logger");
+    std::string out, err;
+    out.reserve(FLUSH_SIZE * 2);
+    err.reserve(FLUSH_SIZE);
+    while (running.load(std::memory_order_relaxed)) {
+      if (!drain(out, err)) {
+        std::this_thread::sleep_for(IDLE_SLEEP);
+      }
+    }
+    drain(out, err);
+  });
+}
+
+void stop() {
+  if (running.exchange(false)) {
+    worker.join();
+  }
+}
+
+bool enabled(const Level recordLevel) {
+  return static_cast<int>(recordLevel) >= level.load(std::memory_order_relaxed);
+}
+
+bool admit(Site &site, std::uint32_t &suppressed) {
+  auto limit = rateLimit.load(std::memory_order_relaxed);
+  if (0 == limit) {
+    return true;
+  }
+  auto window = now() / NSEC_PER_SEC;
+  auto current = site.mWindow.load(std::memory_order_relaxed);
+  if (current != window &&
+      site.mWindow.compare_exchange_strong(current, window, std::memory_order_relaxed)) {
+    site.mCount.store(0, std::memory_order_relaxed);
+    suppressed = site.mSuppressed.exchange(0, std::memory_order_relaxed);
+  }
+  if (site.mCount.fetch_add(1, std::memory_order_relaxed) >= limit) {
+    site.mSuppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+Record *acquire(std::uint64_t &position) {
+  auto pos = enqueuePos.load(std::memory_order_relaxed);
+  for (;;) {
+    auto &cell = ring[pos & RING_MASK];
+    auto sequence = cell.mSequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::int64_t>(sequence) - static_cast<std::int64_t>(pos);
+    if (0 == diff) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        position = pos;
+        return &cell.mRecord;
+      }
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void commit(Record *, const std::uint64_t position) {
+  ring[position & RING_MASK].mSequence.store(position + 1, std::memory_order_release);
+}
+
+std::int64_t now() {
+  struct timespec ts{};
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<std::int64_t>(ts.tv_sec) * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+} // namespace logger
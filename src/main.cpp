@@ -6,13 +6,39 @@
 #include <librdkafka/rdkafkacpp.h>
 
 #include "kafkaparser.h"
+#include "appparser.h"
+#include "logger.h"
+#include "metrics.h"
+#include "placement.h"
+#include "startup.h"
 #include "vehicletrackingpipeline.h"
 
 namespace {
 
+constexpr auto METRIC_BUS_MESSAGES = "vt_bus_messages_total";
+constexpr auto METRIC_BUS_MESSAGES_HELP = "Pipeline bus messages handled, by type";
+
+metrics::Counter &busMessages(const GstMessageType type) {
+  static auto &eos = metrics::counter(METRIC_BUS_MESSAGES, METRIC_BUS_MESSAGES_HELP, "type=\"eos\"");
+  static auto &error = metrics::counter(METRIC_BUS_MESSAGES, METRIC_BUS_MESSAGES_HELP, "type=\"error\"");
+  static auto &warning = metrics::counter(METRIC_BUS_MESSAGES, METRIC_BUS_MESSAGES_HELP, "type=\"warning\"");
+  static auto &other = metrics::counter(METRIC_BUS_MESSAGES, METRIC_BUS_MESSAGES_HELP, "type=\"other\"");
+  switch (type) {
+    case GST_MESSAGE_EOS:
+      return eos;
+    case GST_MESSAGE_ERROR:
+      return error;
+    case GST_MESSAGE_WARNING:
+      return warning;
+    default:
+      return other;
+  }
+}
+
 gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data)
 {
   GMainLoop *loop = (GMainLoop *) data;
+  busMessages(GST_MESSAGE_TYPE (msg)).inc();
   switch (GST_MESSAGE_TYPE (msg)) {
     case GST_MESSAGE_EOS:
     {
@@ -34,6 +60,16 @@ gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data)
       g_main_loop_quit (loop);
       break;
     }
+    case GST_MESSAGE_STATE_CHANGED:
+    {
+      // Only the pipeline's own, every element posts one
+      GstState state;
+      gst_message_parse_state_changed (msg, nullptr, &state, nullptr);
+      if (GST_STATE_PLAYING == state && GST_IS_PIPELINE (GST_MESSAGE_SRC (msg))) {
+        startup::mark(startup::Phase::Playing);
+      }
+      break;
+    }
     default:
     {
       break;
@@ -43,28 +79,27 @@ gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data)
 }
 
 void kafka_call(RdKafka::Event &event) {
+  // Runs on the producer's poll thread, hand everything to the logger
   switch (event.type()) {
     case RdKafka::Event::EVENT_ERROR:
     {
-      std::cerr << "ERROR (" << RdKafka::err2str(event.err())
-                << "): " << event.str() << std::endl;
+      LOG_ERROR("Kafka ERROR ({}): {}", RdKafka::err2str(event.err()), event.str());
       break;
     }
     case RdKafka::Event::EVENT_STATS:
     {
-      std::cout << "\"STATS\": " << event.str() << std::endl;
+      LOG_DEBUG("Kafka STATS: {}", event.str());
       break;
     }
     case RdKafka::Event::EVENT_LOG:
     {
-      std::cout << "\"LOG\": " << event.str() << std::endl;
+      LOG_INFO("Kafka LOG: {}", event.str());
       break;
     }
     default:
     {
-      std::cout << "EVENT " << event.type() << " ("
-                << RdKafka::err2str(event.err()) << "): " << event.str()
-                << std::endl;
+      LOG_INFO("Kafka EVENT {} ({}): {}", static_cast<int>(event.type()),
+        RdKafka::err2str(event.err()), event.str());
       break;
     }
   }
@@ -85,7 +120,26 @@ int main(int argc, char *argv[])
     return -1;
   }
 
-  vehicletracking::VehicleTrackingPipeline vtp{argc, argv, kafkaInfo};
+  vehicletracking::app_info_t appInfo;
+  if (!appparser::setAppProperties(appInfo)) {
+    std::cerr << "Unable to set application properties" << std::endl;
+    return -1;
+  }
+
+  // Before any thread of ours starts, so that they can be placed
+  try {
+    placement::configure(appInfo.mPlacement);
+  } catch (const std::exception &ex) {
+    std::cerr << "Unable to set thread placement: " << ex.what() << std::endl;
+    return -1;
+  }
+  if (placement::enabled()) {
+    std::cout << "Host: " << placement::describeHost() << std::endl;
+  }
+
+  logger::Logger log{appInfo.mLogging};
+
+  vehicletracking::VehicleTrackingPipeline vtp{argc, argv, kafkaInfo, appInfo};
   auto ret = vtp.initialize(bus_call, kafka_call);
   if (vehicletracking::ERR_SUCCESS != ret) {
     std::cerr << "Unable to initialize vehicle tracking pipeline. Returned error code: " << ret << std::endl;
@@ -94,5 +148,5 @@ int main(int argc, char *argv[])
   vtp.run();
   vtp.printCrossings();
 
-  return 0;
+  return vtp.exitCode();
 }
\ No newline at end of file
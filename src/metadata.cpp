@@ -5,7 +5,28 @@
 #include <utility>
 #include <memory>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
 #include "metadata.h"
+#include "allocaccounting.h"
+#include "archivewriter.h"
+#include "arena.h"
+#include "odcube.h"
+#include "odwindows.h"
+#include "checkpoint.h"
+#include "gates.h"
+#include "logger.h"
+#include "metaring.h"
+#include "metrics.h"
+#include "occupancy.h"
+#include "seqlock.h"
+#include "shmcounters.h"
+#include "startup.h"
+#include "stitcher.h"
+#include "gst-nvevent.h"
 #include "gstnvdsmeta.h"
 #include "nvds_analytics_meta.h"
 #include "nvdsmeta.h"
@@ -18,19 +39,13 @@ constexpr auto MAX_DISPLAY_LEN = 70;
 constexpr auto PGIE_CLASS_ID_BUS = 0;
 constexpr auto PGIE_CLASS_ID_CAR = 1;
 constexpr auto FONT_SERIF = "Serif";
+constexpr auto FPS_PREFIX = "FPS Info: ";
+constexpr auto FPS_CURRENT = "current: ";
+constexpr auto OTHER_CLASS = "other";
 
-constexpr auto CROSSING_N = "N";
-constexpr auto CROSSING_NE = "NE";
-constexpr auto CROSSING_SE = "SE";
-constexpr auto CROSSING_SV = "SV";
-constexpr auto CROSSING_NV = "NV";
-
-constexpr auto CROSSING_IDX_N = 0;
-constexpr auto CROSSING_IDX_NE = 1;
-constexpr auto CROSSING_IDX_SE = 2;
-constexpr auto CROSSING_IDX_SV = 3;
-constexpr auto CROSSING_IDX_NV = 4;
-
+// Per buffer scratch: the crossing labels and the kafka messages. A few
+// dozen lines of text per frame fit comfortably.
+constexpr std::size_t FRAME_ARENA_SIZE = 64 * 1024;
 
 metadata::crossings_t crossings{{
   /*N-Entry*/  {0, 0, 0, 0, 0}, // N-Exit, NE-Exit, SE-Exit, SV-Exit, NV-Exit
@@ -42,10 +57,168 @@ metadata::crossings_t crossings{{
 
 metadata::object_entry_t objEntries;
 
+// The same crossings by stream and class
+odcube::cube_t cube{};
+odcube::cube_info_t cubeInfo;
+
+arena::Arena frameArena{FRAME_ARENA_SIZE};
+
+struct FpsText {
+  char mText[metadata::MAX_FPS_TEXT_LEN];
+};
+// Written by the fps sink whenever it updates its message, so that the
+// probe does not have to copy it out of the element every buffer
+seqlock::SeqLock<FpsText> fpsText;
+
+struct LineCrossing {
+  const char *mName;
+  std::uint64_t mCount;
+};
+
+odwindows::WindowAggregator windowAggregator;
+
+// Written by the probe only, published once per buffer for the stats surface
+metadata::snapshot_t current{};
+seqlock::SeqLock<metadata::snapshot_t> published;
+
+// Scraped, see metrics::prometheusText
+metrics::Counter &buffersTotal = metrics::counter("vt_buffers_total", "Batches through the analytics probe");
+metrics::Counter &framesTotal = metrics::counter("vt_frames_total", "Frames through the analytics probe");
+metrics::Counter &entriesTotal = metrics::counter("vt_entries_total", "Vehicles that crossed an entry line");
+metrics::Counter &exitsTotal = metrics::counter("vt_exits_total", "Vehicles counted from entry to exit");
+metrics::Counter &untrackedTotal = metrics::counter("vt_untracked_total",
+  "Vehicles inside dropped uncounted, tracker restarts and removed sources");
+metrics::Gauge &objectsGauge = metrics::gauge("vt_objects", "Vehicles detected in the last frame");
+metrics::Gauge &pendingGauge = metrics::gauge("vt_pending_entries", "Vehicles entered and not exited yet");
+metrics::Gauge &latencyGauge = metrics::gauge("vt_latency_seconds", "nvstreammux to analytics, last frame");
+metrics::Gauge &fpsGauge = metrics::gauge("vt_output_fps", "Current rate of the fps display sink");
+metrics::Histogram &probeSeconds = metrics::histogram("vt_probe_duration_seconds",
+  "Time spent in the analytics probe per batch",
+  {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05});
+
+constexpr std::uint32_t CHECKPOINT_STATE_VERSION = 6;
+// Older layouts still restored: 16 bit crossing counts in 3, the vehicles
+// inside up to 5 (skipped, their tracker ids are of the old process),
+// without their source before 5
+constexpr std::uint32_t CHECKPOINT_STATE_VERSION_NARROW = 3;
+constexpr std::uint32_t CHECKPOINT_STATE_VERSION_UNSOURCED = 4;
+constexpr std::uint32_t CHECKPOINT_STATE_VERSION_ENTRIES = 5;
+
+std::unique_ptr<checkpoint::CheckpointFile> checkpointFile;
+checkpoint::Encoder checkpointEncoder;
+gint64 checkpointInterval = 0;  // microseconds
+gint64 nextCheckpoint = 0;
+
+// Windows and checkpoints run on stream time: the buffer PTS, shifted after
+// a restore so that it carries on from the restored state when the new
+// stream starts over from zero.
+std::uint64_t restoredStreamTime = 0;
+std::uint64_t ptsBase = 0;
+bool rebasePending = false;
+
+// Set from the main loop by the interval controller
+std::atomic<std::uint32_t> inferInterval{0};
+
+// Site-wide O/D counts, this process' slice of the shared segment
+std::unique_ptr<shmcounters::SharedCounters> sharedCounters;
+
+// Carries entries over tracker id switches, when enabled. One per source,
+// positions seen by different cameras must never match.
+std::unique_ptr<stitching::stitching_info_t> stitchingInfo;
+std::vector<std::unique_ptr<stitching::TrackStitcher>> stitchers;
+
+// Line labels to gates, swapped whole on reload. The probe takes a
+// reference once per buffer.
+std::shared_ptr<const gates::GateRegistry> gateRegistry;
+
+// Kafka producer and what goes through it, swapped whole on reload
+std::shared_ptr<const metadata::sink_t> sink = std::make_shared<const metadata::sink_t>(metadata::sink_t{nullptr, true});
+
+// PTS of the first buffer through a restarted tracker, its ids start over
+std::atomic<GstClockTime> tracksResetAt{GST_CLOCK_TIME_NONE};
+
+// Vehicles per ROI over time, when enabled
+std::unique_ptr<occupancy::OccupancyRecorder> occupancyRecorder;
+
+// Columnar files of every crossing, when enabled
+std::unique_ptr<archive::ArchiveWriter> archiveWriter;
+
+// Frame records for analytics processes, when enabled. Without in-process
+// analytics the probe stops at the records.
+std::unique_ptr<metaring::RingWriter> metaRing;
+bool inProcessAnalytics = true;
+metrics::Counter &ringRecordsTotal = metrics::counter("vt_meta_ring_records_total",
+  "Frame records published to the metadata ring");
+metrics::Counter &ringTruncatedTotal = metrics::counter("vt_meta_ring_truncated_objects_total",
+  "Objects left out of a full frame record");
+
+// System time stamped by nvstreammux (attach-sys-ts), or now
+std::uint64_t wallClock(const NvDsFrameMeta *frame_meta) {
+  return 0 != frame_meta->ntp_timestamp ? frame_meta->ntp_timestamp :
+    static_cast<std::uint64_t>(g_get_real_time ()) * 1000;
+}
+
+// The frame's objects and the gate each crossed, written in place into
+// the next slot of the ring. Returns the number of objects.
+std::uint32_t publishFrame(NvDsFrameMeta * const frame_meta, const gates::GateRegistry *gates) {
+  auto &record = metaRing->claim();
+  record.mPts = frame_meta->buf_pts;
+  record.mWallClock = wallClock(frame_meta);
+  record.mSource = frame_meta->source_id;
+  record.mFrame = static_cast<std::uint32_t>(frame_meta->frame_num);
+  record.mObjects = 0;
+  record.mTruncated = 0;
+  for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != nullptr; l_obj = l_obj->next) {
+    const auto *obj_meta = (NvDsObjectMeta *) (l_obj->data);
+    if (record.mObjects == metaring::MAX_OBJECTS) {
+      ++record.mTruncated;
+      continue;
+    }
+    auto &object = record.mObject[record.mObjects++];
+    object.mId = obj_meta->object_id;
+    object.mLeft = obj_meta->rect_params.left;
+    object.mTop = obj_meta->rect_params.top;
+    object.mWidth = obj_meta->rect_params.width;
+    object.mHeight = obj_meta->rect_params.height;
+    object.mClass = static_cast<std::int16_t>(obj_meta->class_id);
+    object.mGate = metaring::NO_GATE;
+    for (NvDsMetaList *l_user = obj_meta->obj_user_meta_list; l_user != nullptr; l_user = l_user->next) {
+      const auto *user_meta = (NvDsUserMeta *) (l_user->data);
+      if (user_meta->base_meta.meta_type != NVDS_USER_OBJ_META_NVDSANALYTICS) {
+        continue;
+      }
+      const auto *info = (NvDsAnalyticsObjInfo *) user_meta->user_meta_data;
+      auto gate = info->lcStatus.empty() || !gates ? N : gates->gate(frame_meta->source_id, info->lcStatus[0]);
+      if (gate < N) {
+        object.mGate = static_cast<std::uint8_t>(gate);
+      }
+    }
+  }
+  metaRing->publish();
+  ringRecordsTotal.inc();
+  ringTruncatedTotal.inc(record.mTruncated);
+  return record.mObjects + record.mTruncated;
+}
+
+stitching::TrackStitcher *stitcherFor(const guint source) {
+  if (!stitchingInfo) {
+    return nullptr;
+  }
+  if (source >= stitchers.size()) {
+    stitchers.resize(source + 1);
+  }
+  if (!stitchers[source]) {
+    stitchers[source].reset(new stitching::TrackStitcher(*stitchingInfo));
+  }
+  return stitchers[source].get();
+}
+
+// DeepStream g_free()s display_text when it releases the display meta, so
+// the label has to come from the GLib heap and cannot live in the arena
 void setText(NvOSD_TextParams *txt_params, const int xOffset, const int yOffset,
-  const std::string &display_text) {
+  const char *display_text) {
   txt_params->display_text = (char*)g_malloc0 (MAX_DISPLAY_LEN);
-  snprintf(txt_params->display_text, MAX_DISPLAY_LEN, "%s", display_text.c_str());
+  snprintf(txt_params->display_text, MAX_DISPLAY_LEN, "%s", display_text);
   // Now set the offsets where the string should appear
   txt_params->x_offset = xOffset;
   txt_params->y_offset = yOffset;
@@ -64,89 +237,364 @@ void setText(NvOSD_TextParams *txt_params, const int xOffset, const int yOffset,
   txt_params->text_bg_clr.alpha = 1.0;
 }
 
+// Crossings are sorted by name, in arena memory
 void displayInfoToFrame(NvDsBatchMeta *batch_meta, NvDsFrameMeta * const frame_meta,
-  const metadata::display_info_t &displayInfo) {
+  const char *fps, const char *roi, const LineCrossing *crossings, const std::size_t count) {
   NvDsDisplayMeta *display_meta = nullptr;
   int elementsInDisplay = 0;
   int xOffset = 10;
   int yOffset = 12;
   display_meta = nvds_acquire_display_meta_from_pool(batch_meta);
-  display_meta->num_labels = 2 + displayInfo.crossings.size();
 
   NvOSD_TextParams *txt_params_fps  = &display_meta->text_params[elementsInDisplay++];
-  setText(txt_params_fps, xOffset, yOffset, displayInfo.fps);
+  setText(txt_params_fps, xOffset, yOffset, fps);
 
   yOffset += 30;
   xOffset = 10;
   NvOSD_TextParams *txt_params_roi  = &display_meta->text_params[elementsInDisplay++];
-  setText(txt_params_roi, xOffset, yOffset, displayInfo.roi);
+  setText(txt_params_roi, xOffset, yOffset, roi);
+
+  char label[MAX_DISPLAY_LEN];
+  for (std::size_t idx = 0; idx < count && elementsInDisplay < MAX_ELEMENTS_IN_DISPLAY_META - 1; ++idx) {
+    snprintf(label, sizeof(label), "%s = %u", crossings[idx].mName,
+      static_cast<std::uint32_t>(crossings[idx].mCount));
 
-  int offsetIdx = 0;
-  std::stringstream out;
-  for (const auto &crossing: displayInfo.crossings) {
-    if (elementsInDisplay >= MAX_ELEMENTS_IN_DISPLAY_META - 1) {
-      nvds_add_display_meta_to_frame(frame_meta, display_meta);
-      return;
-    }
-    
-    out << crossing.first.c_str() << " = " << crossing.second;
-    
     NvOSD_TextParams *txt_params  = &display_meta->text_params[elementsInDisplay++];
-    if (offsetIdx++ % 2 == 0) {
+    if (idx % 2 == 0) {
       yOffset += 30;
       xOffset = 10;
     } else {
       xOffset += MAX_DISPLAY_LEN + 50;
     }
-    
-    setText(txt_params, xOffset, yOffset, out.str());
-    
-    out.str(""); out.clear();
+
+    setText(txt_params, xOffset, yOffset, label);
   }
 
+  display_meta->num_labels = elementsInDisplay;
   nvds_add_display_meta_to_frame(frame_meta, display_meta);
 }
 
-std::size_t getLCIdxFromString(const std::string& crossing) {
-  std::size_t pos = crossing.find("-");
-  std::string prefix = crossing.substr(0, pos);
-  if (0 == prefix.compare(CROSSING_N)) {
-    return CROSSING_IDX_N;
-  } else if (0 == prefix.compare(CROSSING_NE)) {
-    return CROSSING_IDX_NE;
-  } else if (0 == prefix.compare(CROSSING_SE)) {
-    return CROSSING_IDX_SE;
-  } else if (0 == prefix.compare(CROSSING_SV)) {
-    return CROSSING_IDX_SV;
-  } else if (0 == prefix.compare(CROSSING_NV)) {
-    return CROSSING_IDX_NV;
+// Counts of every line crossing in the frame's analytics metadata, the
+// first one seen wins when several carry the same line
+std::size_t collectCrossings(NvDsFrameMeta * const frame_meta, LineCrossing *&crossings) {
+  std::size_t capacity = 0;
+  for (NvDsMetaList * l_user = frame_meta->frame_user_meta_list; l_user != nullptr; l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+    if (user_meta->base_meta.meta_type == NVDS_USER_FRAME_META_NVDSANALYTICS) {
+      capacity += ((NvDsAnalyticsFrameMeta *) user_meta->user_meta_data)->objLCCumCnt.size();
+    }
+  }
+  crossings = static_cast<LineCrossing*>(frameArena.allocate(capacity * sizeof(LineCrossing),
+    alignof(LineCrossing)));
+  std::size_t count = 0;
+  for (NvDsMetaList * l_user = frame_meta->frame_user_meta_list; l_user != nullptr; l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
+    if (user_meta->base_meta.meta_type != NVDS_USER_FRAME_META_NVDSANALYTICS) {
+      continue;
+    }
+    const auto *meta = (NvDsAnalyticsFrameMeta *) user_meta->user_meta_data;
+    for (const auto &status: meta->objLCCumCnt) {
+      auto known = std::find_if(crossings, crossings + count, [&status](const LineCrossing &crossing) {
+        return 0 == std::strcmp(crossing.mName, status.first.c_str());
+      });
+      if (known == crossings + count) {
+        crossings[count++] = LineCrossing{status.first.c_str(), status.second};
+      }
+    }
+  }
+  std::sort(crossings, crossings + count, [](const LineCrossing &lhs, const LineCrossing &rhs) {
+    return std::strcmp(lhs.mName, rhs.mName) < 0;
+  });
+  return count;
+}
+
+// std::quoted formats long strings through a temporary string stream,
+// this one writes straight into the message
+void quoted(std::ostream &out, const char *text) {
+  out.put('"');
+  for (; '\0' != *text; ++text) {
+    if ('"' == *text || '\\' == *text) {
+      out.put('\\');
+    }
+    out.put(*text);
+  }
+  out.put('"');
+}
+
+void quoted(std::ostream &out, const std::string &text) {
+  quoted(out, text.c_str());
+}
+
+template <typename Matrix>
+void odToJson(std::ostream &out, const Matrix &matrix) {
+  out << "[";
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    out << (entry ? ",[" : "[");
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      out << (exit ? "," : "") << matrix[entry][exit];
+    }
+    out << "]";
+  }
+  out << "]";
+}
+
+template <typename Matrix>
+void matrixToJson(std::ostream &out, const Matrix &matrix) {
+  out << "\"gates\":[";
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    out << (idx ? "," : "") << std::quoted(gates::name(idx));
+  }
+  out << "], \"od\":";
+  odToJson(out, matrix);
+}
+
+// Class and stream slices, the gates come with the matrix they belong to
+void cubeToJson(std::ostream &out, const odcube::cube_t &counts) {
+  auto classTotals = odcube::classTotals(counts);
+  out << "\"by_class\":[";
+  for (std::size_t cls = 0; cls <= cubeInfo.mClasses.size(); ++cls) {
+    out << (cls ? "," : "") << "{\"name\":";
+    quoted(out, cls < cubeInfo.mClasses.size() ? cubeInfo.mClasses[cls].c_str() : OTHER_CLASS);
+    out << ", \"total\":" << classTotals[cls] << ", \"od\":";
+    odToJson(out, odcube::reduce(counts, odcube::ALL, 1U << cls));
+    out << "}";
+  }
+  auto streamTotals = odcube::streamTotals(counts);
+  out << "], \"by_stream\":[";
+  for (std::size_t stream = 0; stream < cubeInfo.mStreams; ++stream) {
+    out << (stream ? "," : "") << "{\"stream\":" << stream;
+    out << ", \"total\":" << streamTotals[stream] << ", \"od\":";
+    odToJson(out, odcube::reduce(counts, 1U << stream, odcube::ALL));
+    out << "}";
+  }
+  out << "]";
+}
+
+void occupancyToJson(std::ostream &out, const occupancy::buckets_t &buckets, const occupancy::rois_t &rois) {
+  out << "[";
+  for (std::size_t idx = 0; idx < rois.mCount; ++idx) {
+    out << (idx ? "," : "") << "{\"roi\":";
+    quoted(out, rois.mRoi[idx].mName);
+    out << ", \"stream\":" << rois.mRoi[idx].mStream << ", \"occupancy\":";
+    occupancy::bucketToJson(out, buckets[idx]);
+    out << "}";
+  }
+  out << "]";
+}
+
+void windowToJson(std::ostream &out, const odwindows::window_aggregate_t &window,
+  const occupancy::rois_t &rois) {
+  out << "{\"type\":" << (window.mSliding ? "\"sliding\"" : "\"tumbling\"");
+  out << ", \"length\":" << window.mLength;
+  out << ", \"start_ms\":" << window.mStart / 1000000;
+  out << ", \"end_ms\":" << window.mEnd / 1000000;
+  out << ", \"partial\":" << (window.mPartial ? "true" : "false");
+  out << ", \"total\":" << window.mTotal << ", ";
+  matrixToJson(out, window.mMatrix);
+  out << ", ";
+  cubeToJson(out, window.mCube);
+  out << ", \"occupancy\":";
+  occupancyToJson(out, window.mOccupancy, rois);
+  out << "}";
+}
+
+void crossingsToJson(std::ostream &out, const metadata::snapshot_t &snapshot) {
+  std::uint32_t total = 0;
+  for (const auto &entry: snapshot.mCrossings) {
+    for (const auto &exit: entry) {
+      total += exit;
+    }
+  }
+  out << "{\"total\":" << total << ", ";
+  matrixToJson(out, snapshot.mCrossings);
+  out << "}";
+}
+
+void windowsToJson(std::ostream &out, const metadata::snapshot_t &snapshot) {
+  out << "[";
+  for (std::uint32_t idx = 0; idx < snapshot.mWindowCount; ++idx) {
+    out << (idx ? "," : "");
+    windowToJson(out, snapshot.mWindows[idx], snapshot.mRois);
+  }
+  out << "]";
+}
+
+void statsToJson(std::ostream &out, const metadata::snapshot_t &snapshot) {
+  out << "{\"buffers\":" << snapshot.mBuffers;
+  out << ", \"frames\":" << snapshot.mFrames;
+  out << ", \"exits\":" << snapshot.mExits;
+  out << ", \"objects\":" << snapshot.mObjects;
+  out << ", \"pending_entries\":" << snapshot.mPendingEntries;
+  out << ", \"stitched\":" << snapshot.mStitched;
+  out << ", \"lost_tracks\":" << snapshot.mLostTracks;
+  out << ", \"archived\":" << snapshot.mArchived;
+  out << ", \"archive_dropped\":" << snapshot.mArchiveDropped;
+  out << ", \"pts_ms\":" << snapshot.mLastPts / 1000000;
+  out << ", \"latency_ms\":" << snapshot.mLatencyMs;
+  out << ", \"infer_interval\":" << snapshot.mInferInterval;
+  out << ", \"fps\":" << std::quoted(snapshot.mFps);
+  out << ", \"arena_high_water\":" << snapshot.mArenaHighWater;
+  out << ", \"arena_spills\":" << snapshot.mArenaSpills;
+  out << ", \"allocations\":" << allocaccounting::statsJson();
+  out << "}";
+}
+
+// Keeps the last closed aggregate of every configured window for the stats surface
+void recordWindow(const odwindows::window_aggregate_t &window) {
+  std::uint32_t idx = 0;
+  while (idx < current.mWindowCount && (current.mWindows[idx].mLength != window.mLength ||
+      current.mWindows[idx].mSliding != window.mSliding)) {
+    ++idx;
+  }
+  if (idx == metadata::MAX_SNAPSHOT_WINDOWS) {
+    return;
+  }
+  current.mWindows[idx] = window;
+  current.mWindowCount = std::max(current.mWindowCount, idx + 1);
+}
+
+void publishWindow(const odwindows::window_aggregate_t &window) {
+  recordWindow(window);
+  auto publishTo = std::atomic_load(&sink);
+  if (!publishTo->mProducer) {
+    return;
+  }
+  arena::TextBuffer text(frameArena);
+  std::ostream kMsg(&text);
+  kMsg << "{\"window\":";
+  windowToJson(kMsg, window, current.mRois);
+  kMsg << "}";
+  publishTo->mProducer->produce(text.data(), text.size());
+}
+
+// Every entry is a tracker id of before the restart, the vehicles inside
+// can't be followed to their exit anymore
+void forgetTracks(const GstBuffer *buf) {
+  auto at = tracksResetAt.load(std::memory_order_acquire);
+  if (GST_CLOCK_TIME_NONE == at || GST_BUFFER_PTS (buf) != at ||
+      !tracksResetAt.compare_exchange_strong(at, GST_CLOCK_TIME_NONE)) {
+    return;
+  }
+  LOG_WARN("Tracker restarted, {} vehicles inside are not counted", objEntries.size());
+  untrackedTotal.inc(objEntries.size());
+  objEntries.clear();
+  stitchers.clear();
+}
+
+// The stream is gone, its vehicles won't reach an exit
+void retireSource(const guint source) {
+  std::vector<std::uint64_t> inside;
+  for (const auto &entry: objEntries) {
+    if (source == entry.second.mSource) {
+      inside.push_back(entry.first);
+    }
+  }
+  for (const auto id: inside) {
+    objEntries.erase(id);
+  }
+  if (source < stitchers.size()) {
+    stitchers[source].reset();
+  }
+  LOG_INFO("Source {} removed, {} vehicles inside are not counted", source, inside.size());
+  untrackedTotal.inc(inside.size());
+}
+
+std::uint64_t streamTime(const std::uint64_t pts) {
+  if (rebasePending) {
+    ptsBase = pts < restoredStreamTime ? restoredStreamTime - pts : 0;
+    rebasePending = false;
+  }
+  return ptsBase + pts;
+}
+
+void fpsMessageChanged(GObject *sink, GParamSpec *, gpointer) {
+  gchar *fpsMsg = nullptr;
+  g_object_get (sink, "last-message", &fpsMsg, NULL);
+  FpsText text{};
+  if (fpsMsg != nullptr) {
+    std::strncpy(text.mText, fpsMsg, metadata::MAX_FPS_TEXT_LEN - 1);
+    // "rendered: R, dropped: D, current: C, average: A"
+    const char *rate = std::strstr(fpsMsg, FPS_CURRENT);
+    if (nullptr != rate) {
+      fpsGauge.set(std::strtod(rate + std::strlen(FPS_CURRENT), nullptr));
+    }
+    g_free (fpsMsg);
   }
+  fpsText.store(text);
 }
 
-std::string getLCFromIdx(const std::size_t idx) {
-  if (idx == CROSSING_IDX_N) {
-    return CROSSING_N;
-  } else if (idx == CROSSING_IDX_NE) {
-    return CROSSING_NE;
-  } else if (idx == CROSSING_IDX_SE) {
-    return CROSSING_SE;
-  } else if (idx == CROSSING_IDX_SV) {
-    return CROSSING_SV;
-  } else if (idx == CROSSING_IDX_NV) {
-    return CROSSING_NV;
+void saveCheckpoint() {
+  checkpointEncoder.reset();
+  checkpointEncoder.put(CHECKPOINT_STATE_VERSION);
+  checkpointEncoder.put(crossings);
+  checkpointEncoder.put(cube);
+  checkpointEncoder.put(ptsBase + current.mLastPts);
+  checkpointEncoder.put(current.mFrames);
+  checkpointEncoder.put(current.mExits);
+  windowAggregator.save(checkpointEncoder);
+  checkpointFile->write(checkpointEncoder.buffer());
+}
+
+bool restoreCheckpoint() {
+  std::vector<std::uint8_t> state;
+  std::uint64_t generation = 0;
+  if (!checkpointFile->restore(state, generation)) {
+    return false;
+  }
+  checkpoint::Decoder decoder(state.data(), state.size());
+  std::uint32_t version = 0;
+  metadata::crossings_t restoredCrossings{};
+  odcube::cube_t restoredCube{};
+  std::uint64_t time = 0, frames = 0, exits = 0, count = 0;
+  bool known = decoder.get(version);
+  bool withEntries = version < CHECKPOINT_STATE_VERSION;
+  if (known && CHECKPOINT_STATE_VERSION_NARROW == version) {
+    std::array<std::array<std::uint16_t, N>, N> narrow{};
+    known = decoder.get(narrow);
+    for (std::size_t entry = 0; entry < N; ++entry) {
+      std::copy(narrow[entry].begin(), narrow[entry].end(), restoredCrossings[entry].begin());
+    }
+  } else {
+    known = known && version >= CHECKPOINT_STATE_VERSION_UNSOURCED && version <= CHECKPOINT_STATE_VERSION &&
+      decoder.get(restoredCrossings);
+  }
+  if (!known || !decoder.get(restoredCube) ||
+      !decoder.get(time) || !decoder.get(frames) ||
+      !decoder.get(exits) || (withEntries && !decoder.get(count))) {
+    std::cerr << "Checkpoint generation " << generation << " has an unknown layout, ignoring" << std::endl;
+    return false;
+  }
+  for (std::uint64_t idx = 0; idx < count; ++idx) {
+    std::uint64_t id = 0, entry = 0, entered = 0;
+    std::uint32_t source = 0;
+    if (!decoder.get(id) || !decoder.get(entry) || !decoder.get(entered) ||
+        (CHECKPOINT_STATE_VERSION_ENTRIES == version && !decoder.get(source)) || entry >= N) {
+      std::cerr << "Checkpoint generation " << generation << " is truncated, ignoring" << std::endl;
+      return false;
+    }
   }
-  return "";
+  crossings = restoredCrossings;
+  cube = restoredCube;
+  current.mFrames = frames;
+  current.mExits = exits;
+  restoredStreamTime = time;
+  rebasePending = true;
+  if (!windowAggregator.restore(decoder)) {
+    std::cerr << "Window configuration changed since checkpoint, windows start empty" << std::endl;
+  }
+  std::cout << "Restored checkpoint generation " << generation << ": " << exits << " exits" << std::endl;
+  return true;
 }
 
 } //namespace
 
 namespace metadata {
 
-meta_producer_t producer;
-
 GstPadProbeReturn
 nvdsanalyticsSrcPadBufferProbe (GstPad * pad, GstPadProbeInfo * info, gpointer u_data)
 {
+  allocaccounting::ProbeScope accounting;
+  auto probeStart = g_get_monotonic_time ();
   GstBuffer *buf = (GstBuffer *) info->data;
   guint num_rects = 0;
   NvDsObjectMeta *obj_meta = nullptr;
@@ -154,15 +602,42 @@ nvdsanalyticsSrcPadBufferProbe (GstPad * pad, GstPadProbeInfo * info, gpointer u
   guint car_count = 0;
   NvDsMetaList * l_frame = nullptr;
   NvDsMetaList * l_obj = nullptr;
-  gchar *fpsMsg = nullptr;
-  
-  g_object_get (G_OBJECT (u_data), "last-message", &fpsMsg, NULL);
+
+  auto fpsNow = fpsText.load();
+  char fps[MAX_DISPLAY_LEN];
+  snprintf(fps, sizeof(fps), "%s%s", FPS_PREFIX, fpsNow.mText);
 
   NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta (buf);
+  // Held for the whole buffer, a reload never changes them half way
+  auto bufferGates = std::atomic_load(&gateRegistry);
+  auto bufferSink = std::atomic_load(&sink);
+  forgetTracks(buf);
+  startup::mark(startup::Phase::FirstFrame);
 
   for (l_frame = batch_meta->frame_meta_list; l_frame != nullptr;
     l_frame = l_frame->next) {
     NvDsFrameMeta *frame_meta = (NvDsFrameMeta *) (l_frame->data);
+    auto frameTime = streamTime(frame_meta->buf_pts);
+    windowAggregator.advance(frameTime);
+    current.mLastPts = frame_meta->buf_pts;
+    if (0 != frame_meta->ntp_timestamp) {
+      // System time stamped by nvstreammux (attach-sys-ts)
+      current.mLatencyMs = static_cast<double>(g_get_real_time () * 1000 -
+        static_cast<gint64>(frame_meta->ntp_timestamp)) / 1000000.0;
+    }
+    current.mFrames++;
+    framesTotal.inc();
+    if (metaRing) {
+      auto objects = publishFrame(frame_meta, bufferGates.get());
+      if (!inProcessAnalytics) {
+        current.mObjects = objects;
+        continue;
+      }
+    }
+    auto *stitcher = stitcherFor(frame_meta->source_id);
+    if (stitcher) {
+      stitcher->beginFrame(frameTime);
+    }
     bus_count = 0;
     num_rects = 0;
     car_count = 0;
@@ -176,6 +651,18 @@ nvdsanalyticsSrcPadBufferProbe (GstPad * pad, GstPadProbeInfo * info, gpointer u
           car_count++;
           num_rects++;
         }
+        if (stitcher) {
+          const auto &box = obj_meta->rect_params;
+          stitching::stitch_t stitch;
+          if (stitcher->observe(obj_meta->object_id, box.left + box.width / 2, box.top + box.height / 2, stitch)) {
+            // Same vehicle under a new id, it keeps the entry of the lost one
+            const auto *lost = objEntries.find(stitch.mLostId);
+            auto entered = lost ? lost->mTime : frameTime;
+            objEntries.erase(stitch.mLostId);
+            objEntries.insert(obj_meta->object_id, metadata::entry_t{stitch.mEntry, entered, frame_meta->source_id});
+            LOG_INFO("Obj {} continues lost obj {}", obj_meta->object_id, stitch.mLostId);
+          }
+        }
         // Access attached user meta for each object
         for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != nullptr;
                 l_user_meta = l_user_meta->next) {
@@ -184,36 +671,64 @@ nvdsanalyticsSrcPadBufferProbe (GstPad * pad, GstPadProbeInfo * info, gpointer u
           {
             NvDsAnalyticsObjInfo * user_meta_data = (NvDsAnalyticsObjInfo *)user_meta->user_meta_data;
             if (!user_meta_data->lcStatus.empty()){
+              auto gate = bufferGates ? bufferGates->gate(frame_meta->source_id, user_meta_data->lcStatus[0]) : N;
+              if (gate >= N) {
+                continue;
+              }
               auto entry = objEntries.find(obj_meta->object_id);
-              if (entry != objEntries.end()) {
-                auto exit = getLCIdxFromString(user_meta_data->lcStatus[0]);
-                crossings[entry->second][exit]+=1;
-                std::cout << "Obj " << obj_meta->object_id << " exited" << std::endl;
-                std::stringstream kMsg;
-                kMsg << "{\"event\":";
-                kMsg << "{\"entry\":" << std::quoted(getLCFromIdx(entry->second));
-                kMsg << ", \"exit\":" << std::quoted(user_meta_data->lcStatus[0]);
-                kMsg << ", \"id\":" << obj_meta->object_id;
-                kMsg << "}}";
-                if (::vehicletracking::producer_t sharedProducer = ::metadata::producer.lock()) {
-                  //std::cout << "producer sending message: " << kMsg.str() << std::endl;
-                  sharedProducer->produce(kMsg.str());
+              if (entry != nullptr) {
+                auto exit = gate;
+                crossings[entry->mGate][exit]+=1;
+                auto stream = odcube::streamIndex(cubeInfo, frame_meta->source_id);
+                auto cls = odcube::classIndex(cubeInfo, obj_meta->class_id);
+                odcube::count(cube, stream, cls, entry->mGate, exit);
+                windowAggregator.add(frameTime, stream, cls, entry->mGate, exit);
+                if (sharedCounters) {
+                  sharedCounters->add(entry->mGate, exit, static_cast<std::uint64_t>(logger::now()));
+                }
+                current.mExits++;
+                exitsTotal.inc();
+                startup::mark(startup::Phase::FirstEvent);
+                if (archiveWriter) {
+                  auto travel = frameTime > entry->mTime ? (frameTime - entry->mTime) / 1000000 : 0;
+                  archiveWriter->append(archive::event_t{wallClock(frame_meta), obj_meta->object_id,
+                    static_cast<std::uint32_t>(travel), static_cast<std::uint16_t>(frame_meta->source_id),
+                    static_cast<std::int16_t>(obj_meta->class_id), static_cast<std::uint8_t>(entry->mGate),
+                    static_cast<std::uint8_t>(exit)});
+                }
+                LOG_INFO("Obj {} exited", obj_meta->object_id);
+                if (bufferSink->mPerEvent && bufferSink->mProducer) {
+                  arena::TextBuffer text(frameArena);
+                  std::ostream kMsg(&text);
+                  kMsg << "{\"event\":";
+                  kMsg << "{\"entry\":" << std::quoted(gates::name(entry->mGate));
+                  kMsg << ", \"exit\":";
+                  quoted(kMsg, user_meta_data->lcStatus[0]);
+                  kMsg << ", \"id\":" << obj_meta->object_id;
+                  kMsg << "}}";
+                  bufferSink->mProducer->produce(text.data(), text.size());
+                }
+                // Out of the scene, its slot is free for the next vehicle
+                objEntries.erase(obj_meta->object_id);
+                if (stitcher) {
+                  stitcher->setEntry(obj_meta->object_id, stitching::NO_ENTRY);
                 }
-                // else {
-                //   std::cout << "producer expired" << std::endl;
-                // }
               } else {
-                objEntries.insert({obj_meta->object_id, getLCIdxFromString(user_meta_data->lcStatus[0])});
+                objEntries.insert(obj_meta->object_id, metadata::entry_t{gate, frameTime, frame_meta->source_id});
+                entriesTotal.inc();
+                if (stitcher) {
+                  stitcher->setEntry(obj_meta->object_id, gate);
+                }
               }
             }
           }
         }
     }
-    display_info_t displayInfo;
-    if (fpsMsg != nullptr) {
-      displayInfo.fps += std::string(fpsMsg);
+    if (stitcher) {
+      stitcher->endFrame();
     }
-    std::stringstream out_string;
+    char roi[MAX_DISPLAY_LEN] = "";
+    std::size_t roiLen = 0;
     /* Iterate user metadata in frames to search analytics metadata */
     for (NvDsMetaList * l_user = frame_meta->frame_user_meta_list; l_user != nullptr; l_user = l_user->next) {
         NvDsUserMeta *user_meta = (NvDsUserMeta *) l_user->data;
@@ -224,35 +739,265 @@ nvdsanalyticsSrcPadBufferProbe (GstPad * pad, GstPadProbeInfo * info, gpointer u
         NvDsAnalyticsFrameMeta *meta =
             (NvDsAnalyticsFrameMeta *) user_meta->user_meta_data;
         /* Get the labels from nvdsanalytics config file */
-        for (std::pair<std::string, uint32_t> status : meta->objInROIcnt){
-          out_string << "Vehicles in ";
-          out_string << status.first;
-          out_string << " = ";
-          out_string << status.second;
-          displayInfo.roi = out_string.str();
-        }
-        for (std::pair<std::string, uint32_t> status : meta->objLCCumCnt){
-          out_string << " LineCrossing Cumulative ";
-          out_string << status.first;
-          out_string << " = ";
-          out_string << status.second;
-          displayInfo.crossings.insert(status);
+        for (const auto &status : meta->objInROIcnt){
+          if (occupancyRecorder) {
+            auto roi = occupancyRecorder->roi(frame_meta->source_id, status.first.c_str());
+            if (roi < occupancy::MAX_ROIS) {
+              occupancyRecorder->record(frameTime, roi, status.second);
+              windowAggregator.addOccupancy(frameTime, roi, status.second);
+            }
+          }
+          roiLen += snprintf(roi + roiLen, sizeof(roi) - roiLen, "Vehicles in %s = %u",
+            status.first.c_str(), status.second);
+          roiLen = std::min(roiLen, sizeof(roi) - 1);
         }
       }
-      
-      displayInfoToFrame(batch_meta, frame_meta, displayInfo);
-      
+      LineCrossing *lineCrossings = nullptr;
+      auto lineCount = collectCrossings(frame_meta, lineCrossings);
+
+      displayInfoToFrame(batch_meta, frame_meta, fps, roi, lineCrossings, lineCount);
+
       //std::cout << "Frame Number = " << frame_meta->frame_num << " of Stream = " << frame_meta->pad_index << ", Number of objects = " << num_rects <<
-      //        " Bus Count = " << bus_count << " Car Count = " << car_count << " " << out_string.str().c_str() << std::endl;
+      //        " Bus Count = " << bus_count << " Car Count = " << car_count << std::endl;
+      current.mObjects = num_rects;
+  }
+
+  current.mBuffers++;
+  current.mCrossings = crossings;
+  current.mCube = cube;
+  current.mPendingEntries = objEntries.size();
+  if (stitchingInfo) {
+    current.mStitched = 0;
+    current.mLostTracks = 0;
+    for (const auto &each: stitchers) {
+      if (each) {
+        current.mStitched += each->stitched();
+        current.mLostTracks += static_cast<std::uint32_t>(each->lost());
+      }
+    }
+  }
+  if (occupancyRecorder) {
+    current.mRois = occupancyRecorder->rois();
+  }
+  if (archiveWriter) {
+    archiveWriter->tick(static_cast<std::uint64_t>(g_get_real_time ()) * 1000);
+    current.mArchived = archiveWriter->archived();
+    current.mArchiveDropped = archiveWriter->dropped();
   }
+  current.mInferInterval = inferInterval.load(std::memory_order_relaxed);
+  std::memcpy(current.mFps, fpsNow.mText, MAX_FPS_TEXT_LEN);
+  current.mArenaHighWater = frameArena.highWater();
+  current.mArenaSpills = frameArena.spills();
+  published.store(current);
+
+  if (checkpointFile && g_get_monotonic_time () >= nextCheckpoint) {
+    saveCheckpoint();
+    nextCheckpoint = g_get_monotonic_time () + checkpointInterval;
+  }
+  frameArena.reset();
+  buffersTotal.inc();
+  objectsGauge.set(current.mObjects);
+  pendingGauge.set(current.mPendingEntries);
+  latencyGauge.set(current.mLatencyMs / 1000.0);
+  probeSeconds.observe(static_cast<double>(g_get_monotonic_time () - probeStart) / G_USEC_PER_SEC);
   return GST_PAD_PROBE_OK;
 }
 
+GstPadProbeReturn
+nvdsanalyticsSrcPadEventProbe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer u_data)
+{
+  auto *event = GST_PAD_PROBE_INFO_EVENT (info);
+  guint source = 0;
+  // nvstreammux sends them in order with the batches, the last frame of a
+  // removed source has been counted by now
+  if (GST_NVEVENT_PAD_ADDED == GST_EVENT_TYPE (event)) {
+    gst_nvevent_parse_pad_added (event, &source);
+    LOG_INFO("Source {} added", source);
+  } else if (GST_NVEVENT_PAD_DELETED == GST_EVENT_TYPE (event)) {
+    gst_nvevent_parse_pad_deleted (event, &source);
+    retireSource(source);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+void watchFps(GstElement *fpsSink) {
+  g_signal_connect (G_OBJECT (fpsSink), "notify::last-message", G_CALLBACK (fpsMessageChanged), nullptr);
+}
+
+crossings_t crossingsMatrix() {
+  return published.load().mCrossings;
+}
+
+std::string crossingsJson() {
+  std::stringstream out;
+  crossingsToJson(out, published.load());
+  return out.str();
+}
+
+std::string windowsJson() {
+  std::stringstream out;
+  out << "{\"windows\":";
+  windowsToJson(out, published.load());
+  out << "}";
+  return out.str();
+}
+
+std::string cubeJson() {
+  auto snapshot = published.load();
+  auto matrix = odcube::reduce(snapshot.mCube);
+  auto gates = odcube::gateTotals(matrix);
+  std::stringstream out;
+  out << "{\"total\":" << odcube::total(snapshot.mCube) << ", ";
+  matrixToJson(out, matrix);
+  out << ", \"entries\":[";
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    out << (idx ? "," : "") << gates.mEntries[idx];
+  }
+  out << "], \"exits\":[";
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    out << (idx ? "," : "") << gates.mExits[idx];
+  }
+  out << "], ";
+  cubeToJson(out, snapshot.mCube);
+  out << "}";
+  return out.str();
+}
+
+std::string occupancyJson() {
+  if (!occupancyRecorder) {
+    return "{\"enabled\":false}";
+  }
+  std::stringstream out;
+  occupancyRecorder->toJson(out);
+  return out.str();
+}
+
+std::string statsJson() {
+  std::stringstream out;
+  statsToJson(out, published.load());
+  return out.str();
+}
+
+std::string snapshotJson() {
+  // One load so that the sections are consistent with each other
+  auto snapshot = published.load();
+  std::stringstream out;
+  out << "{\"crossings\":";
+  crossingsToJson(out, snapshot);
+  out << ", \"windows\":";
+  windowsToJson(out, snapshot);
+  out << ", \"stats\":";
+  statsToJson(out, snapshot);
+  out << "}";
+  return out.str();
+}
+
+void setCube(const ::odcube::cube_info_t &info) {
+  odcube::validate(info);
+  cubeInfo.mStreams = info.mStreams;
+  cubeInfo.mClasses = info.mClasses;
+}
+
+void setWindows(const ::odwindows::windows_info_t &windowsInfo) {
+  windowAggregator.configure(windowsInfo, publishWindow);
+}
+
+void flushWindows() {
+  windowAggregator.flush();
+  frameArena.reset();
+}
+
+void setCheckpoint(const ::checkpoint::checkpoint_info_t &checkpointInfo) {
+  auto start = std::chrono::steady_clock::now();
+  checkpointInterval = static_cast<gint64>(checkpointInfo.mInterval) * G_USEC_PER_SEC;
+  auto slotSize = sizeof(CHECKPOINT_STATE_VERSION) + sizeof(crossings_t) + sizeof(odcube::cube_t) +
+    3 * sizeof(std::uint64_t) +
+    windowAggregator.stateSize();
+  checkpointFile.reset(new checkpoint::CheckpointFile(checkpointInfo.mPath, slotSize));
+  checkpointEncoder.reserve(slotSize);
+  if (restoreCheckpoint()) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+    std::cout << "Checkpoint restored in " << elapsed / 1000.0 << " ms" << std::endl;
+    published.store(current);
+  }
+  nextCheckpoint = g_get_monotonic_time () + checkpointInterval;
+}
+
+void checkpointNow() {
+  if (checkpointFile) {
+    saveCheckpoint();
+  }
+}
+
+::intervalcontrol::load_sample_t loadSample() {
+  auto snapshot = published.load();
+  return ::intervalcontrol::load_sample_t{0.0, snapshot.mLatencyMs,
+    static_cast<double>(snapshot.mObjects)};
+}
+
+void setInferInterval(const std::uint32_t interval) {
+  inferInterval.store(interval, std::memory_order_relaxed);
+}
+
+void setSharedCounters(const ::shmcounters::shared_counters_info_t &countersInfo) {
+  std::vector<std::string> gateNames;
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    gateNames.push_back(gates::name(idx));
+  }
+  sharedCounters.reset(new shmcounters::SharedCounters(countersInfo, gateNames));
+  std::cout << "Counting into shared segment " << countersInfo.mName << " slot "
+            << sharedCounters->slot() << " as '" << countersInfo.mLabel << "'" << std::endl;
+}
+
+void setStitching(const ::stitching::stitching_info_t &info) {
+  // Checked here, the stitchers themselves come with the first frame of
+  // every source
+  stitching::TrackStitcher check(info);
+  stitchingInfo.reset(new stitching::stitching_info_t(info));
+}
+
+std::shared_ptr<const ::gates::GateRegistry> setGates(std::shared_ptr<const ::gates::GateRegistry> gates) {
+  return std::atomic_exchange(&gateRegistry, std::move(gates));
+}
+
+std::shared_ptr<const sink_t> setSink(const sink_t &to) {
+  return std::atomic_exchange(&sink, std::make_shared<const sink_t>(to));
+}
+
+void resetTracksAt(const GstClockTime pts) {
+  tracksResetAt.store(pts, std::memory_order_release);
+}
+
+void setOccupancy(const ::occupancy::occupancy_info_t &occupancyInfo) {
+  occupancyRecorder.reset(new occupancy::OccupancyRecorder(occupancyInfo));
+}
+
+void setArchive(const ::archive::archive_info_t &archiveInfo) {
+  archiveWriter.reset(new archive::ArchiveWriter(archiveInfo));
+}
+
+void closeArchive() {
+  archiveWriter.reset();
+}
+
+void setMetaRing(const ::metaring::meta_ring_info_t &ringInfo) {
+  std::vector<std::string> gateNames;
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    gateNames.push_back(gates::name(idx));
+  }
+  metaRing.reset(new metaring::RingWriter(ringInfo, gateNames));
+  inProcessAnalytics = ringInfo.mInProcess;
+  std::cout << "Publishing frame records to " << ringInfo.mName << ", " << ringInfo.mSlots << " slots"
+            << (inProcessAnalytics ? "" : ", no in-process analytics") << std::endl;
+}
+
 void printCrossingsMatrix() {
   std::cout << "  N NE SE SV NV" << std::endl;
   std::size_t idx = 0;
   for (const auto &entry: crossings) {
-    std::cout << getLCFromIdx(idx++) << " ";
+    std::cout << gates::name(idx++) << " ";
     for (const auto &exit: entry) {
       std::cout << exit << " ";
     }
@@ -0,0 +1,200 @@
+#include "metaring.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr std::uint64_t RING_MAGIC = 0x31474e4952544d56ULL; // "VMTRING1"
+constexpr std::uint32_t RING_VERSION = 1;
+constexpr auto INIT_WAIT = std::chrono::milliseconds(10);
+constexpr auto INIT_RETRIES = 100;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The metadata ring must be lock-free across processes");
+static_assert(sizeof(metaring::ObjectRecord) == 32, "Object records are packed by hand");
+static_assert(sizeof(metaring::RingHeader) % 64 == 0, "Slots must start on a cache line");
+
+std::size_t ringSize(const std::uint32_t slots) {
+  return sizeof(metaring::RingHeader) + static_cast<std::size_t>(slots) * sizeof(metaring::Slot);
+}
+
+} // namespace
+
+namespace metaring {
+
+RingWriter::RingWriter(const meta_ring_info_t &info, const std::vector<std::string> &gateNames):
+  mName{info.mName},
+  mFd{-1},
+  mSize{ringSize(info.mSlots)},
+  mHeader{nullptr},
+  mSlots{nullptr},
+  mMask{info.mSlots - 1ULL},
+  mNext{1}
+{
+  if (0 == info.mSlots || 0 != (info.mSlots & (info.mSlots - 1))) {
+    throw std::invalid_argument(ERR_MSG_SLOTS);
+  }
+  // Readers of a previous run keep their mapping of the old ring
+  shm_unlink(mName.c_str());
+  mFd = shm_open(mName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (mFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_RING) + " " + mName + ": " + std::strerror(errno));
+  }
+  if (0 != ftruncate(mFd, mSize)) {
+    auto err = errno;
+    close(mFd);
+    shm_unlink(mName.c_str());
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_RING) + ": " + std::strerror(err));
+  }
+  void *base = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+  if (MAP_FAILED == base) {
+    close(mFd);
+    throw std::runtime_error(std::string(ERR_MSG_MAP_RING) + ": " + mName);
+  }
+  // Zero filled, every slot starts at sequence 0 and the head at 0
+  mHeader = static_cast<RingHeader*>(base);
+  mSlots = reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(RingHeader));
+  mHeader->mVersion = RING_VERSION;
+  mHeader->mSlots = info.mSlots;
+  mHeader->mMaxObjects = MAX_OBJECTS;
+  mHeader->mWriterPid = static_cast<std::int32_t>(getpid());
+  mHeader->mGates = N;
+  for (std::size_t idx = 0; idx < N && idx < gateNames.size(); ++idx) {
+    std::strncpy(mHeader->mGateNames[idx], gateNames[idx].c_str(), MAX_GATE_LEN - 1);
+  }
+  mHeader->mMagic.store(RING_MAGIC, std::memory_order_release);
+}
+
+RingWriter::~RingWriter() {
+  munmap(mHeader, mSize);
+  close(mFd);
+}
+
+RingReader::RingReader(const std::string &name, const bool fromOldest):
+  mName{name},
+  mFd{-1},
+  mSize{0},
+  mHeader{nullptr},
+  mSlots{nullptr},
+  mMask{0},
+  mNext{1},
+  mCurrent{0},
+  mLost{0},
+  mRead{0}
+{
+  mFd = shm_open(mName.c_str(), O_RDONLY, 0);
+  if (mFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_RING) + " " + mName + ": " + std::strerror(errno));
+  }
+  // The writer may be sizing the ring right now, give it time
+  struct stat st{};
+  for (auto retry = 0; retry < INIT_RETRIES; ++retry) {
+    if (0 == fstat(mFd, &st) && static_cast<std::size_t>(st.st_size) >= sizeof(RingHeader)) {
+      break;
+    }
+    std::this_thread::sleep_for(INIT_WAIT);
+  }
+  if (static_cast<std::size_t>(st.st_size) < sizeof(RingHeader)) {
+    close(mFd);
+    throw std::runtime_error(ERR_MSG_RING_LAYOUT);
+  }
+  mSize = st.st_size;
+  void *base = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, mFd, 0);
+  if (MAP_FAILED == base) {
+    close(mFd);
+    throw std::runtime_error(std::string(ERR_MSG_MAP_RING) + ": " + mName);
+  }
+  mHeader = static_cast<const RingHeader*>(base);
+  mSlots = reinterpret_cast<const Slot*>(static_cast<const char*>(base) + sizeof(RingHeader));
+  try {
+    this->waitReady();
+  } catch (const std::exception &) {
+    munmap(base, mSize);
+    close(mFd);
+    throw;
+  }
+  mMask = mHeader->mSlots - 1ULL;
+  auto head = mHeader->mHead.load(std::memory_order_acquire);
+  if (!fromOldest) {
+    mNext = head + 1;
+  } else if (head > mHeader->mSlots) {
+    mNext = head - mHeader->mSlots + 1;
+  }
+}
+
+RingReader::~RingReader() {
+  munmap(const_cast<RingHeader*>(mHeader), mSize);
+  close(mFd);
+}
+
+void RingReader::waitReady() const {
+  for (auto retry = 0; retry < INIT_RETRIES &&
+      RING_MAGIC != mHeader->mMagic.load(std::memory_order_acquire); ++retry) {
+    std::this_thread::sleep_for(INIT_WAIT);
+  }
+  if (RING_MAGIC != mHeader->mMagic.load(std::memory_order_acquire) ||
+      RING_VERSION != mHeader->mVersion || MAX_OBJECTS != mHeader->mMaxObjects ||
+      N != mHeader->mGates || mSize < ringSize(mHeader->mSlots)) {
+    throw std::runtime_error(ERR_MSG_RING_LAYOUT);
+  }
+}
+
+const FrameRecord *RingReader::next() {
+  for (;;) {
+    auto head = mHeader->mHead.load(std::memory_order_acquire);
+    if (mNext > head) {
+      return nullptr;
+    }
+    // A lap behind, the oldest records are gone
+    if (head - mNext >= mHeader->mSlots) {
+      auto oldest = head - mHeader->mSlots + 1;
+      mLost += oldest - mNext;
+      mNext = oldest;
+    }
+    const auto &slot = mSlots[(mNext - 1) & mMask];
+    if (2 * mNext == slot.mSeq.load(std::memory_order_acquire)) {
+      mCurrent = mNext++;
+      return &slot.mFrame;
+    }
+    // Overwritten between the head and the slot
+    ++mLost;
+    ++mNext;
+  }
+}
+
+bool RingReader::release() {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (2 * mCurrent != mSlots[(mCurrent - 1) & mMask].mSeq.load(std::memory_order_relaxed)) {
+    ++mLost;
+    return false;
+  }
+  ++mRead;
+  return true;
+}
+
+bool RingReader::writerAlive() const {
+  // Only meaningful within one pid namespace
+  return 0 == kill(mHeader->mWriterPid, 0) || EPERM == errno;
+}
+
+bool RingReader::replaced() const {
+  struct stat mine{}, named{};
+  int fd = shm_open(mName.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+  bool replaced = 0 == fstat(fd, &named) && 0 == fstat(mFd, &mine) && mine.st_ino != named.st_ino;
+  close(fd);
+  return replaced;
+}
+
+} // namespace metaring
@@ -0,0 +1,216 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr auto TEXTFILE_SUFFIX = ".tmp";
+constexpr auto VALUE_PRECISION = 12;
+
+enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+constexpr const char *TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+struct Series {
+  std::string mLabels;
+  std::unique_ptr<metrics::Counter> mCounter;
+  std::unique_ptr<metrics::Gauge> mGauge;
+  std::unique_ptr<metrics::Histogram> mHistogram;
+};
+
+struct Family {
+  std::string mName;
+  std::string mHelp;
+  Type mType;
+  std::vector<Series> mSeries;
+};
+
+struct Registry {
+  std::mutex mMutex;
+  std::vector<Family> mFamilies;
+};
+
+// Built by whoever registers first, metrics are registered from static
+// initializers of other files
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+std::atomic<std::size_t> nextShard{0};
+
+// Caller holds the registry lock
+Series &series(const std::string &name, const std::string &help, const Type type, const std::string &labels) {
+  auto &families = registry().mFamilies;
+  auto family = std::find_if(families.begin(), families.end(),
+    [&name](const Family &each) { return each.mName == name; });
+  if (family == families.end()) {
+    families.push_back(Family{name, help, type, {}});
+    family = families.end() - 1;
+  } else if (family->mType != type) {
+    throw std::invalid_argument(std::string(metrics::ERR_MSG_TYPE) + ": " + name);
+  }
+  for (auto &each: family->mSeries) {
+    if (each.mLabels == labels) {
+      return each;
+    }
+  }
+  family->mSeries.push_back(Series{labels, nullptr, nullptr, nullptr});
+  return family->mSeries.back();
+}
+
+void sample(std::ostream &out, const std::string &name, const std::string &labels) {
+  out << name;
+  if (!labels.empty()) {
+    out << '{' << labels << '}';
+  }
+  out << ' ';
+}
+
+std::string withBound(const std::string &labels, const std::string &bound) {
+  return (labels.empty() ? "" : labels + ",") + "le=\"" + bound + "\"";
+}
+
+void histogramText(std::ostream &out, const std::string &name, const Series &series) {
+  const auto &bounds = series.mHistogram->bounds();
+  auto totals = series.mHistogram->totals();
+  std::uint64_t cumulative = 0;
+  for (std::size_t idx = 0; idx < bounds.size(); ++idx) {
+    cumulative += totals.mCounts[idx];
+    std::ostringstream bound;
+    bound.precision(VALUE_PRECISION);
+    bound << bounds[idx];
+    sample(out, name + "_bucket", withBound(series.mLabels, bound.str()));
+    out << cumulative << '\n';
+  }
+  sample(out, name + "_bucket", withBound(series.mLabels, "+Inf"));
+  out << totals.mCount << '\n';
+  sample(out, name + "_sum", series.mLabels);
+  out << totals.mSum << '\n';
+  sample(out, name + "_count", series.mLabels);
+  out << totals.mCount << '\n';
+}
+
+} // namespace
+
+namespace metrics {
+
+std::size_t takeShard() {
+  return nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+}
+
+std::uint64_t Counter::value() const {
+  std::uint64_t total = 0;
+  for (const auto &each: mShards) {
+    total += each.mValue.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+Histogram::Histogram(const std::vector<double> &bounds):
+  mBounds{bounds}
+{
+  if (mBounds.empty() || mBounds.size() > MAX_BUCKETS ||
+      !std::is_sorted(mBounds.begin(), mBounds.end()) ||
+      std::adjacent_find(mBounds.begin(), mBounds.end()) != mBounds.end()) {
+    throw std::invalid_argument(std::string(ERR_MSG_BUCKETS) + " " + std::to_string(MAX_BUCKETS));
+  }
+}
+
+void Histogram::observe(const double value) {
+  auto bucket = static_cast<std::size_t>(std::lower_bound(mBounds.begin(), mBounds.end(), value) - mBounds.begin());
+  auto &own = mShards[shard()];
+  own.mCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+  auto sum = own.mSum.load(std::memory_order_relaxed);
+  while (!own.mSum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Totals Histogram::totals() const {
+  Totals totals{};
+  for (const auto &each: mShards) {
+    for (std::size_t idx = 0; idx <= mBounds.size(); ++idx) {
+      auto count = each.mCounts[idx].load(std::memory_order_relaxed);
+      totals.mCounts[idx] += count;
+      totals.mCount += count;
+    }
+    totals.mSum += each.mSum.load(std::memory_order_relaxed);
+  }
+  return totals;
+}
+
+Counter &counter(const std::string &name, const std::string &help, const std::string &labels) {
+  std::lock_guard<std::mutex> lock(registry().mMutex);
+  auto &each = series(name, help, Type::COUNTER, labels);
+  if (!each.mCounter) {
+    each.mCounter.reset(new Counter());
+  }
+  return *each.mCounter;
+}
+
+Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels) {
+  std::lock_guard<std::mutex> lock(registry().mMutex);
+  auto &each = series(name, help, Type::GAUGE, labels);
+  if (!each.mGauge) {
+    each.mGauge.reset(new Gauge());
+  }
+  return *each.mGauge;
+}
+
+Histogram &histogram(const std::string &name, const std::string &help, const std::vector<double> &bounds,
+  const std::string &labels) {
+  // Bounds checked before anything is registered
+  std::unique_ptr<Histogram> created{new Histogram(bounds)};
+  std::lock_guard<std::mutex> lock(registry().mMutex);
+  auto &each = series(name, help, Type::HISTOGRAM, labels);
+  if (!each.mHistogram) {
+    each.mHistogram = std::move(created);
+  }
+  return *each.mHistogram;
+}
+
+std::string prometheusText() {
+  std::ostringstream out;
+  out.precision(VALUE_PRECISION);
+  std::lock_guard<std::mutex> lock(registry().mMutex);
+  for (const auto &family: registry().mFamilies) {
+    out << "# HELP " << family.mName << ' ' << family.mHelp << '\n';
+    out << "# TYPE " << family.mName << ' ' << TYPE_NAMES[static_cast<int>(family.mType)] << '\n';
+    for (const auto &each: family.mSeries) {
+      switch (family.mType) {
+        case Type::COUNTER:
+          sample(out, family.mName, each.mLabels);
+          out << each.mCounter->value() << '\n';
+          break;
+        case Type::GAUGE:
+          sample(out, family.mName, each.mLabels);
+          out << each.mGauge->value() << '\n';
+          break;
+        case Type::HISTOGRAM:
+          histogramText(out, family.mName, each);
+          break;
+      }
+    }
+  }
+  return out.str();
+}
+
+bool writeTextfile(const std::string &path) {
+  auto temporary = path + TEXTFILE_SUFFIX;
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    file << prometheusText();
+    if (!file.flush()) {
+      return false;
+    }
+  }
+  return 0 == std::rename(temporary.c_str(), path.c_str());
+}
+
+} // namespace metrics
@@ -0,0 +1,201 @@
+#include "occupancy.h"
+
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+constexpr std::uint64_t NSEC_PER_MSEC = 1000000ULL;
+constexpr std::uint64_t MINUTE = 60 * NSEC_PER_SEC;
+constexpr std::uint64_t HOUR = 60 * MINUTE;
+
+// Writer side of seqlock.h, on the streaming thread
+void beginWrite(std::atomic<std::uint64_t> &seq) {
+  seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void endWrite(std::atomic<std::uint64_t> &seq) {
+  seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Reader side: copies again until no write overlapped the copy. The
+// containers are sized up front, only their elements are ever written.
+template <typename T>
+void readConsistent(const std::atomic<std::uint64_t> &seq, const T &from, T &into) {
+  for (;;) {
+    auto before = seq.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    into = from;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (before == seq.load(std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+} // namespace
+
+namespace occupancy {
+
+void bucketToJson(std::ostream &out, const bucket_t &bucket) {
+  out << "{\"min\":" << (bucket.mSamples ? bucket.mMin : 0);
+  out << ", \"max\":" << bucket.mMax;
+  out << ", \"mean\":" << mean(bucket) << "}";
+}
+
+OccupancyRecorder::OccupancyRecorder(const occupancy_info_t &info):
+  mInfo{info},
+  mRois{}
+{
+  if (0 == info.mRawSeconds || 0 == info.mMaxFps) {
+    throw std::invalid_argument(ERR_MSG_RAW);
+  }
+  if (0 == info.mMinutes || 0 == info.mHours) {
+    throw std::invalid_argument(ERR_MSG_BUCKETS);
+  }
+  mSeries.resize(MAX_ROIS);
+  for (auto &series: mSeries) {
+    series.mRaw.resize(static_cast<std::size_t>(info.mRawSeconds) * info.mMaxFps);
+    series.mRawHead = series.mRawSize = 0;
+    series.mMinutes = Tier{MINUTE, std::vector<bucket_t>(info.mMinutes), 0, 0, bucket_t{}};
+    series.mHours = Tier{HOUR, std::vector<bucket_t>(info.mHours), 0, 0, bucket_t{}};
+    clear(series.mMinutes.mOpen);
+    clear(series.mHours.mOpen);
+  }
+}
+
+std::size_t OccupancyRecorder::roi(const std::uint32_t stream, const char *name) {
+  for (std::size_t idx = 0; idx < mRois.mCount; ++idx) {
+    const auto &roi = mRois.mRoi[idx];
+    if (roi.mStream == stream && 0 == std::strncmp(roi.mName, name, MAX_ROI_NAME - 1)) {
+      return idx;
+    }
+  }
+  if (MAX_ROIS == mRois.mCount) {
+    return MAX_ROIS;
+  }
+  beginWrite(mRoisSeq);
+  auto &roi = mRois.mRoi[mRois.mCount];
+  roi.mStream = stream;
+  roi.mVehicles = 0;
+  std::strncpy(roi.mName, name, MAX_ROI_NAME - 1);
+  roi.mName[MAX_ROI_NAME - 1] = '\0';
+  auto idx = mRois.mCount++;
+  endWrite(mRoisSeq);
+  return idx;
+}
+
+void OccupancyRecorder::record(const std::uint64_t time, const std::size_t idx, const std::uint32_t vehicles) {
+  if (idx >= mRois.mCount) {
+    return;
+  }
+  beginWrite(mRoisSeq);
+  mRois.mRoi[idx].mVehicles = vehicles;
+  endWrite(mRoisSeq);
+  beginWrite(mSeriesSeq[idx]);
+  auto &series = mSeries[idx];
+  auto capacity = series.mRaw.size();
+  series.mRaw[(series.mRawHead + series.mRawSize) % capacity] = Sample{time, vehicles};
+  if (series.mRawSize == capacity) {
+    series.mRawHead = (series.mRawHead + 1) % capacity;
+  } else {
+    ++series.mRawSize;
+  }
+  bucket_t minute;
+  if (roll(series.mMinutes, time, minute)) {
+    bucket_t hour;
+    roll(series.mHours, minute.mStart, hour);
+    merge(series.mHours.mOpen, minute);
+  }
+  add(series.mMinutes.mOpen, vehicles);
+  endWrite(mSeriesSeq[idx]);
+}
+
+void OccupancyRecorder::push(Tier &tier, const bucket_t &bucket) {
+  auto capacity = tier.mRing.size();
+  tier.mRing[(tier.mHead + tier.mSize) % capacity] = bucket;
+  if (tier.mSize == capacity) {
+    tier.mHead = (tier.mHead + 1) % capacity;
+  } else {
+    ++tier.mSize;
+  }
+}
+
+// Closes the open bucket when time is past it, true with the closed bucket
+bool OccupancyRecorder::roll(Tier &tier, const std::uint64_t time, bucket_t &closed) {
+  auto start = time - time % tier.mWidth;
+  if (0 == tier.mOpen.mSamples) {
+    tier.mOpen.mStart = start;
+    return false;
+  }
+  if (start == tier.mOpen.mStart) {
+    return false;
+  }
+  closed = tier.mOpen;
+  push(tier, closed);
+  clear(tier.mOpen, start);
+  return true;
+}
+
+void OccupancyRecorder::tierToJson(std::ostream &out, const Tier &tier) {
+  out << "[";
+  auto capacity = tier.mRing.size();
+  for (std::size_t idx = 0; idx < tier.mSize; ++idx) {
+    const auto &bucket = tier.mRing[(tier.mHead + idx) % capacity];
+    out << (idx ? "," : "") << "{\"start_ms\":" << bucket.mStart / NSEC_PER_MSEC << ", \"occupancy\":";
+    bucketToJson(out, bucket);
+    out << "}";
+  }
+  if (0 != tier.mOpen.mSamples) {
+    // Still filling
+    out << (tier.mSize ? "," : "") << "{\"start_ms\":" << tier.mOpen.mStart / NSEC_PER_MSEC;
+    out << ", \"open\":true, \"occupancy\":";
+    bucketToJson(out, tier.mOpen);
+    out << "}";
+  }
+  out << "]";
+}
+
+void OccupancyRecorder::toJson(std::ostream &out) const {
+  rois_t rois;
+  readConsistent(mRoisSeq, mRois, rois);
+  std::vector<Series> series(rois.mCount);
+  for (std::size_t idx = 0; idx < rois.mCount; ++idx) {
+    readConsistent(mSeriesSeq[idx], mSeries[idx], series[idx]);
+  }
+  out << "{\"raw_seconds\":" << mInfo.mRawSeconds << ", \"rois\":[";
+  for (std::size_t idx = 0; idx < rois.mCount; ++idx) {
+    const auto &roi = rois.mRoi[idx];
+    const auto &raw = series[idx];
+    out << (idx ? "," : "") << "{\"roi\":" << std::quoted(roi.mName);
+    out << ", \"stream\":" << roi.mStream;
+    out << ", \"vehicles\":" << roi.mVehicles;
+    // [time_ms, vehicles] per frame, the last raw-seconds of them
+    out << ", \"raw\":[";
+    auto capacity = raw.mRaw.size();
+    auto newest = raw.mRawSize ? raw.mRaw[(raw.mRawHead + raw.mRawSize - 1) % capacity].mTime : 0;
+    auto horizon = static_cast<std::uint64_t>(mInfo.mRawSeconds) * NSEC_PER_SEC;
+    bool first = true;
+    for (std::size_t sample = 0; sample < raw.mRawSize; ++sample) {
+      const auto &entry = raw.mRaw[(raw.mRawHead + sample) % capacity];
+      if (entry.mTime + horizon < newest) {
+        continue;
+      }
+      out << (first ? "[" : ",[") << entry.mTime / NSEC_PER_MSEC << "," << entry.mVehicles << "]";
+      first = false;
+    }
+    out << "], \"minutes\":";
+    tierToJson(out, raw.mMinutes);
+    out << ", \"hours\":";
+    tierToJson(out, raw.mHours);
+    out << "}";
+  }
+  out << "]}";
+}
+
+} // namespace occupancy
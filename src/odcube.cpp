@@ -0,0 +1,166 @@
+#include "odcube.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+using lanes_t = std::uint32_t __attribute__((vector_size(16)));
+
+constexpr std::size_t LANES = sizeof(lanes_t) / sizeof(std::uint32_t);
+constexpr std::size_t VECTORS = odcube::BLOCK / LANES;
+constexpr std::size_t BLOCKS = odcube::MAX_STREAMS * odcube::MAX_CLASSES;
+
+static_assert(0 == odcube::BLOCK % LANES, "Cube blocks must be whole vectors");
+static_assert(sizeof(odcube::cube_t) == BLOCKS * odcube::BLOCK * sizeof(std::uint32_t),
+  "Cube blocks must be contiguous");
+
+// Blocks are cache aligned, memcpy keeps the compiler's aliasing rules
+// happy and still compiles to plain vector loads and stores
+inline lanes_t load(const std::uint32_t *counts) {
+  lanes_t lanes;
+  std::memcpy(&lanes, counts, sizeof(lanes));
+  return lanes;
+}
+
+inline void store(std::uint32_t *counts, const lanes_t lanes) {
+  std::memcpy(counts, &lanes, sizeof(lanes));
+}
+
+inline const std::uint32_t *block(const odcube::cube_t &cube, const std::size_t stream,
+  const std::size_t cls) {
+  return cube.mCounts[stream][cls].data();
+}
+
+// Lane-wise sum of the selected blocks
+void sumBlocks(const odcube::cube_t &cube, const std::uint32_t streams, const std::uint32_t classes,
+  lanes_t (&sum)[VECTORS]) {
+  for (auto &lanes: sum) {
+    lanes = lanes_t{};
+  }
+  for (std::size_t stream = 0; stream < odcube::MAX_STREAMS; ++stream) {
+    if (0 == (streams & (1U << stream))) {
+      continue;
+    }
+    for (std::size_t cls = 0; cls < odcube::MAX_CLASSES; ++cls) {
+      if (0 == (classes & (1U << cls))) {
+        continue;
+      }
+      const auto *counts = block(cube, stream, cls);
+      for (std::size_t vec = 0; vec < VECTORS; ++vec) {
+        sum[vec] += load(counts + vec * LANES);
+      }
+    }
+  }
+}
+
+std::uint64_t horizontal(const lanes_t (&sum)[VECTORS]) {
+  lanes_t folded{};
+  for (const auto &lanes: sum) {
+    folded += lanes;
+  }
+  std::uint64_t total = 0;
+  for (std::size_t lane = 0; lane < LANES; ++lane) {
+    total += folded[lane];
+  }
+  return total;
+}
+
+} // namespace
+
+namespace odcube {
+
+void validate(const cube_info_t &info) {
+  if (0 == info.mStreams || info.mStreams > MAX_STREAMS) {
+    throw std::invalid_argument(ERR_MSG_STREAMS);
+  }
+  if (info.mClasses.size() >= MAX_CLASSES) {
+    throw std::invalid_argument(ERR_MSG_CLASSES);
+  }
+}
+
+std::size_t streamIndex(const cube_info_t &info, const std::uint32_t sourceId) {
+  return sourceId < info.mStreams ? sourceId : info.mStreams - 1;
+}
+
+std::size_t classIndex(const cube_info_t &info, const int classId) {
+  return classId >= 0 && static_cast<std::size_t>(classId) < info.mClasses.size() ?
+    static_cast<std::size_t>(classId) : info.mClasses.size();
+}
+
+void clear(cube_t &cube) {
+  std::memset(&cube, 0, sizeof(cube));
+}
+
+void accumulate(cube_t &into, const cube_t &from) {
+  auto *dst = into.mCounts[0][0].data();
+  const auto *src = from.mCounts[0][0].data();
+  for (std::size_t offset = 0; offset < BLOCKS * BLOCK; offset += LANES) {
+    store(dst + offset, load(dst + offset) + load(src + offset));
+  }
+}
+
+bool empty(const cube_t &cube) {
+  lanes_t any{};
+  const auto *counts = cube.mCounts[0][0].data();
+  for (std::size_t offset = 0; offset < BLOCKS * BLOCK; offset += LANES) {
+    any |= load(counts + offset);
+  }
+  for (std::size_t lane = 0; lane < LANES; ++lane) {
+    if (0 != any[lane]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+odwindows::matrix_t reduce(const cube_t &cube, const std::uint32_t streams, const std::uint32_t classes) {
+  lanes_t sum[VECTORS];
+  sumBlocks(cube, streams, classes, sum);
+  std::uint32_t counts[BLOCK];
+  for (std::size_t vec = 0; vec < VECTORS; ++vec) {
+    store(counts + vec * LANES, sum[vec]);
+  }
+  odwindows::matrix_t matrix;
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      matrix[entry][exit] = counts[entry * N + exit];
+    }
+  }
+  return matrix;
+}
+
+std::uint64_t total(const cube_t &cube, const std::uint32_t streams, const std::uint32_t classes) {
+  lanes_t sum[VECTORS];
+  sumBlocks(cube, streams, classes, sum);
+  return horizontal(sum);
+}
+
+std::array<std::uint64_t, MAX_CLASSES> classTotals(const cube_t &cube) {
+  std::array<std::uint64_t, MAX_CLASSES> totals;
+  for (std::size_t cls = 0; cls < MAX_CLASSES; ++cls) {
+    totals[cls] = total(cube, ALL, 1U << cls);
+  }
+  return totals;
+}
+
+std::array<std::uint64_t, MAX_STREAMS> streamTotals(const cube_t &cube) {
+  std::array<std::uint64_t, MAX_STREAMS> totals;
+  for (std::size_t stream = 0; stream < MAX_STREAMS; ++stream) {
+    totals[stream] = total(cube, 1U << stream, ALL);
+  }
+  return totals;
+}
+
+gate_totals_t gateTotals(const odwindows::matrix_t &matrix) {
+  gate_totals_t totals{};
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      totals.mEntries[entry] += matrix[entry][exit];
+      totals.mExits[exit] += matrix[entry][exit];
+    }
+  }
+  return totals;
+}
+
+} // namespace odcube
@@ -0,0 +1,231 @@
+#include "odwindows.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+} // namespace
+
+namespace odwindows {
+
+WindowRing::WindowRing(const std::uint32_t length, const std::uint32_t hop):
+  mLength{static_cast<std::uint64_t>(length) * NSEC_PER_SEC},
+  mHop{static_cast<std::uint64_t>(hop) * NSEC_PER_SEC},
+  mCurrent{0},
+  mFilled{0},
+  mOrigin{0},
+  mSlotStart{0},
+  mLastPts{0},
+  mStarted{false}
+{
+  if (0 == hop || 0 == length || 0 != length % hop) {
+    throw std::invalid_argument(ERR_MSG_WINDOW_LENGTH);
+  }
+  mSlots.resize(length / hop);
+  mOccupancy.resize(length / hop);
+  for (std::size_t idx = 0; idx < mSlots.size(); ++idx) {
+    clearSlot(idx);
+  }
+}
+
+void WindowRing::add(const std::uint64_t pts, const std::size_t stream, const std::size_t cls,
+  const std::size_t entry, const std::size_t exit) {
+  mLastPts = std::max(mLastPts, pts);
+  ::odcube::count(mSlots[mCurrent], stream, cls, entry, exit);
+}
+
+void WindowRing::addOccupancy(const std::uint64_t pts, const std::size_t roi, const std::uint32_t vehicles) {
+  mLastPts = std::max(mLastPts, pts);
+  ::occupancy::add(mOccupancy[mCurrent][roi], vehicles);
+}
+
+void WindowRing::advance(const std::uint64_t pts, const windowcb_t &windowCb) {
+  if (!mStarted) {
+    mSlotStart = mOrigin = pts - pts % mHop;
+    mStarted = true;
+  }
+  mLastPts = std::max(mLastPts, pts);
+  while (pts >= mSlotStart + mHop) {
+    if (empty()) {
+      // Nothing to publish until pts: jump straight to the slot holding it
+      // instead of walking every hop of the gap.
+      auto skipped = (pts - mSlotStart) / mHop;
+      mFilled = std::min(mFilled + skipped, static_cast<std::uint64_t>(mSlots.size()));
+      mSlotStart += skipped * mHop;
+      break;
+    }
+    mFilled = std::min(mFilled + 1, static_cast<std::uint64_t>(mSlots.size()));
+    close(false, windowCb);
+    mCurrent = (mCurrent + 1) % mSlots.size();
+    clearSlot(mCurrent);
+    mSlotStart += mHop;
+  }
+}
+
+void WindowRing::flush(const windowcb_t &windowCb) {
+  if (mStarted && !empty()) {
+    close(true, windowCb);
+  }
+}
+
+void WindowRing::close(const bool partial, const windowcb_t &windowCb) {
+  if (!windowCb) {
+    return;
+  }
+  window_aggregate_t aggregate{};
+  aggregate.mLength = static_cast<std::uint32_t>(mLength / NSEC_PER_SEC);
+  aggregate.mSliding = mSlots.size() > 1;
+  aggregate.mEnd = partial ? mLastPts : mSlotStart + mHop;
+  aggregate.mStart = mSlotStart + mHop >= mOrigin + mLength ?
+    mSlotStart + mHop - mLength : mOrigin;
+  aggregate.mPartial = partial || mFilled < mSlots.size();
+  aggregate.mCube = mSlots[0];
+  for (std::size_t idx = 1; idx < mSlots.size(); ++idx) {
+    ::odcube::accumulate(aggregate.mCube, mSlots[idx]);
+  }
+  aggregate.mMatrix = ::odcube::reduce(aggregate.mCube);
+  aggregate.mTotal = static_cast<std::uint32_t>(::odcube::total(aggregate.mCube));
+  bool occupied = false;
+  for (std::size_t roi = 0; roi < ::occupancy::MAX_ROIS; ++roi) {
+    auto &bucket = aggregate.mOccupancy[roi];
+    ::occupancy::clear(bucket, aggregate.mStart);
+    for (const auto &slot: mOccupancy) {
+      ::occupancy::merge(bucket, slot[roi]);
+    }
+    occupied = occupied || 0 != bucket.mSamples;
+  }
+  if (0 != aggregate.mTotal || occupied) {
+    windowCb(aggregate);
+  }
+}
+
+void WindowRing::clearSlot(const std::size_t idx) {
+  ::odcube::clear(mSlots[idx]);
+  for (auto &bucket: mOccupancy[idx]) {
+    ::occupancy::clear(bucket);
+  }
+}
+
+bool WindowRing::empty() const {
+  for (const auto &slot: mSlots) {
+    if (!::odcube::empty(slot)) {
+      return false;
+    }
+  }
+  for (const auto &slot: mOccupancy) {
+    for (const auto &bucket: slot) {
+      if (0 != bucket.mSamples) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void WindowRing::save(::checkpoint::Encoder &encoder) const {
+  encoder.put(mLength);
+  encoder.put(mHop);
+  encoder.put(static_cast<std::uint64_t>(mCurrent));
+  encoder.put(mFilled);
+  encoder.put(mOrigin);
+  encoder.put(mSlotStart);
+  encoder.put(mLastPts);
+  encoder.put(static_cast<std::uint8_t>(mStarted));
+  for (const auto &slot: mSlots) {
+    encoder.put(slot);
+  }
+}
+
+bool WindowRing::restore(::checkpoint::Decoder &decoder) {
+  std::uint64_t length = 0, hop = 0, current = 0;
+  std::uint8_t started = 0;
+  if (!decoder.get(length) || !decoder.get(hop) || length != mLength || hop != mHop ||
+      !decoder.get(current) || current >= mSlots.size() || !decoder.get(mFilled) ||
+      !decoder.get(mOrigin) || !decoder.get(mSlotStart) || !decoder.get(mLastPts) ||
+      !decoder.get(started)) {
+    return false;
+  }
+  mCurrent = static_cast<std::size_t>(current);
+  mStarted = 0 != started;
+  for (auto &slot: mSlots) {
+    if (!decoder.get(slot)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t WindowRing::stateSize() const {
+  return 7 * sizeof(std::uint64_t) + sizeof(std::uint8_t) + mSlots.size() * sizeof(::odcube::cube_t);
+}
+
+void WindowAggregator::configure(const windows_info_t &windowsInfo, const windowcb_t &windowCb) {
+  mRings.clear();
+  mWindowCb = windowCb;
+  for (const auto length: windowsInfo.mTumbling) {
+    mRings.emplace_back(length, length);
+  }
+  for (const auto length: windowsInfo.mSliding) {
+    mRings.emplace_back(length, windowsInfo.mSlidingHop);
+  }
+}
+
+void WindowAggregator::add(const std::uint64_t pts, const std::size_t stream, const std::size_t cls,
+  const std::size_t entry, const std::size_t exit) {
+  for (auto &ring: mRings) {
+    ring.advance(pts, mWindowCb);
+    ring.add(pts, stream, cls, entry, exit);
+  }
+}
+
+void WindowAggregator::addOccupancy(const std::uint64_t pts, const std::size_t roi,
+  const std::uint32_t vehicles) {
+  for (auto &ring: mRings) {
+    ring.addOccupancy(pts, roi, vehicles);
+  }
+}
+
+void WindowAggregator::advance(const std::uint64_t pts) {
+  for (auto &ring: mRings) {
+    ring.advance(pts, mWindowCb);
+  }
+}
+
+void WindowAggregator::flush() {
+  for (auto &ring: mRings) {
+    ring.flush(mWindowCb);
+  }
+}
+
+void WindowAggregator::save(::checkpoint::Encoder &encoder) const {
+  encoder.put(static_cast<std::uint64_t>(mRings.size()));
+  for (const auto &ring: mRings) {
+    ring.save(encoder);
+  }
+}
+
+bool WindowAggregator::restore(::checkpoint::Decoder &decoder) {
+  std::uint64_t count = 0;
+  if (!decoder.get(count) || count != mRings.size()) {
+    return false;
+  }
+  auto rings = mRings;
+  for (auto &ring: mRings) {
+    if (!ring.restore(decoder)) {
+      mRings.swap(rings);
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t WindowAggregator::stateSize() const {
+  std::size_t size = sizeof(std::uint64_t);
+  for (const auto &ring: mRings) {
+    size += ring.stateSize();
+  }
+  return size;
+}
+
+} // namespace odwindows
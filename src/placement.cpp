@@ -0,0 +1,313 @@
+#include "placement.h"
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "logger.h"
+
+namespace {
+
+constexpr auto NODE_CPULIST = "/sys/devices/system/node/node{}/cpulist";
+constexpr auto MAX_NODES = 64;
+constexpr auto MAX_THREAD_NAME = 15;
+constexpr auto THREAD_NAME_PREFIX = "vt-";
+
+// From linux/mempolicy.h, not every toolchain ships numaif.h
+constexpr int MPOL_DEFAULT_MODE = 0;
+constexpr int MPOL_PREFERRED_MODE = 1;
+
+constexpr auto ROLE_STREAMING = "streaming";
+constexpr auto ROLE_KAFKA = "kafka";
+constexpr auto ROLE_WORKER = "worker";
+
+struct Config {
+  std::map<std::string, placement::cpu_spec_t> mElements;
+  placement::cpu_spec_t mStreaming;
+  placement::cpu_spec_t mKafka;
+  placement::cpu_spec_t mWorkers;
+  int mRealtimePriority;
+  std::set<std::string> mRealtimeElements;
+};
+
+struct Placed {
+  std::string mName;
+  std::string mRole;
+  long mTid;
+  std::string mCpus;
+  int mNode;
+  std::string mPolicy;
+  int mPriority;
+};
+
+bool active = false;
+Config config;
+std::mutex registryMutex;
+std::vector<Placed> registry;
+
+std::string nodeCpuList(const int node) {
+  std::string path = NODE_CPULIST;
+  path.replace(path.find("{}"), 2, std::to_string(node));
+  std::ifstream file(path);
+  std::string list;
+  std::getline(file, list);
+  return list;
+}
+
+bool parseCpuList(const std::string &list, std::vector<int> &cpus) {
+  auto configured = get_nprocs_conf();
+  std::stringstream tokens(list);
+  std::string token;
+  while (std::getline(tokens, token, ',')) {
+    if (token.empty()) {
+      continue;
+    }
+    int first = -1, last = -1;
+    char extra = 0;
+    auto dash = token.find('-');
+    if (std::string::npos == dash) {
+      if (1 != std::sscanf(token.c_str(), "%d%c", &first, &extra)) {
+        return false;
+      }
+      last = first;
+    } else if (2 != std::sscanf(token.c_str(), "%d-%d%c", &first, &last, &extra)) {
+      return false;
+    }
+    if (first < 0 || last < first || last >= configured || last >= CPU_SETSIZE) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return !cpus.empty();
+}
+
+std::string formatCpus(const cpu_set_t &set) {
+  std::stringstream out;
+  int first = -1;
+  bool separator = false;
+  for (int cpu = 0; cpu <= CPU_SETSIZE; ++cpu) {
+    bool present = cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set);
+    if (present && first < 0) {
+      first = cpu;
+    } else if (!present && first >= 0) {
+      out << (separator ? "," : "") << first;
+      if (cpu - 1 > first) {
+        out << "-" << cpu - 1;
+      }
+      separator = true;
+      first = -1;
+    }
+  }
+  return out.str();
+}
+
+bool setMemoryPolicy(const int mode, const int node) {
+#ifdef SYS_set_mempolicy
+  unsigned long mask = node >= 0 ? 1UL << node : 0;
+  return 0 == syscall(SYS_set_mempolicy, mode, node >= 0 ? &mask : nullptr,
+    node >= 0 ? sizeof(mask) * 8 : 0);
+#else
+  return false;
+#endif
+}
+
+bool applyCpus(const placement::cpu_spec_t &spec) {
+  if (spec.mCpus.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu: spec.mCpus) {
+    CPU_SET(cpu, &set);
+  }
+  return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void record(const std::string &name, const std::string &role, const int node) {
+  Placed placed{name, role, static_cast<long>(syscall(SYS_gettid)), std::string(), node, std::string(), 0};
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (0 == pthread_getaffinity_np(pthread_self(), sizeof(set), &set)) {
+    placed.mCpus = formatCpus(set);
+  }
+  int policy = SCHED_OTHER;
+  sched_param param{};
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  placed.mPolicy = SCHED_FIFO == policy ? "fifo" : SCHED_RR == policy ? "rr" : "other";
+  placed.mPriority = param.sched_priority;
+  LOG_INFO("Thread {} ({}, tid {}) on cpus {}, memory node {}, {} priority {}", placed.mName,
+    placed.mRole, placed.mTid, placed.mCpus, placed.mNode, placed.mPolicy, placed.mPriority);
+  std::lock_guard<std::mutex> lock(registryMutex);
+  // Streaming tasks enter again after a pause or a flush, keep the latest
+  for (auto &known: registry) {
+    if (known.mName == placed.mName && known.mRole == placed.mRole) {
+      known = placed;
+      return;
+    }
+  }
+  registry.push_back(placed);
+}
+
+void place(const std::string &name, const std::string &role, const placement::cpu_spec_t &spec,
+  const int priority) {
+  auto threadName = (THREAD_NAME_PREFIX + name).substr(0, MAX_THREAD_NAME);
+  pthread_setname_np(pthread_self(), threadName.c_str());
+  if (!applyCpus(spec)) {
+    LOG_WARN("Unable to pin {} to its cpus: {}", name, std::strerror(errno));
+  }
+  if (spec.mNode >= 0 && !setMemoryPolicy(MPOL_PREFERRED_MODE, spec.mNode)) {
+    LOG_WARN("Unable to prefer memory node {} for {}", spec.mNode, name);
+  }
+  if (priority > 0) {
+    sched_param param{};
+    param.sched_priority = priority;
+    auto ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (0 != ret) {
+      LOG_WARN("Unable to make {} realtime ({}), needs CAP_SYS_NICE or an rtprio limit",
+        name, std::strerror(ret));
+    }
+  }
+  record(name, role, spec.mNode);
+}
+
+} // namespace
+
+namespace placement {
+
+cpu_spec_t parseCpuSpec(const std::string &spec) {
+  cpu_spec_t parsed;
+  if (spec.empty()) {
+    return parsed;
+  }
+  std::string list = spec;
+  if (0 == spec.compare(0, 5, "node:")) {
+    char extra = 0;
+    if (1 != std::sscanf(spec.c_str() + 5, "%d%c", &parsed.mNode, &extra) ||
+        parsed.mNode < 0 || parsed.mNode >= MAX_NODES) {
+      throw std::invalid_argument(std::string(ERR_MSG_CPU_SPEC) + ": " + spec);
+    }
+    list = nodeCpuList(parsed.mNode);
+    if (list.empty()) {
+      throw std::invalid_argument(std::string(ERR_MSG_NUMA_NODE) + ": " + spec);
+    }
+  }
+  if (!parseCpuList(list, parsed.mCpus)) {
+    throw std::invalid_argument(std::string(ERR_MSG_CPU_SPEC) + ": " + spec);
+  }
+  return parsed;
+}
+
+void configure(const placement_info_t &placementInfo) {
+  active = placementInfo.mEnable;
+  if (!active) {
+    return;
+  }
+  Config parsed;
+  for (const auto &element: placementInfo.mElements) {
+    parsed.mElements[element.first] = parseCpuSpec(element.second);
+  }
+  parsed.mStreaming = parseCpuSpec(placementInfo.mStreaming);
+  parsed.mKafka = parseCpuSpec(placementInfo.mKafka);
+  parsed.mWorkers = parseCpuSpec(placementInfo.mWorkers);
+  if (placementInfo.mRealtimePriority < 0 ||
+      placementInfo.mRealtimePriority > sched_get_priority_max(SCHED_FIFO)) {
+    throw std::invalid_argument(ERR_MSG_REALTIME_PRIORITY);
+  }
+  parsed.mRealtimePriority = placementInfo.mRealtimePriority;
+  parsed.mRealtimeElements.insert(placementInfo.mRealtimeElements.begin(),
+    placementInfo.mRealtimeElements.end());
+  config = parsed;
+}
+
+bool enabled() {
+  return active;
+}
+
+void placeStreamingThread(const std::string &element) {
+  if (!active) {
+    return;
+  }
+  auto spec = config.mElements.find(element);
+  auto priority = config.mRealtimeElements.count(element) ? config.mRealtimePriority : 0;
+  place(element, ROLE_STREAMING, spec != config.mElements.end() ? spec->second : config.mStreaming,
+    priority);
+}
+
+void placeWorker(const std::string &name) {
+  if (active) {
+    place(name, ROLE_WORKER, config.mWorkers, 0);
+  }
+}
+
+ScopedKafkaPlacement::ScopedKafkaPlacement():
+  mActive{active && (!config.mKafka.mCpus.empty() || config.mKafka.mNode >= 0)}
+{
+  if (!mActive) {
+    return;
+  }
+  CPU_ZERO(&mSaved);
+  pthread_getaffinity_np(pthread_self(), sizeof(mSaved), &mSaved);
+  if (!applyCpus(config.mKafka)) {
+    LOG_WARN("Unable to pin the kafka threads to their cpus: {}", std::strerror(errno));
+  }
+  if (config.mKafka.mNode >= 0) {
+    setMemoryPolicy(MPOL_PREFERRED_MODE, config.mKafka.mNode);
+  }
+  record("kafka-threads", ROLE_KAFKA, config.mKafka.mNode);
+}
+
+ScopedKafkaPlacement::~ScopedKafkaPlacement() {
+  if (!mActive) {
+    return;
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(mSaved), &mSaved);
+  if (config.mKafka.mNode >= 0) {
+    setMemoryPolicy(MPOL_DEFAULT_MODE, -1);
+  }
+}
+
+std::string describeHost() {
+  std::stringstream out;
+  out << get_nprocs() << " of " << get_nprocs_conf() << " cpus online";
+  for (int node = 0; node < MAX_NODES; ++node) {
+    auto list = nodeCpuList(node);
+    if (!list.empty()) {
+      out << ", node" << node << ": " << list;
+    }
+  }
+  return out.str();
+}
+
+std::string reportJson() {
+  std::stringstream out;
+  out << "{\"enabled\":" << (active ? "true" : "false") << ", \"threads\":[";
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (std::size_t idx = 0; idx < registry.size(); ++idx) {
+    const auto &placed = registry[idx];
+    out << (idx ? "," : "") << "{\"name\":" << std::quoted(placed.mName);
+    out << ", \"role\":" << std::quoted(placed.mRole);
+    out << ", \"tid\":" << placed.mTid;
+    out << ", \"cpus\":" << std::quoted(placed.mCpus);
+    out << ", \"node\":" << placed.mNode;
+    out << ", \"policy\":" << std::quoted(placed.mPolicy);
+    out << ", \"priority\":" << placed.mPriority << "}";
+  }
+  out << "]}";
+  return out.str();
+}
+
+} // namespace placement
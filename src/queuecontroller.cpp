@@ -0,0 +1,125 @@
+#include "queuecontroller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// Mean level, in buffers, below which a queue is not holding anything back
+constexpr auto MIN_BOTTLENECK_LEVEL = 1.0;
+// Cap on how far a reverted shrink pushes out the next one, in windows
+constexpr std::uint32_t MAX_BACKOFF = 16;
+} // namespace
+
+namespace queuecontrol {
+
+QueueController::QueueController(const queue_control_info_t &info, const std::size_t count):
+  mInfo{info},
+  mBottleneck{NO_BOTTLENECK}
+{
+  if (0 == info.mMinBuffers || info.mMinBuffers > info.mMaxBuffers) {
+    throw std::invalid_argument(ERR_MSG_BUFFER_BOUNDS);
+  }
+  if (info.mHeadroom < 1.0) {
+    throw std::invalid_argument(ERR_MSG_HEADROOM);
+  }
+  mInfo.mWindow = std::max<std::uint32_t>(mInfo.mWindow, 1);
+  // Start deep and let the samples bring each queue down
+  mQueues.resize(count);
+  for (auto &queue: mQueues) {
+    queue.mSetting = queue_setting_t{mInfo.mMaxBuffers, Leaky::No};
+    queue.mLeakAllowed = false;
+    queue.mRequired = mInfo.mWindow;
+    queue.mProbation = 0;
+    queue.mMean = 0.0;
+    this->restart(queue);
+  }
+  for (const auto idx: info.mLeakyQueues) {
+    if (0 == idx || idx > count) {
+      throw std::invalid_argument(ERR_MSG_LEAKY_QUEUE);
+    }
+    mQueues[idx - 1].mLeakAllowed = true;
+  }
+}
+
+std::vector<std::size_t> QueueController::update(const std::vector<std::uint32_t> &levels) {
+  std::vector<std::size_t> changed;
+  auto busiest = MIN_BOTTLENECK_LEVEL;
+  auto smoothing = 2.0 / (mInfo.mWindow + 1);
+  mBottleneck = NO_BOTTLENECK;
+  for (std::size_t idx = 0; idx < mQueues.size() && idx < levels.size(); ++idx) {
+    auto &queue = mQueues[idx];
+    queue.mMean += smoothing * (levels[idx] - queue.mMean);
+    if (queue.mMean >= busiest) {
+      busiest = queue.mMean;
+      mBottleneck = static_cast<int>(idx);
+    }
+    if (this->adjust(queue, levels[idx])) {
+      changed.push_back(idx);
+    }
+  }
+  return changed;
+}
+
+std::uint32_t QueueController::peak(const std::size_t idx) const {
+  const auto &levels = mQueues[idx].mLevels;
+  return levels.empty() ? 0 : *std::max_element(levels.begin(), levels.end());
+}
+
+bool QueueController::adjust(Queue &queue, const std::uint32_t level) {
+  auto &setting = queue.mSetting;
+  if (queue.mProbation > 0 && 0 == --queue.mProbation) {
+    // The last shrink held, the next one may come after a single window again
+    queue.mRequired = mInfo.mWindow;
+  }
+  if (level >= setting.mMaxBuffers) {
+    // Shrinking needs a whole window without hitting the limit, start over
+    this->restart(queue);
+    if (queue.mProbation > 0) {
+      // Shrunk below a burst that comes back less often than a window,
+      // look further back before the next shrink
+      queue.mRequired = std::min(queue.mRequired * 2, mInfo.mWindow * MAX_BACKOFF);
+      queue.mProbation = 0;
+    }
+    if (setting.mMaxBuffers < mInfo.mMaxBuffers) {
+      setting.mMaxBuffers = std::min(setting.mMaxBuffers * 2, mInfo.mMaxBuffers);
+      return true;
+    }
+    if (queue.mLeakAllowed && Leaky::No == setting.mLeaky) {
+      setting.mLeaky = Leaky::Downstream;
+      return true;
+    }
+    return false;
+  }
+
+  queue.mLevels.push_back(level);
+  while (queue.mLevels.size() > queue.mRequired) {
+    queue.mLevels.pop_front();
+  }
+  if (queue.mLevels.size() < queue.mRequired) {
+    return false;
+  }
+
+  auto peak = *std::max_element(queue.mLevels.begin(), queue.mLevels.end());
+  auto target = static_cast<std::uint32_t>(std::ceil(peak * mInfo.mHeadroom)) + 1;
+  target = std::max(std::min(target, mInfo.mMaxBuffers), mInfo.mMinBuffers);
+  if (Leaky::No != setting.mLeaky) {
+    // Calm again, stop dropping before shrinking any further
+    setting.mLeaky = Leaky::No;
+    this->restart(queue);
+    return true;
+  }
+  if (target < setting.mMaxBuffers) {
+    setting.mMaxBuffers -= (setting.mMaxBuffers - target + 1) / 2;
+    this->restart(queue);
+    queue.mProbation = queue.mRequired * 2;
+    return true;
+  }
+  return false;
+}
+
+void QueueController::restart(Queue &queue) {
+  queue.mLevels.clear();
+}
+
+} // namespace queuecontrol
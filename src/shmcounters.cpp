@@ -0,0 +1,202 @@
+#include "shmcounters.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr std::uint64_t SEGMENT_MAGIC = 0x31444f4d48535456ULL; // "VTSHMOD1"
+constexpr std::uint32_t SEGMENT_VERSION = 1;
+constexpr auto INIT_WAIT = std::chrono::milliseconds(10);
+constexpr auto INIT_RETRIES = 100;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+  "Shared counters must be lock-free across processes");
+static_assert(sizeof(shmcounters::ProcessSlot) % 64 == 0, "Slots must fill whole cache lines");
+
+bool processAlive(const std::int32_t pid) {
+  // Only meaningful within one pid namespace
+  return 0 == kill(pid, 0) || EPERM == errno;
+}
+
+} // namespace
+
+namespace shmcounters {
+
+SharedCounters::SharedCounters(const shared_counters_info_t &countersInfo,
+  const std::vector<std::string> &gateNames):
+  mName{countersInfo.mName},
+  mFd{-1},
+  mSegment{nullptr},
+  mSlot{nullptr},
+  mSlotIdx{0}
+{
+  bool creator = true;
+  mFd = shm_open(mName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (mFd < 0 && EEXIST == errno) {
+    creator = false;
+    mFd = shm_open(mName.c_str(), O_RDWR, 0644);
+  }
+  if (mFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_SEGMENT) + ": " + mName);
+  }
+  if (creator && 0 != ftruncate(mFd, sizeof(Segment))) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_SEGMENT) + ": " + std::strerror(errno));
+  }
+  this->map(true);
+  if (creator) {
+    // The segment is zero filled, counters and pids start at 0
+    mSegment->mProcesses = MAX_PROCESSES;
+    mSegment->mGates = N;
+    for (std::size_t idx = 0; idx < N && idx < gateNames.size(); ++idx) {
+      std::strncpy(mSegment->mGateNames[idx], gateNames[idx].c_str(), MAX_GATE_LEN - 1);
+    }
+    mSegment->mVersion = SEGMENT_VERSION;
+    mSegment->mMagic.store(SEGMENT_MAGIC, std::memory_order_release);
+  } else {
+    this->waitReady();
+  }
+  this->claim(countersInfo.mLabel);
+}
+
+SharedCounters::SharedCounters(const std::string &name):
+  mName{name},
+  mFd{-1},
+  mSegment{nullptr},
+  mSlot{nullptr},
+  mSlotIdx{0}
+{
+  mFd = shm_open(mName.c_str(), O_RDONLY, 0);
+  if (mFd < 0) {
+    throw std::runtime_error(std::string(ERR_MSG_OPEN_SEGMENT) + ": " + mName);
+  }
+  this->map(false);
+  this->waitReady();
+}
+
+SharedCounters::~SharedCounters() {
+  if (nullptr != mSegment) {
+    munmap(mSegment, sizeof(Segment));
+  }
+  if (mFd >= 0) {
+    close(mFd);
+  }
+}
+
+void SharedCounters::map(const bool writable) {
+  // Another process may be creating the segment right now, give it time
+  // to size and stamp it.
+  struct stat st{};
+  for (auto retry = 0; retry < INIT_RETRIES; ++retry) {
+    if (0 == fstat(mFd, &st) && static_cast<std::size_t>(st.st_size) >= sizeof(Segment)) {
+      break;
+    }
+    std::this_thread::sleep_for(INIT_WAIT);
+  }
+  if (static_cast<std::size_t>(st.st_size) < sizeof(Segment)) {
+    throw std::runtime_error(ERR_MSG_SEGMENT_LAYOUT);
+  }
+  void *base = mmap(nullptr, sizeof(Segment), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+    MAP_SHARED, mFd, 0);
+  if (MAP_FAILED == base) {
+    throw std::runtime_error(std::string(ERR_MSG_MAP_SEGMENT) + ": " + mName);
+  }
+  mSegment = static_cast<Segment*>(base);
+}
+
+void SharedCounters::waitReady() const {
+  for (auto retry = 0; retry < INIT_RETRIES &&
+      SEGMENT_MAGIC != mSegment->mMagic.load(std::memory_order_acquire); ++retry) {
+    std::this_thread::sleep_for(INIT_WAIT);
+  }
+  if (SEGMENT_MAGIC != mSegment->mMagic.load(std::memory_order_acquire) ||
+      SEGMENT_VERSION != mSegment->mVersion || N != mSegment->mGates) {
+    throw std::runtime_error(ERR_MSG_SEGMENT_LAYOUT);
+  }
+}
+
+void SharedCounters::claim(const std::string &label) {
+  auto pid = static_cast<std::int32_t>(getpid());
+  // Adopt the slice a previous run with the same label left behind
+  for (std::size_t idx = 0; idx < MAX_PROCESSES; ++idx) {
+    auto &slot = mSegment->mSlots[idx];
+    auto owner = slot.mPid.load(std::memory_order_acquire);
+    if (owner > 0 && !processAlive(owner) &&
+        0 == std::strncmp(slot.mLabel, label.c_str(), MAX_LABEL_LEN - 1) &&
+        slot.mPid.compare_exchange_strong(owner, -pid)) {
+      this->publish(idx, label, false);
+      return;
+    }
+  }
+  for (std::size_t idx = 0; idx < MAX_PROCESSES; ++idx) {
+    std::int32_t unclaimed = 0;
+    if (mSegment->mSlots[idx].mPid.compare_exchange_strong(unclaimed, -pid)) {
+      this->publish(idx, label, false);
+      return;
+    }
+  }
+  // Every slot taken: the slice of a gone process, or of one that died
+  // while claiming, goes to the new label
+  for (std::size_t idx = 0; idx < MAX_PROCESSES; ++idx) {
+    auto &slot = mSegment->mSlots[idx];
+    auto owner = slot.mPid.load(std::memory_order_acquire);
+    if (0 != owner && !processAlive(owner > 0 ? owner : -owner) &&
+        slot.mPid.compare_exchange_strong(owner, -pid)) {
+      std::cerr << "Shared counters slot " << idx << " reclaimed from pid " << (owner > 0 ? owner : -owner)
+                << ", which is gone, its counts are dropped" << std::endl;
+      this->publish(idx, label, true);
+      return;
+    }
+  }
+  throw std::runtime_error(ERR_MSG_NO_FREE_SLOT);
+}
+
+void SharedCounters::publish(const std::size_t idx, const std::string &label, const bool reset) {
+  auto &slot = mSegment->mSlots[idx];
+  std::memset(slot.mLabel, 0, MAX_LABEL_LEN);
+  std::strncpy(slot.mLabel, label.c_str(), MAX_LABEL_LEN - 1);
+  if (reset) {
+    for (auto &entry: slot.mCounts) {
+      for (auto &count: entry) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+    slot.mUpdated.store(0, std::memory_order_relaxed);
+  }
+  // Readers that see the pid see the label and the counts with it
+  slot.mPid.store(static_cast<std::int32_t>(getpid()), std::memory_order_release);
+  mSlot = &slot;
+  mSlotIdx = idx;
+}
+
+od_totals_t SharedCounters::totals() const {
+  od_totals_t totals{};
+  for (const auto &slot: mSegment->mSlots) {
+    if (slot.mPid.load(std::memory_order_acquire) <= 0) {
+      continue;
+    }
+    for (std::size_t entry = 0; entry < N; ++entry) {
+      for (std::size_t exit = 0; exit < N; ++exit) {
+        totals[entry][exit] += slot.mCounts[entry][exit].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return totals;
+}
+
+bool SharedCounters::alive(const ProcessSlot &slot) {
+  auto pid = slot.mPid.load(std::memory_order_acquire);
+  return pid > 0 && processAlive(pid);
+}
+
+} // namespace shmcounters
@@ -0,0 +1,200 @@
+#include "sourcemanager.h"
+
+#include <stdexcept>
+
+#include "logger.h"
+
+namespace {
+
+constexpr auto ELEMENT_SOURCE_FILE = "filesrc";
+constexpr auto ELEMENT_PARSE_H264 = "h264parse";
+constexpr auto ELEMENT_DECODER_NVV4L2 = "nvv4l2decoder";
+
+constexpr auto ELEMENT_NAME_SOURCE_BIN = "source-bin-";
+constexpr auto ELEMENT_NAME_SOURCE_FILE = "file-source-";
+constexpr auto ELEMENT_NAME_PARSE_H264 = "h264-parser-";
+constexpr auto ELEMENT_NAME_DECODER_NVV4L2 = "nvv4l2-decoder-";
+
+constexpr auto PAD_NAME_SINK = "sink_";
+constexpr auto PAD_NAME_SRC = "src";
+
+// The DeepStream runtime source add/delete sample: stopped first so no
+// buffer is in flight, then the muxer pad is flushed and released, which
+// sends pad-deleted downstream
+void detach(GstElement *pipeline, GstElement *streammux, GstElement *bin, const std::string &padName) {
+  if (GST_STATE_CHANGE_ASYNC == gst_element_set_state (bin, GST_STATE_NULL)) {
+    gst_element_get_state (bin, nullptr, nullptr, GST_CLOCK_TIME_NONE);
+  }
+  GstPad *sinkPad = gst_element_get_static_pad (streammux, padName.c_str());
+  if (nullptr != sinkPad) {
+    gst_pad_send_event (sinkPad, gst_event_new_flush_stop (FALSE));
+    gst_element_release_request_pad (streammux, sinkPad);
+    gst_object_unref (sinkPad);
+  }
+  gst_bin_remove (GST_BIN (pipeline), bin);
+}
+
+// Stream time of the last frame out of the source bin, answered by
+// h264parse, -1 before the first
+gint64 position(GstElement *bin) {
+  gint64 position = -1;
+  GstPad *binSrc = gst_element_get_static_pad (bin, PAD_NAME_SRC);
+  if (!gst_pad_query_position (binSrc, GST_FORMAT_TIME, &position)) {
+    position = -1;
+  }
+  gst_object_unref (binSrc);
+  return position;
+}
+
+// A flushing seek of the source bin alone, from its src pad upstream to
+// h264parse. A source on its own timeline, one added while the pipeline
+// played, never gets the position of another.
+bool seek(GstElement *bin, const gint64 position) {
+  GstPad *binSrc = gst_element_get_static_pad (bin, PAD_NAME_SRC);
+  bool sought = gst_pad_send_event (binSrc, gst_event_new_seek (1.0, GST_FORMAT_TIME,
+    static_cast<GstSeekFlags>(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
+    GST_SEEK_TYPE_SET, position, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE));
+  gst_object_unref (binSrc);
+  return sought;
+}
+
+} // namespace
+
+namespace sources {
+
+SourceManager::SourceManager(GstElement *pipeline, GstElement *streammux, const sources_info_t &info,
+  const added_t &added):
+  mPipeline{pipeline},
+  mStreammux{streammux},
+  mInfo{info},
+  mAdded{added}
+{}
+
+void SourceManager::add(const std::uint32_t id, const std::string &location) {
+  if (id >= mInfo.mMaxSources) {
+    throw std::runtime_error(std::string(ERR_MSG_ID) + ": " + std::to_string(id));
+  }
+  if (mBins.count(id)) {
+    throw std::runtime_error(std::string(ERR_MSG_RUNNING) + ": " + std::to_string(id));
+  }
+  auto suffix = std::to_string(id);
+  GstElement *bin = gst_bin_new ((ELEMENT_NAME_SOURCE_BIN + suffix).c_str());
+  GstElement *source = gst_element_factory_make (ELEMENT_SOURCE_FILE, (ELEMENT_NAME_SOURCE_FILE + suffix).c_str());
+  GstElement *h264parser = gst_element_factory_make (ELEMENT_PARSE_H264, (ELEMENT_NAME_PARSE_H264 + suffix).c_str());
+  GstElement *decoder = gst_element_factory_make (ELEMENT_DECODER_NVV4L2, (ELEMENT_NAME_DECODER_NVV4L2 + suffix).c_str());
+  if (nullptr == bin || nullptr == source || nullptr == h264parser || nullptr == decoder) {
+    for (auto *element: {bin, source, h264parser, decoder}) {
+      if (nullptr != element) {
+        gst_object_unref (element);
+      }
+    }
+    throw std::runtime_error(std::string(ERR_MSG_ELEMENT) + " for source " + suffix);
+  }
+  g_object_set (G_OBJECT (source), "location", location.c_str(), nullptr);
+  gst_bin_add_many (GST_BIN (bin), source, h264parser, decoder, nullptr);
+  if (!gst_element_link_many (source, h264parser, decoder, nullptr)) {
+    gst_object_unref (bin);
+    throw std::runtime_error(std::string(ERR_MSG_LINK) + ": source " + suffix);
+  }
+  GstPad *decoderSrc = gst_element_get_static_pad (decoder, PAD_NAME_SRC);
+  gst_element_add_pad (bin, gst_ghost_pad_new (PAD_NAME_SRC, decoderSrc));
+  gst_object_unref (decoderSrc);
+
+  gst_bin_add (GST_BIN (mPipeline), bin);
+  auto padName = PAD_NAME_SINK + suffix;
+  GstPad *sinkPad = gst_element_get_request_pad (mStreammux, padName.c_str());
+  if (nullptr == sinkPad) {
+    gst_bin_remove (GST_BIN (mPipeline), bin);
+    throw std::runtime_error(std::string(ERR_MSG_PAD) + " " + padName);
+  }
+  GstPad *binSrc = gst_element_get_static_pad (bin, PAD_NAME_SRC);
+  bool linked = GST_PAD_LINK_OK == gst_pad_link (binSrc, sinkPad);
+  gst_object_unref (binSrc);
+  gst_object_unref (sinkPad);
+  if (!linked) {
+    detach(mPipeline, mStreammux, bin, padName);
+    throw std::runtime_error(std::string(ERR_MSG_LINK) + " " + padName);
+  }
+  // Joins the running pipeline, the other sources go on
+  if (!gst_element_sync_state_with_parent (bin)) {
+    detach(mPipeline, mStreammux, bin, padName);
+    throw std::runtime_error(std::string(ERR_MSG_STATE) + " " + suffix);
+  }
+  mBins[id] = bin;
+  mRunning[id] = location;
+  LOG_INFO("Source {} from {} on {}", id, location, padName);
+  if (mAdded) {
+    mAdded(id, bin);
+  }
+}
+
+void SourceManager::remove(const std::uint32_t id) {
+  auto bin = mBins.find(id);
+  if (bin == mBins.end()) {
+    LOG_WARN("Source {} is not running, nothing to remove", id);
+    return;
+  }
+  detach(mPipeline, mStreammux, bin->second, PAD_NAME_SINK + std::to_string(id));
+  mBins.erase(bin);
+  mRunning.erase(id);
+  LOG_INFO("Source {} removed from the pipeline", id);
+}
+
+void SourceManager::update(const source_list_t &sourceList) {
+  for (auto running = mRunning.begin(); running != mRunning.end();) {
+    auto wanted = sourceList.find(running->first);
+    auto id = running->first;
+    ++running;
+    if (0 == id) {
+      continue;
+    }
+    if (wanted == sourceList.end() || wanted->second != mRunning[id]) {
+      this->remove(id);
+    }
+  }
+  for (const auto &wanted: sourceList) {
+    if (mRunning.count(wanted.first)) {
+      continue;
+    }
+    try {
+      this->add(wanted.first, wanted.second);
+    } catch (const std::exception &ex) {
+      LOG_ERROR("Source {} not added: {}", wanted.first, ex.what());
+    }
+  }
+}
+
+void SourceManager::restart(const std::uint32_t id) {
+  auto running = mRunning.find(id);
+  if (running == mRunning.end()) {
+    return;
+  }
+  auto location = running->second;
+  auto resumeAt = position(mBins[id]);
+  this->remove(id);
+  this->add(id, location);
+  if (resumeAt <= 0) {
+    return;
+  }
+  if (seek(mBins[id], resumeAt)) {
+    LOG_INFO("Source {} resumed at {} ms", id, resumeAt / GST_MSECOND);
+  } else {
+    LOG_WARN("Source {} could not resume at {} ms, starts from the beginning", id, resumeAt / GST_MSECOND);
+  }
+}
+
+void SourceManager::flush() {
+  for (const auto &bin: mBins) {
+    auto at = position(bin.second);
+    if (at < 0 || !seek(bin.second, at)) {
+      LOG_WARN("Unable to flush source {}", bin.first);
+    }
+  }
+}
+
+GstElement *SourceManager::bin(const std::uint32_t id) const {
+  auto bin = mBins.find(id);
+  return bin == mBins.end() ? nullptr : bin->second;
+}
+
+} // namespace sources
@@ -0,0 +1,71 @@
+#include "sourceparser.h"
+
+#include <glib.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr auto CONFIG_GROUP_SOURCE_PREFIX = "source-";
+constexpr auto CONFIG_GROUP_SOURCE_LOCATION = "location";
+
+#define CHECK_ERROR(error) \
+  if (error) { \
+    std::cerr << "Error while parsing config file: " << error->message << std::endl; \
+    goto done; \
+  }
+
+} // namespace
+
+namespace sourceparser {
+
+bool parseSourcesConfig (sources::source_list_t& sourceList, const std::uint32_t maxSources) {
+  GError *error = nullptr;
+
+  GKeyFile *key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, SOURCES_CONFIG_FILE, G_KEY_FILE_NONE,
+          &error)) {
+    bool missing = g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+    if (!missing) {
+      std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    }
+    g_error_free (error);
+    g_key_file_free (key_file);
+    return missing;
+  }
+  bool ret = false;
+  gchar **groups = g_key_file_get_groups (key_file, nullptr);
+  for (gchar **group = groups; *group != nullptr; ++group) {
+    if (!g_str_has_prefix (*group, CONFIG_GROUP_SOURCE_PREFIX)) {
+      std::cerr << "Unknown group [" << *group << "]" << std::endl;
+      continue;
+    }
+    const char *id = *group + std::strlen(CONFIG_GROUP_SOURCE_PREFIX);
+    char *end = nullptr;
+    auto source = std::strtoul(id, &end, 10);
+    // Source 0 is the file of the command line
+    if (end == id || '\0' != *end || 0 == source || source >= maxSources) {
+      std::cerr << "Invalid source id [" << *group << "], max-sources is " << maxSources << std::endl;
+      goto done;
+    }
+    gchar *location = g_key_file_get_string (key_file, *group,
+                  CONFIG_GROUP_SOURCE_LOCATION, &error);
+    CHECK_ERROR (error);
+    sourceList[static_cast<std::uint32_t>(source)] = location;
+    g_free (location);
+  }
+  ret = true;
+done:
+  if (error != nullptr) {
+    g_error_free (error);
+  }
+  g_strfreev (groups);
+  g_key_file_free (key_file);
+  if (!ret) {
+    std::cerr << __func__ << " failed" << std::endl;
+  }
+  return ret;
+}
+
+} // namespace sourceparser
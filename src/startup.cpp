@@ -0,0 +1,79 @@
+#include "startup.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+#include "logger.h"
+#include "metrics.h"
+
+namespace {
+
+using steady_clock_t = std::chrono::steady_clock;
+
+constexpr std::array<const char*, startup::PHASES> PHASE_NAMES{{
+  "config", "gst_init", "pipeline", "kafka", "playing", "first_frame", "first_event"}};
+constexpr auto METRIC_STARTUP = "vt_startup_seconds";
+constexpr auto METRIC_STARTUP_HELP = "Time from process start to each startup phase";
+
+// Static initialization, as close to exec as this process gets
+const steady_clock_t::time_point processStart = steady_clock_t::now();
+
+// Nanoseconds from process start, 0 until reached
+std::array<std::atomic<std::int64_t>, startup::PHASES> reached{};
+
+std::array<metrics::Gauge*, startup::PHASES> registerGauges() {
+  std::array<metrics::Gauge*, startup::PHASES> gauges{};
+  for (std::size_t idx = 0; idx < startup::PHASES; ++idx) {
+    gauges[idx] = &metrics::gauge(METRIC_STARTUP, METRIC_STARTUP_HELP,
+      std::string("phase=\"") + PHASE_NAMES[idx] + "\"");
+  }
+  return gauges;
+}
+
+// Registered up front like every other metric, a mark only sets its gauge
+const std::array<metrics::Gauge*, startup::PHASES> gauges = registerGauges();
+
+} // namespace
+
+namespace startup {
+
+void mark(const Phase phase) {
+  auto idx = static_cast<std::size_t>(phase);
+  // Once per buffer from the probe, cheap after the first
+  if (0 != reached[idx].load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    steady_clock_t::now() - processStart).count();
+  std::int64_t unset = 0;
+  if (!reached[idx].compare_exchange_strong(unset, ns > 0 ? ns : 1)) {
+    return;
+  }
+  gauges[idx]->set(ns / 1e9);
+  LOG_INFO("Startup: {} after {} ms", PHASE_NAMES[idx], ns / 1e6);
+}
+
+double elapsedMs(const Phase phase) {
+  auto ns = reached[static_cast<std::size_t>(phase)].load(std::memory_order_relaxed);
+  return 0 == ns ? -1.0 : ns / 1e6;
+}
+
+std::string json() {
+  std::stringstream out;
+  out << "{";
+  for (std::size_t idx = 0; idx < PHASES; ++idx) {
+    auto ms = elapsedMs(static_cast<Phase>(idx));
+    out << (idx ? ", " : "") << "\"" << PHASE_NAMES[idx] << "_ms\":";
+    if (ms < 0) {
+      out << "null";
+    } else {
+      out << ms;
+    }
+  }
+  out << "}";
+  return out.str();
+}
+
+} // namespace startup
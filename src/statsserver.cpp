@@ -0,0 +1,242 @@
+#include "statsserver.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "logger.h"
+#include "placement.h"
+
+namespace {
+constexpr auto POLL_TIMEOUT_MS = 100;
+constexpr auto REQUEST_TIMEOUT_MS = 1000;
+constexpr auto MAX_CLIENTS = 64;
+constexpr auto MAX_REQUEST_SIZE = 4096;
+constexpr auto LISTEN_BACKLOG = 16;
+
+constexpr auto CONTENT_TYPE_TEXT = "text/plain";
+
+std::int64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void setNonBlocking(const int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void writeAll(const int fd, const std::string &data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    auto ret = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (ret > 0) {
+      sent += static_cast<std::size_t>(ret);
+      continue;
+    }
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pollfd pfd{fd, POLLOUT, 0};
+      if (poll(&pfd, 1, POLL_TIMEOUT_MS) > 0) {
+        continue;
+      }
+    }
+    return;
+  }
+}
+
+std::string response(const int status, const char *reason, const std::string &contentType,
+  const std::string &body) {
+  std::stringstream out;
+  out << "HTTP/1.0 " << status << " " << reason << "\r\n";
+  out << "Content-Type: " << contentType << "\r\n";
+  out << "Content-Length: " << body.size() << "\r\n";
+  out << "Cache-Control: no-store\r\n";
+  out << "Connection: close\r\n\r\n";
+  out << body;
+  return out.str();
+}
+
+} // namespace
+
+namespace statsserver {
+
+StatsServer::StatsServer(const stats_info_t &statsInfo):
+  mStatsInfo{statsInfo},
+  mListenFd{-1},
+  mEndPolling{false} {}
+
+StatsServer::~StatsServer() {
+  mEndPolling = true;
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+  for (const auto &client: mClients) {
+    close(client.mFd);
+  }
+  if (mListenFd >= 0) {
+    close(mListenFd);
+  }
+  if (!mStatsInfo.mUnixSocket.empty()) {
+    unlink(mStatsInfo.mUnixSocket.c_str());
+  }
+}
+
+void StatsServer::addRoute(const std::string &path, const std::string &contentType,
+  const handler_t &handler) {
+  mRoutes[path] = Route{contentType, handler};
+}
+
+void StatsServer::start() {
+  mListenFd = this->listen();
+  mThread = std::thread([this]() {
+    placement::placeWorker("stats-server");
+    while (!mEndPolling) {
+      this->serve();
+    }
+  });
+}
+
+int StatsServer::listen() {
+  int fd = -1;
+  int ret = -1;
+  if (!mStatsInfo.mUnixSocket.empty()) {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      throw std::runtime_error(ERR_MSG_CREATE_SOCKET);
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, mStatsInfo.mUnixSocket.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(addr.sun_path);
+    ret = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  } else {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      throw std::runtime_error(ERR_MSG_CREATE_SOCKET);
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(mStatsInfo.mPort);
+    if (1 != inet_pton(AF_INET, mStatsInfo.mAddress.c_str(), &addr.sin_addr)) {
+      close(fd);
+      throw std::runtime_error(std::string(ERR_MSG_BIND_SOCKET) + ": invalid address " + mStatsInfo.mAddress);
+    }
+    ret = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  }
+  if (ret < 0) {
+    auto err = std::string(ERR_MSG_BIND_SOCKET) + ": " + std::strerror(errno);
+    close(fd);
+    throw std::runtime_error(err);
+  }
+  if (::listen(fd, LISTEN_BACKLOG) < 0) {
+    close(fd);
+    throw std::runtime_error(ERR_MSG_LISTEN_SOCKET);
+  }
+  setNonBlocking(fd);
+  return fd;
+}
+
+void StatsServer::serve() {
+  std::vector<pollfd> pfds;
+  pfds.reserve(mClients.size() + 1);
+  pfds.push_back(pollfd{mListenFd, POLLIN, 0});
+  for (const auto &client: mClients) {
+    pfds.push_back(pollfd{client.mFd, POLLIN, 0});
+  }
+  if (poll(pfds.data(), pfds.size(), POLL_TIMEOUT_MS) < 0) {
+    return;
+  }
+
+  auto now = nowMs();
+  std::vector<Client> pending;
+  pending.reserve(mClients.size());
+  for (std::size_t idx = 0; idx < mClients.size(); ++idx) {
+    auto &client = mClients[idx];
+    bool done = false;
+    if (pfds[idx + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+      done = this->readRequest(client);
+      if (done) {
+        this->respond(client);
+      }
+    }
+    if (done || now > client.mDeadline) {
+      close(client.mFd);
+    } else {
+      pending.push_back(std::move(client));
+    }
+  }
+  mClients.swap(pending);
+
+  if (pfds[0].revents & POLLIN) {
+    int fd = -1;
+    while ((fd = accept(mListenFd, nullptr, nullptr)) >= 0) {
+      if (mClients.size() >= MAX_CLIENTS) {
+        close(fd);
+        continue;
+      }
+      setNonBlocking(fd);
+      mClients.push_back(Client{fd, now + REQUEST_TIMEOUT_MS, std::string()});
+    }
+  }
+}
+
+bool StatsServer::readRequest(Client &client) {
+  char buffer[1024];
+  for (;;) {
+    auto ret = recv(client.mFd, buffer, sizeof(buffer), 0);
+    if (ret > 0) {
+      client.mRequest.append(buffer, static_cast<std::size_t>(ret));
+      if (client.mRequest.size() > MAX_REQUEST_SIZE) {
+        return true;
+      }
+      continue;
+    }
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return client.mRequest.find("\r\n\r\n") != std::string::npos;
+    }
+    // Peer closed or failed, answer what we have
+    return true;
+  }
+}
+
+void StatsServer::respond(const Client &client) {
+  std::istringstream request(client.mRequest);
+  std::string method, target;
+  request >> method >> target;
+  auto query = target.find('?');
+  if (query != std::string::npos) {
+    target.resize(query);
+  }
+  if (method != "GET") {
+    writeAll(client.mFd, response(405, "Method Not Allowed", CONTENT_TYPE_TEXT, "GET only\n"));
+    return;
+  }
+  auto route = mRoutes.find(target);
+  if (route == mRoutes.end()) {
+    std::string body = "Routes:\n";
+    for (const auto &known: mRoutes) {
+      body += known.first + "\n";
+    }
+    writeAll(client.mFd, response(404, "Not Found", CONTENT_TYPE_TEXT, body));
+    return;
+  }
+  try {
+    writeAll(client.mFd, response(200, "OK", route->second.mContentType, route->second.mHandler()));
+  } catch (const std::exception &ex) {
+    LOG_WARN("Stats route {} failed: {}", target, ex.what());
+    writeAll(client.mFd, response(500, "Internal Server Error", CONTENT_TYPE_TEXT, "\n"));
+  }
+}
+
+} // namespace statsserver
@@ -0,0 +1,223 @@
+#include "stitcher.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// Weight of the latest displacement in the velocity estimate
+constexpr auto VELOCITY_SMOOTHING = 0.3;
+// Keeps cell coordinates positive for any on-screen position
+constexpr std::int64_t CELL_OFFSET = 1 << 30;
+constexpr std::uint64_t FREE_SLOT = ::flatmap::FlatMap<std::uint32_t>::EMPTY_KEY;
+constexpr double NS_PER_SEC = 1e9;
+// Tracks in view of one camera before the pools have to grow
+constexpr std::size_t TRACK_CAPACITY = 512;
+} // namespace
+
+namespace stitching {
+
+constexpr std::uint32_t TrackStitcher::NIL;
+
+TrackStitcher::TrackStitcher(const stitching_info_t &info):
+  mInfo{info},
+  mWindow{static_cast<std::uint64_t>(info.mWindowMs) * 1000000},
+  mCellSize{info.mMaxDistance},
+  mNow{0},
+  mFree{NIL},
+  mStitched{0}
+{
+  if (0 == info.mWindowMs) {
+    throw std::invalid_argument(ERR_MSG_WINDOW);
+  }
+  if (info.mMaxDistance <= 0.0) {
+    throw std::invalid_argument(ERR_MSG_MAX_DISTANCE);
+  }
+  if (info.mMaxSpeed <= 0.0) {
+    throw std::invalid_argument(ERR_MSG_MAX_SPEED);
+  }
+  mActive.reserve(TRACK_CAPACITY);
+  mLost.reserve(TRACK_CAPACITY);
+}
+
+void TrackStitcher::beginFrame(const std::uint64_t time) {
+  mNow = time;
+  // Lost tracks move on to where they would be by now
+  for (std::uint32_t idx = 0; idx < mLost.size(); ++idx) {
+    auto &lost = mLost[idx];
+    if (FREE_SLOT == lost.mTrack.mId) {
+      continue;
+    }
+    double x, y;
+    this->predict(lost.mTrack, x, y);
+    auto cell = this->cellOf(x, y);
+    if (cell != lost.mCell) {
+      this->unlink(idx);
+      this->link(idx, cell);
+    }
+  }
+}
+
+bool TrackStitcher::observe(const std::uint64_t id, const double x, const double y, stitch_t &stitch) {
+  if (FREE_SLOT == id) {
+    // Untracked object
+    return false;
+  }
+  if (auto *idx = mActiveById.find(id)) {
+    this->move(mActive[*idx], x, y);
+    return false;
+  }
+  Track track{id, x, y, 0.0, 0.0, mNow, NO_ENTRY};
+  bool stitched = false;
+  std::uint32_t lostIdx = NIL;
+  if (auto *known = mLostById.find(id)) {
+    // The tracker found it again itself
+    track = mLost[*known].mTrack;
+    this->move(track, x, y);
+    this->removeLost(*known);
+  } else if (this->match(x, y, lostIdx)) {
+    const auto &lost = mLost[lostIdx].mTrack;
+    track.mVx = lost.mVx;
+    track.mVy = lost.mVy;
+    track.mEntry = lost.mEntry;
+    stitch = stitch_t{lost.mId, lost.mEntry};
+    this->removeLost(lostIdx);
+    ++mStitched;
+    stitched = true;
+  }
+  mActiveById.insert(id, static_cast<std::uint32_t>(mActive.size()));
+  mActive.push_back(track);
+  return stitched;
+}
+
+void TrackStitcher::setEntry(const std::uint64_t id, const std::size_t entry) {
+  if (auto *idx = mActiveById.find(id)) {
+    mActive[*idx].mEntry = entry;
+  }
+}
+
+void TrackStitcher::endFrame() {
+  for (std::size_t idx = 0; idx < mActive.size();) {
+    if (mActive[idx].mSeen == mNow) {
+      ++idx;
+      continue;
+    }
+    if (NO_ENTRY != mActive[idx].mEntry) {
+      this->addLost(mActive[idx]);
+    }
+    mActiveById.erase(mActive[idx].mId);
+    if (idx + 1 != mActive.size()) {
+      mActive[idx] = mActive.back();
+      *mActiveById.find(mActive[idx].mId) = static_cast<std::uint32_t>(idx);
+    }
+    mActive.pop_back();
+  }
+  for (std::uint32_t idx = 0; idx < mLost.size(); ++idx) {
+    const auto &track = mLost[idx].mTrack;
+    if (FREE_SLOT != track.mId && mNow > track.mSeen + mWindow) {
+      this->removeLost(idx);
+    }
+  }
+}
+
+std::uint64_t TrackStitcher::cellOf(const double x, const double y) const {
+  auto cx = static_cast<std::int64_t>(std::floor(x / mCellSize)) + CELL_OFFSET;
+  auto cy = static_cast<std::int64_t>(std::floor(y / mCellSize)) + CELL_OFFSET;
+  return (static_cast<std::uint64_t>(cx) << 32) | static_cast<std::uint32_t>(cy);
+}
+
+void TrackStitcher::move(Track &track, const double x, const double y) {
+  if (mNow > track.mSeen) {
+    auto dt = (mNow - track.mSeen) / NS_PER_SEC;
+    track.mVx += VELOCITY_SMOOTHING * ((x - track.mX) / dt - track.mVx);
+    track.mVy += VELOCITY_SMOOTHING * ((y - track.mY) / dt - track.mVy);
+    // A jumpy box must not throw the prediction off screen
+    auto speed = std::hypot(track.mVx, track.mVy);
+    if (speed > mInfo.mMaxSpeed) {
+      track.mVx *= mInfo.mMaxSpeed / speed;
+      track.mVy *= mInfo.mMaxSpeed / speed;
+    }
+  }
+  track.mX = x;
+  track.mY = y;
+  track.mSeen = mNow;
+}
+
+void TrackStitcher::predict(const Track &track, double &x, double &y) const {
+  auto dt = (mNow > track.mSeen ? mNow - track.mSeen : 0) / NS_PER_SEC;
+  x = track.mX + track.mVx * dt;
+  y = track.mY + track.mVy * dt;
+}
+
+bool TrackStitcher::match(const double x, const double y, std::uint32_t &best) const {
+  auto closest = mInfo.mMaxDistance * mInfo.mMaxDistance;
+  best = NIL;
+  auto center = this->cellOf(x, y);
+  for (std::int64_t dx = -1; dx <= 1; ++dx) {
+    for (std::int64_t dy = -1; dy <= 1; ++dy) {
+      auto cell = center + (static_cast<std::uint64_t>(dx) << 32) + static_cast<std::uint64_t>(dy);
+      auto *head = mCells.find(cell);
+      for (auto idx = head ? *head : NIL; NIL != idx; idx = mLost[idx].mNext) {
+        double px, py;
+        this->predict(mLost[idx].mTrack, px, py);
+        auto distance = (px - x) * (px - x) + (py - y) * (py - y);
+        if (distance <= closest) {
+          closest = distance;
+          best = idx;
+        }
+      }
+    }
+  }
+  return NIL != best;
+}
+
+void TrackStitcher::addLost(const Track &track) {
+  std::uint32_t idx = mFree;
+  if (NIL == idx) {
+    idx = static_cast<std::uint32_t>(mLost.size());
+    mLost.push_back(Lost{});
+  } else {
+    mFree = mLost[idx].mNext;
+  }
+  mLost[idx].mTrack = track;
+  this->link(idx, this->cellOf(track.mX, track.mY));
+  mLostById.insert(track.mId, idx);
+}
+
+void TrackStitcher::removeLost(const std::uint32_t idx) {
+  auto &lost = mLost[idx];
+  this->unlink(idx);
+  mLostById.erase(lost.mTrack.mId);
+  lost.mTrack.mId = FREE_SLOT;
+  lost.mNext = mFree;
+  mFree = idx;
+}
+
+void TrackStitcher::link(const std::uint32_t idx, const std::uint64_t cell) {
+  auto &lost = mLost[idx];
+  lost.mCell = cell;
+  lost.mPrev = NIL;
+  lost.mNext = NIL;
+  if (auto *head = mCells.find(cell)) {
+    lost.mNext = *head;
+    mLost[*head].mPrev = idx;
+    *head = idx;
+  } else {
+    mCells.insert(cell, idx);
+  }
+}
+
+void TrackStitcher::unlink(const std::uint32_t idx) {
+  auto &lost = mLost[idx];
+  if (NIL != lost.mPrev) {
+    mLost[lost.mPrev].mNext = lost.mNext;
+  } else if (NIL != lost.mNext) {
+    *mCells.find(lost.mCell) = lost.mNext;
+  } else {
+    mCells.erase(lost.mCell);
+  }
+  if (NIL != lost.mNext) {
+    mLost[lost.mNext].mPrev = lost.mPrev;
+  }
+}
+
+} // namespace stitching
@@ -6,7 +6,6 @@
 #include "trackerparsing.h"
 
 namespace {
-constexpr auto TRACKER_CONFIG_FILE = "cfg/tracker_config.txt";
 constexpr auto CONFIG_GROUP_TRACKER = "tracker";
 constexpr auto CONFIG_GROUP_TRACKER_WIDTH = "tracker-width";
 constexpr auto CONFIG_GROUP_TRACKER_HEIGHT = "tracker-height";
@@ -52,7 +51,7 @@ std::string getAbsoluteFilePath(const char *cfgFilePath, char *filePath)
 
 namespace trackerparsing {
 
-bool setTrackerProperties (GstElement *nvtracker)
+bool parseTrackerConfig (tracker_info_t &trackerInfo)
 {
   bool ret = false;
   GError *error = nullptr;
@@ -61,6 +60,8 @@ bool setTrackerProperties (GstElement *nvtracker)
   if (!g_key_file_load_from_file (key_file, TRACKER_CONFIG_FILE, G_KEY_FILE_NONE,
           &error)) {
     std::cerr << "Failed to load config file: " <<  error->message << std::endl;
+    g_error_free (error);
+    g_key_file_free (key_file);
     return false;
   }
 
@@ -70,44 +71,45 @@ bool setTrackerProperties (GstElement *nvtracker)
 
   for(gchar** key = keys; *key != nullptr; ++key) {
     if (!g_strcmp0 (*key, CONFIG_GROUP_TRACKER_WIDTH)) {
-      gint width =
+      trackerInfo.mWidth =
           g_key_file_get_integer (key_file, CONFIG_GROUP_TRACKER,
           CONFIG_GROUP_TRACKER_WIDTH, &error);
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_WIDTH, width, nullptr);
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_TRACKER_HEIGHT)) {
-      gint height =
+      trackerInfo.mHeight =
           g_key_file_get_integer (key_file, CONFIG_GROUP_TRACKER,
-          CONFIG_GROUP_TRACKER_WIDTH, &error);
+          CONFIG_GROUP_TRACKER_HEIGHT, &error);
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_WIDTH, height, nullptr);
     } else if (!g_strcmp0 (*key, CONFIG_GPU_ID)) {
-      guint gpu_id =
+      trackerInfo.mGpuId =
           g_key_file_get_integer (key_file, CONFIG_GROUP_TRACKER,
           CONFIG_GPU_ID, &error);
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GPU_ID, gpu_id, nullptr);
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_TRACKER_LL_CONFIG_FILE)) {
-      std::string ll_config_file = ::getAbsoluteFilePath(TRACKER_CONFIG_FILE,
+      trackerInfo.mLlConfigFile = ::getAbsoluteFilePath(TRACKER_CONFIG_FILE,
                 g_key_file_get_string (key_file,
                     CONFIG_GROUP_TRACKER,
                     CONFIG_GROUP_TRACKER_LL_CONFIG_FILE, &error));
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_LL_CONFIG_FILE, ll_config_file.c_str(), nullptr);
+      if (trackerInfo.mLlConfigFile.empty()) {
+        std::cerr << "No such file for key '" << *key << "'" << std::endl;
+        goto done;
+      }
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_TRACKER_LL_LIB_FILE)) {
-      std::string ll_lib_file = ::getAbsoluteFilePath(TRACKER_CONFIG_FILE,
+      trackerInfo.mLlLibFile = ::getAbsoluteFilePath(TRACKER_CONFIG_FILE,
                 g_key_file_get_string (key_file,
                     CONFIG_GROUP_TRACKER,
                     CONFIG_GROUP_TRACKER_LL_LIB_FILE, &error));
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_LL_LIB_FILE, ll_lib_file.c_str(), nullptr);
+      if (trackerInfo.mLlLibFile.empty()) {
+        std::cerr << "No such file for key '" << *key << "'" << std::endl;
+        goto done;
+      }
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS)) {
-      gboolean enable_batch_process =
+      trackerInfo.mEnableBatchProcess =
           g_key_file_get_integer (key_file, CONFIG_GROUP_TRACKER,
           CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS, &error);
       CHECK_ERROR (error);
-      g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS,
-                    enable_batch_process, nullptr);
     } else {
       std::cerr << "Unknown key '" << *key << "'"<< "for group [" << CONFIG_GROUP_TRACKER << "]" << std::endl;
     }
@@ -120,10 +122,36 @@ done:
   if (keys != nullptr) {
     g_strfreev (keys);
   }
+  g_key_file_free (key_file);
   if (!ret) {
     std::cerr << __func__ << " failed" << std::endl;
   }
   return ret;
 }
 
+void applyTrackerProperties (GstElement *nvtracker, const tracker_info_t &trackerInfo)
+{
+  if (trackerInfo.mWidth >= 0) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_WIDTH, trackerInfo.mWidth, nullptr);
+  }
+  if (trackerInfo.mHeight >= 0) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_HEIGHT, trackerInfo.mHeight, nullptr);
+  }
+  if (trackerInfo.mGpuId >= 0) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GPU_ID, static_cast<guint>(trackerInfo.mGpuId), nullptr);
+  }
+  if (!trackerInfo.mLlConfigFile.empty()) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_LL_CONFIG_FILE,
+                  trackerInfo.mLlConfigFile.c_str(), nullptr);
+  }
+  if (!trackerInfo.mLlLibFile.empty()) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_LL_LIB_FILE,
+                  trackerInfo.mLlLibFile.c_str(), nullptr);
+  }
+  if (trackerInfo.mEnableBatchProcess >= 0) {
+    g_object_set (G_OBJECT (nvtracker), CONFIG_GROUP_TRACKER_ENABLE_BATCH_PROCESS,
+                  static_cast<gboolean>(trackerInfo.mEnableBatchProcess), nullptr);
+  }
+}
+
 } // namespace trackerparsing
@@ -4,14 +4,29 @@
 #include <array>
 #include <utility>
 #include <memory>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
+#include "gates.h"
+#include "kafkaparser.h"
 #include "trackerparsing.h"
 #include "metadata.h"
+#include "metrics.h"
+#include "odcube.h"
+#include "logger.h"
+#include "placement.h"
+#include "sourceparser.h"
+#include "startup.h"
+#include "watchdog.h"
 
 namespace {
 constexpr auto PIPELINE_NAME = "Vehicle-Tracking-Pipeline";
 constexpr auto PGIE_CONFIG_FILE = "cfg/pgie_config.txt";
 constexpr auto ANALYTICS_CONFIG_FILE = "cfg/config_nvdsanalytics.txt";
+constexpr auto CONFIG_DIRECTORY = "cfg";
 
 constexpr auto MUXER_OUTPUT_WIDTH = 1920;
 constexpr auto MUXER_OUTPUT_HEIGHT = 1080;
@@ -19,13 +34,12 @@ constexpr auto MUXER_BATCH_TIMEOUT_USEC = 40000;
 
 constexpr auto NUMBER_QUEUES = 6;
 
-constexpr auto ELEMENT_SOURCE_FILE = "filesrc";
 constexpr auto ELEMENT_PARSE_H264 = "h264parse";
-constexpr auto ELEMENT_DECODER_NVV4L2 = "nvv4l2decoder";
 constexpr auto ELEMENT_STREAMMUX_NV = "nvstreammux";
 constexpr auto ELEMENT_INFER_NV = "nvinfer";
 constexpr auto ELEMENT_TRACKER_NV = "nvtracker";
 constexpr auto ELEMENT_ANALYTICS_NV = "nvdsanalytics";
+constexpr auto ELEMENT_TILER_NV = "nvmultistreamtiler";
 constexpr auto ELEMENT_VIDEOCONVERT_NV = "nvvideoconvert";
 constexpr auto ELEMENT_DSOSD_NV = "nvdsosd";
 constexpr auto ELEMENT_FILTER_CAPS = "capsfilter";
@@ -35,13 +49,11 @@ constexpr auto ELEMENT_QUEUE = "queue";
 constexpr auto ELEMENT_SINK_FILE = "filesink";
 constexpr auto ELEMENT_SINK_FPS_DISPLAY = "fpsdisplaysink";
 
-constexpr auto ELEMENT_NAME_SOURCE_FILE = "file-source";
-constexpr auto ELEMENT_NAME_PARSE_H264 = "h264-parser";
-constexpr auto ELEMENT_NAME_DECODER_NVV4L2 = "nvv4l2-decoder";
 constexpr auto ELEMENT_NAME_STREAMMUX_NV = "stream-muxer";
 constexpr auto ELEMENT_NAME_INFER_NV_PRIMARY = "primary-nvinference-engine";
 constexpr auto ELEMENT_NAME_TRACKER_NV = "tracker";
 constexpr auto ELEMENT_NAME_ANALYTICS_NV = "nvdsanalytics";
+constexpr auto ELEMENT_NAME_TILER_NV = "nvtiler";
 constexpr auto ELEMENT_NAME_VIDEOCONVERT_NV = "nvvideo-converter";
 constexpr auto ELEMENT_NAME_DSOSD_NV = "nv-onscreendisplay";
 constexpr auto ELEMENT_NAME_VIDEOCONVERT_POSTOSD_NV = "nvvideo-converter-postosd";
@@ -52,8 +64,130 @@ constexpr auto ELEMENT_NAME_MUX_MP4 = "mux";
 constexpr auto ELEMENT_NAME_SINK_FILE = "filesink";
 constexpr auto ELEMENT_NAME_SINK_FPS_DISPLAY = "fps-display";
 
-constexpr auto PAD_NAME_SINK = "sink_0";
+// Element fed by each queue, in queue order
+constexpr std::array<const char*, NUMBER_QUEUES> QUEUE_STAGES{{
+  ELEMENT_NAME_INFER_NV_PRIMARY, ELEMENT_NAME_TRACKER_NV, ELEMENT_NAME_ANALYTICS_NV,
+  ELEMENT_NAME_VIDEOCONVERT_NV, ELEMENT_NAME_DSOSD_NV, ELEMENT_NAME_VIDEOCONVERT_POSTOSD_NV}};
+
+constexpr auto ROUTE_SNAPSHOT = "/snapshot";
+constexpr auto ROUTE_CROSSINGS = "/crossings";
+constexpr auto ROUTE_WINDOWS = "/windows";
+constexpr auto ROUTE_STATS = "/stats";
+constexpr auto ROUTE_PLACEMENT = "/placement";
+constexpr auto ROUTE_CUBE = "/cube";
+constexpr auto ROUTE_OCCUPANCY = "/occupancy";
+constexpr auto ROUTE_METRICS = "/metrics";
+constexpr auto ROUTE_STARTUP = "/startup";
+constexpr auto CONTENT_TYPE_JSON = "application/json";
+
 constexpr auto PAD_NAME_SRC = "src";
+constexpr auto PAD_NAME_TRACKER_SINK = "sink";
+
+constexpr auto RETIRE_POLL_MS = 10;
+constexpr auto PRODUCER_POLL_MS = 10;
+// The stalled element may never finish its state change, the checkpoint
+// and the exit code for the supervisor come first
+constexpr auto STOP_TIMEOUT = std::chrono::seconds(5);
+constexpr auto SOURCE_STAGE_PREFIX = "source-";
+
+constexpr auto METRIC_RECOVERIES = "vt_watchdog_recoveries_total";
+constexpr auto METRIC_RECOVERIES_HELP = "Stalls the watchdog acted on, by action";
+metrics::Counter &sourceRestarts = metrics::counter(METRIC_RECOVERIES, METRIC_RECOVERIES_HELP, "action=\"source\"");
+metrics::Counter &pipelineFlushes = metrics::counter(METRIC_RECOVERIES, METRIC_RECOVERIES_HELP, "action=\"flush\"");
+metrics::Counter &fullRestarts = metrics::counter(METRIC_RECOVERIES, METRIC_RECOVERIES_HELP, "action=\"restart\"");
+
+struct QueueLevel {
+  guint mBuffers;
+  guint mMaxBuffers;
+  guint64 mTime;
+  guint64 mMaxTime;
+};
+
+// Runs on the streaming thread itself when its task starts
+GstBusSyncReply streamStatusHandler(GstBus *bus, GstMessage *msg, gpointer u_data) {
+  if (GST_MESSAGE_STREAM_STATUS == GST_MESSAGE_TYPE (msg)) {
+    GstStreamStatusType type;
+    GstElement *owner = nullptr;
+    gst_message_parse_stream_status (msg, &type, &owner);
+    if (GST_STREAM_STATUS_TYPE_ENTER == type && nullptr != owner) {
+      ::placement::placeStreamingThread(GST_OBJECT_NAME (owner));
+    }
+  }
+  return GST_BUS_PASS;
+}
+
+// A change to make between two buffers out of a queue, see whileIdle()
+using reconfiguration_t = std::function<void(GstPad *)>;
+
+// Called as soon as the queue's source pad is idle, in the thread that
+// added the probe when nothing is being pushed, else in the streaming
+// thread once the buffer in flight is through. No buffer moves until the
+// change is done.
+GstPadProbeReturn applyIdle(GstPad *pad, GstPadProbeInfo *info, gpointer u_data) {
+  (*static_cast<reconfiguration_t*>(u_data))(pad);
+  return GST_PAD_PROBE_REMOVE;
+}
+
+void freeReconfiguration(gpointer u_data) {
+  delete static_cast<reconfiguration_t*>(u_data);
+}
+
+// The first buffer into the restarted tracker, its ids start over
+GstPadProbeReturn markTrackerRestart(GstPad *pad, GstPadProbeInfo *info, gpointer u_data) {
+  ::metadata::resetTracksAt(GST_BUFFER_PTS (GST_PAD_PROBE_INFO_BUFFER (info)));
+  return GST_PAD_PROBE_REMOVE;
+}
+
+// Buffers out of a stage for the watchdog, EOS when it is done
+GstPadProbeReturn heartbeat(GstPad *pad, GstPadProbeInfo *info, gpointer u_data) {
+  auto *stage = static_cast<::watchdog::Stage*>(u_data);
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    stage->beat();
+  } else if (GST_EVENT_EOS == GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info))) {
+    stage->finish(true);
+  } else if (GST_EVENT_STREAM_START == GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info))) {
+    stage->finish(false);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+void addHeartbeat(GstElement *element, ::watchdog::Stage *stage) {
+  auto *pad = gst_element_get_static_pad (element, PAD_NAME_SRC);
+  gst_pad_add_probe (pad,
+    static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+    heartbeat, stage, nullptr);
+  gst_object_unref (pad);
+}
+
+// A change for the main loop, from another thread
+gboolean runOnce(gpointer u_data) {
+  auto *apply = static_cast<std::function<void()>*>(u_data);
+  (*apply)();
+  delete apply;
+  return G_SOURCE_REMOVE;
+}
+
+// Readers hold their reference for one buffer at most. The last one is
+// dropped here rather than on the streaming thread, a producer flushes.
+template <typename T>
+void retire(std::shared_ptr<T> old) {
+  while (old && old.use_count() > 1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(RETIRE_POLL_MS));
+  }
+}
+
+// Analytics waits for the producer, see awaitProducer()
+GstPadProbeReturn holdForProducer(GstPad *, GstPadProbeInfo *, gpointer) {
+  return GST_PAD_PROBE_OK;
+}
+
+QueueLevel queueLevel(GstElement *queue) {
+  QueueLevel level{0, 0, 0, 0};
+  g_object_get (G_OBJECT (queue), "current-level-buffers", &level.mBuffers,
+    "max-size-buffers", &level.mMaxBuffers, "current-level-time", &level.mTime,
+    "max-size-time", &level.mMaxTime, nullptr);
+  return level;
+}
 
 } // namespace
 
@@ -62,25 +196,80 @@ namespace vehicletracking{
 VehicleTrackingPipeline::VehicleTrackingPipeline(
     const arg_count_t argc,
     arg_var_t argv,
-    const ::kafkaproducer::kafka_info_t &kafkaInfo)
+    const ::kafkaproducer::kafka_info_t &kafkaInfo,
+    const app_info_t &appInfo)
     : mArgc{argc},
       mLoop{nullptr},
       mPipeline{nullptr},
       mBusWatchId{0},
       mCleanup{false},
+      mWedged{false},
       mKafkaInfo{kafkaInfo},
+      mAppInfo{appInfo},
+      mProducerReady{false},
+      mHoldPad{nullptr},
+      mHoldProbeId{0},
+      mPgie{nullptr},
+      mTracker{nullptr},
+      mAnalytics{nullptr},
+      mTrackerQueue{nullptr},
+      mAnalyticsQueue{nullptr},
+      mIntervalSourceId{0},
+      mQueueSourceId{0},
+      mMetricsSourceId{0},
+      mWatchdogSourceId{0},
+      mProducerSourceId{0},
+      mExitCode{ERR_SUCCESS},
+      mBottleneck{::queuecontrol::NO_BOTTLENECK},
       mArgv{argv} {}
 
 VehicleTrackingPipeline::~VehicleTrackingPipeline() {
-  if (!mCleanup) {
+  mConfigWatcher.reset();
+  // Config errors return before the loop and the pipeline exist
+  if (!mCleanup && nullptr != mPipeline) {
     this->cleanup();
   }
+  mStatsServer.reset();
+  ::metadata::setSink(::metadata::sink_t{nullptr, mKafkaInfo.mPerEvent});
   mProducer.reset();
 }
 
 std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
   const ::kafkaproducer::kafkacb_t &kafkaCall) {
+  // Every config file is read before anything starts, a mistake in one
+  // costs no model load
+  ::trackerparsing::tracker_info_t trackerInfo;
+  if (!::trackerparsing::parseTrackerConfig(trackerInfo)) {
+    return ERR_SET_PROPERTIES_NVTRACKER;
+  }
+  mTrackerLlConfigFile = trackerInfo.mLlConfigFile;
+  try {
+    ::metadata::setGates(std::make_shared<const ::gates::GateRegistry>(ANALYTICS_CONFIG_FILE));
+  } catch (const std::exception &ex) {
+    std::cerr << "Unable to read the gates: " << ex.what() << std::endl;
+    return ERR_INITIALIZE_GATES;
+  }
+  ::sources::source_list_t sourceList;
+  if (!::sourceparser::parseSourcesConfig(sourceList, mAppInfo.mSources.mMaxSources)) {
+    return ERR_INITIALIZE_SOURCE;
+  }
+  ::startup::mark(::startup::Phase::Config);
+
+  // The broker metadata fetch and the topic creation block for a round trip
+  // or more, they run while the pipeline is built and the engine loads
+  mKafkaCall = kafkaCall;
+  auto endpoint = mKafkaInfo.mEndpoint;
+  auto topic = mKafkaInfo.mTopic;
+  mPendingProducer = std::async(std::launch::async, [endpoint, topic, kafkaCall]() {
+    // librdkafka's threads start in here and inherit the kafka placement
+    ::placement::ScopedKafkaPlacement kafkaPlacement;
+    auto producer = std::make_shared<::kafkaproducer::KafkaProducer>(endpoint, topic, kafkaCall);
+    ::startup::mark(::startup::Phase::Kafka);
+    return producer;
+  });
+
   gst_init (&mArgc, &mArgv);
+  ::startup::mark(::startup::Phase::GstInit);
   mLoop = g_main_loop_new (nullptr, FALSE);
   if (nullptr == mLoop) {
     return ERR_INITIALIZE_LOOP;
@@ -89,28 +278,13 @@ std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
   if (nullptr == mPipeline) {
     return ERR_INITIALIZE_PIPELINE;
   }
-  GstElement *source = nullptr;
-  source = gst_element_factory_make (ELEMENT_SOURCE_FILE, ELEMENT_NAME_SOURCE_FILE);
-  if (nullptr == source) {
-    return ERR_INITIALIZE_SOURCE;
-  }
-  g_object_set (G_OBJECT (source), "location", mArgv[1], nullptr);
-  GstElement *h264parser = nullptr;
-  h264parser = gst_element_factory_make (ELEMENT_PARSE_H264, ELEMENT_NAME_PARSE_H264);
-  if (nullptr == h264parser) {
-    return ERR_INITIALIZE_H264PARSER;
-  }
-  GstElement *decoder = nullptr;
-  decoder = gst_element_factory_make (ELEMENT_DECODER_NVV4L2, ELEMENT_NAME_DECODER_NVV4L2 );
-  if (nullptr == decoder) {
-    return ERR_INITIALIZE_NVV4L2DECODER;
-  }
   GstElement *streammux = nullptr;
   streammux = gst_element_factory_make (ELEMENT_STREAMMUX_NV, ELEMENT_NAME_STREAMMUX_NV);
   if (nullptr == streammux) {
     return ERR_INITIALIZE_STREAMMUX;
   }
-  g_object_set (G_OBJECT (streammux), "batch-size", 1, nullptr);
+  // One frame of each source that can ever be added
+  g_object_set (G_OBJECT (streammux), "batch-size", mAppInfo.mSources.mMaxSources, nullptr);
   g_object_set (G_OBJECT (streammux), "width", MUXER_OUTPUT_WIDTH, "height",
       MUXER_OUTPUT_HEIGHT,
       "batched-push-timeout", MUXER_BATCH_TIMEOUT_USEC, nullptr);
@@ -120,14 +294,14 @@ std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
     return ERR_INITIALIZE_PGIE;
   }
   g_object_set (G_OBJECT (pgie), "config-file-path", PGIE_CONFIG_FILE, nullptr);
+  // After the config file, which sets it too
+  g_object_set (G_OBJECT (pgie), "batch-size", mAppInfo.mSources.mMaxSources, nullptr);
   GstElement *nvtracker = nullptr;
   nvtracker = gst_element_factory_make (ELEMENT_TRACKER_NV, ELEMENT_NAME_TRACKER_NV);
   if (nullptr == nvtracker) {
     return ERR_INITIALIZE_NVTRACKER;
   }
-  if (!::trackerparsing::setTrackerProperties(nvtracker)) {
-    return ERR_SET_PROPERTIES_NVTRACKER;
-  }
+  ::trackerparsing::applyTrackerProperties(nvtracker, trackerInfo);
   GstElement *nvdsanalytics = nullptr;
   nvdsanalytics = gst_element_factory_make (ELEMENT_ANALYTICS_NV, ELEMENT_NAME_ANALYTICS_NV);
   if (nullptr == nvdsanalytics) {
@@ -136,6 +310,19 @@ std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
   g_object_set (G_OBJECT (nvdsanalytics),
     "config-file", ANALYTICS_CONFIG_FILE,
     nullptr);
+  // The encoder takes one picture, the batch is laid out on a grid
+  GstElement *tiler = nullptr;
+  if (mAppInfo.mSources.mMaxSources > 1) {
+    tiler = gst_element_factory_make (ELEMENT_TILER_NV, ELEMENT_NAME_TILER_NV);
+    if (nullptr == tiler) {
+      return ERR_INITIALIZE_TILER;
+    }
+    auto columns = static_cast<guint>(std::ceil(std::sqrt(mAppInfo.mSources.mMaxSources)));
+    auto rows = (mAppInfo.mSources.mMaxSources + columns - 1) / columns;
+    g_object_set (G_OBJECT (tiler), "rows", rows, "columns", columns,
+      "width", MUXER_OUTPUT_WIDTH, "height", MUXER_OUTPUT_HEIGHT, nullptr);
+    gst_bin_add (GST_BIN (mPipeline), tiler);
+  }
   GstElement *nvvidconv = nullptr;
   nvvidconv = gst_element_factory_make (ELEMENT_VIDEOCONVERT_NV, ELEMENT_NAME_VIDEOCONVERT_NV);
   if (nullptr == nvvidconv) {
@@ -204,31 +391,31 @@ std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
     gst_element_factory_make (ELEMENT_QUEUE, "queue6")}};
 
   gst_bin_add_many (GST_BIN (mPipeline),
-    source, h264parser, decoder, streammux, queues[0], pgie, queues[1], nvtracker, queues[2], nvdsanalytics, queues[3],
+    streammux, queues[0], pgie, queues[1], nvtracker, queues[2], nvdsanalytics, queues[3],
     nvvidconv, queues[4], nvosd, queues[5], nvvidconv_postosd, cap_filter, encoder, codecparse, mux, fpsSink, nullptr);
 
   this->addMessageHandler(busCall);
 
-  GstPad *sinkPad = nullptr;
-  sinkPad = gst_element_get_request_pad (streammux, PAD_NAME_SINK);
-  if (nullptr == sinkPad) {
-    return ERR_ADD_SINK_PAD;
-  }
-  GstPad *srcPad = nullptr;
-  srcPad = gst_element_get_static_pad (decoder, PAD_NAME_SRC);
-  if (nullptr == srcPad) {
-    return ERR_ADD_SRC_PAD;
-  }
-  if (gst_pad_link (srcPad, sinkPad) != GST_PAD_LINK_OK) {
-      return ERR_LINK_DECODER_STREAMMUXER;
+  if (mAppInfo.mWatchdog.mEnable) {
+    try {
+      mWatchdog.reset(new ::watchdog::Watchdog(mAppInfo.mWatchdog));
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up the watchdog: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_WATCHDOG;
+    }
   }
-  gst_object_unref (sinkPad);
-  gst_object_unref (srcPad);
-
-  if (!gst_element_link_many (source, h264parser, decoder, nullptr)) {
-    return ERR_LINK_SRC_PARSER_DECODER;
+  // Every source is a bin of its own, so that it can be restarted alone
+  mSourceManager.reset(new ::sources::SourceManager(mPipeline, streammux, mAppInfo.mSources,
+    [this](const std::uint32_t id, GstElement *bin) { this->sourceAdded(id, bin); }));
+  try {
+    mSourceManager->add(0, mArgv[1]);
+  } catch (const std::exception &ex) {
+    std::cerr << "Unable to add source 0: " << ex.what() << std::endl;
+    return ERR_INITIALIZE_SOURCE;
   }
-  if (!gst_element_link_many (streammux, queues[0], pgie, queues[1], nvtracker, queues[2], nvdsanalytics, queues[3],
+  if (!gst_element_link_many (streammux, queues[0], pgie, queues[1], nvtracker, queues[2], nvdsanalytics, nullptr) ||
+    (nullptr != tiler && !gst_element_link (nvdsanalytics, tiler)) ||
+    !gst_element_link_many (nullptr != tiler ? tiler : nvdsanalytics, queues[3],
     nvvidconv, queues[4], nvosd, queues[5], nvvidconv_postosd, cap_filter, encoder, codecparse, mux, fpsSink, nullptr)) {
     return ERR_LINK_ALL;
   }
@@ -239,17 +426,169 @@ std::uint8_t VehicleTrackingPipeline::initialize(const buscb_t busCall,
     return ERR_ADD_ANALYTICS_SRC_PAD;
   }
 
+  // Sources, inference and the tracker preroll meanwhile, the first batch
+  // waits in queue3 for the sink
+  mHoldPad = gst_element_get_static_pad (queues[2], PAD_NAME_SRC);
+  mHoldProbeId = gst_pad_add_probe (mHoldPad,
+    static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER),
+    holdForProducer, nullptr, nullptr);
+  mProducerSourceId = g_timeout_add (PRODUCER_POLL_MS, &VehicleTrackingPipeline::awaitProducer, this);
   try {
-    mProducer = std::make_shared<::kafkaproducer::KafkaProducer>(mKafkaInfo.mEndpoint, mKafkaInfo.mTopic, kafkaCall);
+    ::metadata::setCube(mAppInfo.mCube);
   } catch (const std::exception &ex) {
-    //std::cerr << "Unable to create kafka producer: " << ex.what() << std::endl;
-    return ERR_INITIALIZE_PRODUCER;
+    std::cerr << "Unable to set up the O/D cube: " << ex.what() << std::endl;
+    return ERR_INITIALIZE_CUBE;
+  }
+  try {
+    ::metadata::setWindows(mAppInfo.mWindows);
+  } catch (const std::exception &ex) {
+    return ERR_INITIALIZE_WINDOWS;
+  }
+  if (mAppInfo.mCheckpoint.mEnable) {
+    try {
+      ::metadata::setCheckpoint(mAppInfo.mCheckpoint);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up checkpoints: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_CHECKPOINT;
+    }
+  }
+  if (mAppInfo.mSharedCounters.mEnable) {
+    try {
+      ::metadata::setSharedCounters(mAppInfo.mSharedCounters);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to attach shared counters: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_SHARED_COUNTERS;
+    }
   }
-  ::metadata::producer = mProducer;
+  if (mAppInfo.mStitching.mEnable) {
+    try {
+      ::metadata::setStitching(mAppInfo.mStitching);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up track stitching: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_STITCHING;
+    }
+  }
+  if (mAppInfo.mOccupancy.mEnable) {
+    try {
+      ::metadata::setOccupancy(mAppInfo.mOccupancy);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up ROI occupancy: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_OCCUPANCY;
+    }
+  }
+  if (mAppInfo.mArchive.mEnable) {
+    try {
+      ::metadata::setArchive(mAppInfo.mArchive);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up the crossing archive: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_ARCHIVE;
+    }
+  }
+  if (mAppInfo.mMetaRing.mEnable) {
+    try {
+      ::metadata::setMetaRing(mAppInfo.mMetaRing);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up the metadata ring: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_META_RING;
+    }
+  }
+  if (mAppInfo.mStatsServer.mEnable) {
+    try {
+      mStatsServer.reset(new ::statsserver::StatsServer(mAppInfo.mStatsServer));
+      mStatsServer->addRoute(ROUTE_SNAPSHOT, CONTENT_TYPE_JSON, ::metadata::snapshotJson);
+      mStatsServer->addRoute(ROUTE_CROSSINGS, CONTENT_TYPE_JSON, ::metadata::crossingsJson);
+      mStatsServer->addRoute(ROUTE_WINDOWS, CONTENT_TYPE_JSON, ::metadata::windowsJson);
+      mStatsServer->addRoute(ROUTE_STATS, CONTENT_TYPE_JSON, ::metadata::statsJson);
+      mStatsServer->addRoute(ROUTE_PLACEMENT, CONTENT_TYPE_JSON, ::placement::reportJson);
+      mStatsServer->addRoute(ROUTE_CUBE, CONTENT_TYPE_JSON, ::metadata::cubeJson);
+      mStatsServer->addRoute(ROUTE_OCCUPANCY, CONTENT_TYPE_JSON, ::metadata::occupancyJson);
+      mStatsServer->addRoute(ROUTE_METRICS, ::metrics::CONTENT_TYPE, ::metrics::prometheusText);
+      mStatsServer->addRoute(ROUTE_STARTUP, CONTENT_TYPE_JSON, ::startup::json);
+      mStatsServer->start();
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to start stats server: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_STATS_SERVER;
+    }
+  }
+  if (mAppInfo.mIntervalControl.mEnable) {
+    try {
+      mIntervalController.reset(new ::intervalcontrol::IntervalController(mAppInfo.mIntervalControl));
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up interval control: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_INTERVAL_CONTROL;
+    }
+    // Elements are owned by the pipeline and outlive the timeout, see cleanup()
+    mQueues.assign(queues.begin(), queues.end());
+    mPgie = pgie;
+    g_object_set (G_OBJECT (pgie), "interval", mIntervalController->interval(), nullptr);
+    ::metadata::setInferInterval(mIntervalController->interval());
+    // Adjusted once the producer is ready, see awaitProducer()
+  }
+  if (mAppInfo.mQueueControl.mEnable) {
+    try {
+      mQueueController.reset(new ::queuecontrol::QueueController(mAppInfo.mQueueControl, NUMBER_QUEUES));
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to set up queue control: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_QUEUE_CONTROL;
+    }
+    mQueues.assign(queues.begin(), queues.end());
+    // Depth is controlled in buffers only
+    for (std::size_t idx = 0; idx < queues.size(); ++idx) {
+      g_object_set (G_OBJECT (queues[idx]), "max-size-buffers", mQueueController->setting(idx).mMaxBuffers,
+        "max-size-bytes", 0, "max-size-time", static_cast<guint64>(0), nullptr);
+    }
+    // Adjusted once the producer is ready, see awaitProducer()
+  }
+  if (!mAppInfo.mMetrics.mTextfile.empty()) {
+    mMetricsSourceId = g_timeout_add (mAppInfo.mMetrics.mTextfilePeriodMs,
+      &VehicleTrackingPipeline::writeMetrics, this);
+  }
+  ::metadata::watchFps(fpsSink);
   gst_pad_add_probe (nvdsanalytics_src_pad, GST_PAD_PROBE_TYPE_BUFFER,
-    ::metadata::nvdsanalyticsSrcPadBufferProbe, reinterpret_cast<gpointer>(fpsSink), NULL);
+    ::metadata::nvdsanalyticsSrcPadBufferProbe, nullptr, NULL);
+  gst_pad_add_probe (nvdsanalytics_src_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+    ::metadata::nvdsanalyticsSrcPadEventProbe, nullptr, NULL);
   gst_object_unref (nvdsanalytics_src_pad);
-  
+
+  for (const auto &each: sourceList) {
+    try {
+      mSourceManager->add(each.first, each.second);
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to add source " << each.first << ": " << ex.what() << std::endl;
+      return ERR_INITIALIZE_SOURCE;
+    }
+  }
+
+  if (mWatchdog) {
+    mQueues.assign(queues.begin(), queues.end());
+    // Heartbeat only, nvstreammux waits for its sources by design
+    auto *upstream = mWatchdog->addStage(GST_OBJECT_NAME (streammux), nullptr, ::watchdog::NO_SOURCE, false);
+    addHeartbeat(streammux, upstream);
+    for (auto *element: {pgie, nvtracker, nvdsanalytics, tiler, nvvidconv, nvosd, nvvidconv_postosd, encoder}) {
+      if (nullptr == element) {
+        continue;
+      }
+      upstream = mWatchdog->addStage(GST_OBJECT_NAME (element), upstream);
+      addHeartbeat(element, upstream);
+    }
+    // Checked once the producer is ready, see awaitProducer()
+  }
+
+  if (mAppInfo.mConfigWatch.mEnable) {
+    // Owned by the pipeline, like the queues
+    mTracker = nvtracker;
+    mAnalytics = nvdsanalytics;
+    mTrackerQueue = queues[1];
+    mAnalyticsQueue = queues[2];
+    try {
+      mConfigWatcher.reset(new ::configwatch::ConfigWatcher(CONFIG_DIRECTORY, mAppInfo.mConfigWatch,
+        [this](const std::string &file) { this->reload(file); }));
+    } catch (const std::exception &ex) {
+      std::cerr << "Unable to watch the config files: " << ex.what() << std::endl;
+      return ERR_INITIALIZE_CONFIG_WATCH;
+    }
+  }
+  ::startup::mark(::startup::Phase::Pipeline);
   return ERR_SUCCESS;
 }
 
@@ -258,20 +597,387 @@ void VehicleTrackingPipeline::addMessageHandler(const buscb_t busCall) {
   bus = gst_pipeline_get_bus (GST_PIPELINE (mPipeline));
   //mBusWatchId = gst_bus_add_watch (bus, busCall.target<gboolean(GstBus *, GstMessage *, gpointer)>(), mLoop);
   mBusWatchId = gst_bus_add_watch (bus, busCall, mLoop);
+  if (::placement::enabled()) {
+    gst_bus_set_sync_handler (bus, streamStatusHandler, nullptr, nullptr);
+  }
   gst_object_unref(bus);
 }
 
+gboolean VehicleTrackingPipeline::adjustInterval(gpointer u_data) {
+  auto *self = static_cast<VehicleTrackingPipeline*>(u_data);
+  auto sample = ::metadata::loadSample();
+  // Fill of the fullest queue, by buffers or by time whichever is closer to
+  // the limit. Limits moved by the queue controller would skew the fill, it
+  // is measured against its upper bound instead.
+  for (auto *queue: self->mQueues) {
+    auto level = queueLevel(queue);
+    auto maxBuffers = self->mQueueController ? self->mAppInfo.mQueueControl.mMaxBuffers : level.mMaxBuffers;
+    if (maxBuffers > 0) {
+      sample.mQueueFill = std::max(sample.mQueueFill, static_cast<double>(level.mBuffers) / maxBuffers);
+    }
+    if (level.mMaxTime > 0) {
+      sample.mQueueFill = std::max(sample.mQueueFill, static_cast<double>(level.mTime) / level.mMaxTime);
+    }
+  }
+  if (self->mIntervalController->update(sample)) {
+    auto interval = self->mIntervalController->interval();
+    const auto &smoothed = self->mIntervalController->smoothed();
+    g_object_set (G_OBJECT (self->mPgie), "interval", interval, nullptr);
+    ::metadata::setInferInterval(interval);
+    LOG_INFO("Inference interval {} ({}): queue fill {}, latency {} ms, objects {}",
+      interval, self->mIntervalController->reason(), smoothed.mQueueFill,
+      smoothed.mLatencyMs, smoothed.mObjects);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean VehicleTrackingPipeline::adjustQueues(gpointer u_data) {
+  auto *self = static_cast<VehicleTrackingPipeline*>(u_data);
+  std::vector<std::uint32_t> levels;
+  levels.reserve(self->mQueues.size());
+  for (auto *queue: self->mQueues) {
+    levels.push_back(queueLevel(queue).mBuffers);
+  }
+  auto &controller = *self->mQueueController;
+  for (const auto idx: controller.update(levels)) {
+    const auto &setting = controller.setting(idx);
+    g_object_set (G_OBJECT (self->mQueues[idx]), "max-size-buffers", setting.mMaxBuffers,
+      "leaky", static_cast<gint>(setting.mLeaky), nullptr);
+    LOG_INFO("queue{} before {}: max-size-buffers {}, leaky {}, level {}", idx + 1, QUEUE_STAGES[idx],
+      setting.mMaxBuffers, static_cast<int>(setting.mLeaky), levels[idx]);
+  }
+  if (controller.bottleneck() != self->mBottleneck) {
+    self->mBottleneck = controller.bottleneck();
+    if (::queuecontrol::NO_BOTTLENECK == self->mBottleneck) {
+      LOG_INFO("No bottleneck, every queue is draining");
+    } else {
+      LOG_INFO("Bottleneck: {}, fed by queue{}", QUEUE_STAGES[self->mBottleneck], self->mBottleneck + 1);
+    }
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean VehicleTrackingPipeline::checkStalls(gpointer u_data) {
+  auto *self = static_cast<VehicleTrackingPipeline*>(u_data);
+  auto nowMs = g_get_monotonic_time () / 1000;
+  auto stalls = self->mWatchdog->check(nowMs);
+  if (stalls.empty()) {
+    return G_SOURCE_CONTINUE;
+  }
+  for (std::size_t idx = 0; idx < self->mQueues.size(); ++idx) {
+    auto level = queueLevel(self->mQueues[idx]);
+    LOG_WARN("Watchdog: queue{} before {}: {} of {} buffers, {} ms", idx + 1, QUEUE_STAGES[idx],
+      level.mBuffers, level.mMaxBuffers, level.mTime / GST_MSECOND);
+  }
+  for (const auto &line: self->mWatchdog->describe(nowMs)) {
+    LOG_WARN("Watchdog: {}", line);
+  }
+  for (const auto &stall: stalls) {
+    if (!self->recover(stall)) {
+      self->mWatchdogSourceId = 0;
+      return G_SOURCE_REMOVE;
+    }
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean VehicleTrackingPipeline::awaitProducer(gpointer u_data) {
+  auto *self = static_cast<VehicleTrackingPipeline*>(u_data);
+  if (std::future_status::ready != self->mPendingProducer.wait_for(std::chrono::seconds(0))) {
+    return G_SOURCE_CONTINUE;
+  }
+  self->mProducerSourceId = 0;
+  try {
+    self->mProducer = self->mPendingProducer.get();
+  } catch (const std::exception &ex) {
+    LOG_ERROR("Unable to create kafka producer: {}", ex.what());
+    self->mExitCode = ERR_INITIALIZE_PRODUCER;
+    g_main_loop_quit (self->mLoop);
+    return G_SOURCE_REMOVE;
+  }
+  ::metadata::setSink(::metadata::sink_t{self->mProducer, self->mKafkaInfo.mPerEvent});
+  self->mProducerReady = true;
+  gst_pad_remove_probe (self->mHoldPad, self->mHoldProbeId);
+  gst_object_unref (self->mHoldPad);
+  self->mHoldPad = nullptr;
+  if (self->mWatchdog) {
+    // Stages held back until now would look stalled
+    self->mWatchdogSourceId = g_timeout_add (self->mAppInfo.mWatchdog.mPeriodMs,
+      &VehicleTrackingPipeline::checkStalls, self);
+  }
+  // Queues filled while analytics was held back would read as overload
+  if (self->mIntervalController) {
+    self->mIntervalSourceId = g_timeout_add (self->mAppInfo.mIntervalControl.mPeriodMs,
+      &VehicleTrackingPipeline::adjustInterval, self);
+  }
+  if (self->mQueueController) {
+    self->mQueueSourceId = g_timeout_add (self->mAppInfo.mQueueControl.mPeriodMs,
+      &VehicleTrackingPipeline::adjustQueues, self);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+bool VehicleTrackingPipeline::recover(const ::watchdog::Stall &stall) {
+  const auto &name = stall.mStage->name();
+  if (stall.mRestart) {
+    // The checkpoint taken on the way out keeps the counts, see run()
+    LOG_ERROR("Watchdog: {} stalled for {} ms and did not recover, restarting", name, stall.mStalledMs);
+    fullRestarts.inc();
+    mExitCode = ERR_STALLED;
+    g_main_loop_quit (mLoop);
+    return false;
+  }
+  auto source = stall.mStage->source();
+  if (::watchdog::NO_SOURCE != source) {
+    LOG_ERROR("Watchdog: {} stalled for {} ms, restarting the source", name, stall.mStalledMs);
+    sourceRestarts.inc();
+    try {
+      mSourceManager->restart(source);
+    } catch (const std::exception &ex) {
+      LOG_ERROR("Unable to restart source {}: {}", source, ex.what());
+      this->retireSources();
+    }
+    return true;
+  }
+  // Flushing seeks start at the sources, every queue and element is
+  // flushed in stream order and the engine stays loaded. Each source seeks
+  // to its own position: one added while the pipeline played is on a
+  // timeline of its own, the pipeline's position is not its.
+  LOG_ERROR("Watchdog: {} stalled for {} ms, flushing the pipeline", name, stall.mStalledMs);
+  pipelineFlushes.inc();
+  mSourceManager->flush();
+  return true;
+}
+
+void VehicleTrackingPipeline::sourceAdded(const std::uint32_t id, GstElement *bin) {
+  if (id >= mAppInfo.mCube.mStreams && mFoldedSources.insert(id).second) {
+    LOG_WARN("Source {} is counted in stream {} of the O/D cube, which has {} streams", id,
+      ::odcube::streamIndex(mAppInfo.mCube, id), mAppInfo.mCube.mStreams);
+  }
+  this->watchSource(id, bin);
+}
+
+void VehicleTrackingPipeline::watchSource(const std::uint32_t id, GstElement *bin) {
+  if (!mWatchdog) {
+    return;
+  }
+  auto &stage = mSourceStages[id];
+  if (nullptr == stage) {
+    stage = mWatchdog->addStage(SOURCE_STAGE_PREFIX + std::to_string(id), nullptr, id);
+  }
+  stage->finish(false);
+  addHeartbeat(bin, stage);
+}
+
+void VehicleTrackingPipeline::retireSources() {
+  for (auto stage = mSourceStages.begin(); stage != mSourceStages.end();) {
+    if (nullptr != mSourceManager->bin(stage->first)) {
+      ++stage;
+      continue;
+    }
+    mWatchdog->retire(stage->second);
+    stage = mSourceStages.erase(stage);
+  }
+}
+
+gboolean VehicleTrackingPipeline::writeMetrics(gpointer u_data) {
+  auto *self = static_cast<VehicleTrackingPipeline*>(u_data);
+  if (!::metrics::writeTextfile(self->mAppInfo.mMetrics.mTextfile)) {
+    LOG_WARN("Unable to write the metrics to {}", self->mAppInfo.mMetrics.mTextfile);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void VehicleTrackingPipeline::reload(const std::string &file) {
+  auto path = std::string(CONFIG_DIRECTORY) + "/" + file;
+  auto slash = mTrackerLlConfigFile.rfind('/');
+  if (ANALYTICS_CONFIG_FILE == path) {
+    this->reloadAnalytics();
+  } else if (::trackerparsing::TRACKER_CONFIG_FILE == path ||
+      (std::string::npos != slash && 0 == mTrackerLlConfigFile.compare(slash + 1, std::string::npos, file))) {
+    this->reloadTracker();
+  } else if (::kafkaparser::KAFKA_CONFIG_FILE == path) {
+    this->reloadKafka();
+  } else if (::sourceparser::SOURCES_CONFIG_FILE == path) {
+    this->reloadSources();
+  }
+}
+
+void VehicleTrackingPipeline::reloadAnalytics() {
+  std::shared_ptr<const ::gates::GateRegistry> gates;
+  try {
+    gates = std::make_shared<const ::gates::GateRegistry>(ANALYTICS_CONFIG_FILE);
+  } catch (const std::exception &ex) {
+    LOG_ERROR("Analytics config not reloaded: {}", ex.what());
+    return;
+  }
+  LOG_INFO("Analytics config changed, {} gate lines from the next frame", gates->lines());
+  auto *analytics = mAnalytics;
+  this->whileIdle(mAnalyticsQueue, [analytics, gates](GstPad *) {
+    // nvdsanalytics parses the file again whenever it is set
+    g_object_set (G_OBJECT (analytics), "config-file", ANALYTICS_CONFIG_FILE, nullptr);
+    ::metadata::setGates(gates);
+  });
+}
+
+void VehicleTrackingPipeline::reloadTracker() {
+  ::trackerparsing::tracker_info_t trackerInfo;
+  if (!::trackerparsing::parseTrackerConfig(trackerInfo)) {
+    LOG_ERROR("Tracker config not reloaded, see {}", ::trackerparsing::TRACKER_CONFIG_FILE);
+    return;
+  }
+  mTrackerLlConfigFile = trackerInfo.mLlConfigFile;
+  LOG_INFO("Tracker config changed, restarting the tracker at the next frame");
+  auto *tracker = mTracker;
+  this->whileIdle(mTrackerQueue, [tracker, trackerInfo](GstPad *queueSrc) {
+    // Unlinked so that the queue sends its caps and segment again to the
+    // restarted element
+    auto *trackerSink = gst_element_get_static_pad (tracker, PAD_NAME_TRACKER_SINK);
+    gst_pad_unlink (queueSrc, trackerSink);
+    gst_element_set_state (tracker, GST_STATE_NULL);
+    ::trackerparsing::applyTrackerProperties(tracker, trackerInfo);
+    if (GST_PAD_LINK_OK != gst_pad_link (queueSrc, trackerSink) ||
+        !gst_element_sync_state_with_parent (tracker)) {
+      LOG_ERROR("Unable to restart the tracker");
+    }
+    gst_object_unref (trackerSink);
+    gst_pad_add_probe (queueSrc, GST_PAD_PROBE_TYPE_BUFFER, markTrackerRestart, nullptr, nullptr);
+  });
+}
+
+void VehicleTrackingPipeline::reloadKafka() {
+  if (!mProducerReady) {
+    LOG_WARN("Kafka config not reloaded, the producer is still connecting");
+    return;
+  }
+  ::kafkaproducer::kafka_info_t kafkaInfo;
+  if (!::kafkaparser::setKafkaProperties(kafkaInfo)) {
+    LOG_ERROR("Kafka config not reloaded, see {}", ::kafkaparser::KAFKA_CONFIG_FILE);
+    return;
+  }
+  auto producer = mProducer;
+  if (kafkaInfo.mEndpoint != mKafkaInfo.mEndpoint || kafkaInfo.mTopic != mKafkaInfo.mTopic) {
+    try {
+      // Connects and creates the topic here, the old producer keeps
+      // publishing in the meantime
+      ::placement::ScopedKafkaPlacement kafkaPlacement;
+      producer = std::make_shared<::kafkaproducer::KafkaProducer>(kafkaInfo.mEndpoint, kafkaInfo.mTopic, mKafkaCall);
+    } catch (const std::exception &ex) {
+      LOG_ERROR("Kafka config not reloaded, unable to create producer: {}", ex.what());
+      return;
+    }
+  }
+  auto old = ::metadata::setSink(::metadata::sink_t{producer, kafkaInfo.mPerEvent});
+  mProducer = producer;
+  mKafkaInfo.mEndpoint = kafkaInfo.mEndpoint;
+  mKafkaInfo.mTopic = kafkaInfo.mTopic;
+  mKafkaInfo.mPerEvent = kafkaInfo.mPerEvent;
+  LOG_INFO("Publishing to {} on {}, per-event {}", mKafkaInfo.mTopic, mKafkaInfo.mEndpoint, mKafkaInfo.mPerEvent);
+  retire(std::move(old));
+}
+
+void VehicleTrackingPipeline::reloadSources() {
+  ::sources::source_list_t sourceList;
+  if (!::sourceparser::parseSourcesConfig(sourceList, mAppInfo.mSources.mMaxSources)) {
+    LOG_ERROR("Sources not reloaded, see {}", ::sourceparser::SOURCES_CONFIG_FILE);
+    return;
+  }
+  LOG_INFO("Sources changed, {} besides the command line", sourceList.size());
+  // Pads are requested and released with the pipeline's state lock, never
+  // from the watcher thread
+  g_idle_add (runOnce, new std::function<void()>([this, sourceList]() {
+    mSourceManager->update(sourceList);
+    if (mWatchdog) {
+      this->retireSources();
+    }
+  }));
+}
+
+void VehicleTrackingPipeline::whileIdle(GstElement *queue, const std::function<void(GstPad *)> &apply) {
+  auto *pad = gst_element_get_static_pad (queue, PAD_NAME_SRC);
+  // Freed by the pad if it goes away before it is ever idle
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_IDLE, applyIdle, new reconfiguration_t(apply),
+    freeReconfiguration);
+  gst_object_unref (pad);
+}
+
 void VehicleTrackingPipeline::run() {
   gst_element_set_state (mPipeline, GST_STATE_PLAYING);
   g_main_loop_run (mLoop);
+  // Nothing is reloaded past this point
+  mConfigWatcher.reset();
+  // Stopped before the windows and the checkpoint are read, so no buffer
+  // is left in the analytics probe
+  if (!this->stop()) {
+    LOG_ERROR("Pipeline did not stop within {} s of the stall, checkpointing anyway", STOP_TIMEOUT.count());
+    mWedged = true;
+  }
+
+  // Publish the windows still open at EOS while the producer is alive
+  ::metadata::flushWindows();
+  ::metadata::checkpointNow();
+  if (0 != mMetricsSourceId) {
+    // The totals of the whole run
+    writeMetrics(this);
+  }
 
   // Out of the main loop, clean up
   this->cleanup();
+  ::metadata::closeArchive();
+}
+
+bool VehicleTrackingPipeline::stop() {
+  if (ERR_STALLED != mExitCode) {
+    if (GST_STATE_CHANGE_ASYNC == gst_element_set_state (mPipeline, GST_STATE_NULL)) {
+      gst_element_get_state (mPipeline, nullptr, nullptr, GST_CLOCK_TIME_NONE);
+    }
+    return true;
+  }
+  // Deactivating the pads waits for the stream locks, the wedged element
+  // holds its own: the change runs on a thread of its own, left behind
+  // when it does not finish in time
+  auto *pipeline = GST_ELEMENT (gst_object_ref (mPipeline));
+  std::packaged_task<void()> change([pipeline]() {
+    if (GST_STATE_CHANGE_ASYNC == gst_element_set_state (pipeline, GST_STATE_NULL)) {
+      gst_element_get_state (pipeline, nullptr, nullptr, GST_CLOCK_TIME_NONE);
+    }
+    gst_object_unref (pipeline);
+  });
+  auto stopped = change.get_future();
+  std::thread(std::move(change)).detach();
+  return std::future_status::ready == stopped.wait_for(STOP_TIMEOUT);
 }
 
 void VehicleTrackingPipeline::cleanup() {
-  gst_element_set_state (mPipeline, GST_STATE_NULL);
-  gst_object_unref (GST_OBJECT (mPipeline));
+  if (0 != mIntervalSourceId) {
+    g_source_remove (mIntervalSourceId);
+    mIntervalSourceId = 0;
+  }
+  if (0 != mQueueSourceId) {
+    g_source_remove (mQueueSourceId);
+    mQueueSourceId = 0;
+  }
+  if (0 != mMetricsSourceId) {
+    g_source_remove (mMetricsSourceId);
+    mMetricsSourceId = 0;
+  }
+  if (0 != mWatchdogSourceId) {
+    g_source_remove (mWatchdogSourceId);
+    mWatchdogSourceId = 0;
+  }
+  if (0 != mProducerSourceId) {
+    g_source_remove (mProducerSourceId);
+    mProducerSourceId = 0;
+  }
+  if (nullptr != mHoldPad) {
+    gst_pad_remove_probe (mHoldPad, mHoldProbeId);
+    gst_object_unref (mHoldPad);
+    mHoldPad = nullptr;
+  }
+  if (!mWedged) {
+    gst_element_set_state (mPipeline, GST_STATE_NULL);
+    gst_object_unref (GST_OBJECT (mPipeline));
+  }
   g_source_remove (mBusWatchId);
   g_main_loop_unref (mLoop);
   mCleanup = true;
@@ -0,0 +1,136 @@
+#include "watchdog.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "logger.h"
+
+namespace {
+constexpr auto METRIC_STAGE_BUFFERS = "vt_stage_buffers_total";
+constexpr auto METRIC_STAGE_BUFFERS_HELP = "Buffers out of each pipeline stage, the watchdog heartbeats";
+constexpr std::int64_t NEVER = -1;
+} // namespace
+
+namespace watchdog {
+
+Stage::Stage(const std::string &name, const Stage *upstream, const std::uint32_t source, const bool watched):
+  mName{name},
+  mUpstream{upstream},
+  mSource{source},
+  mWatched{watched},
+  mBeats{metrics::counter(METRIC_STAGE_BUFFERS, METRIC_STAGE_BUFFERS_HELP, "stage=\"" + name + "\"")},
+  mFinished{false},
+  // A source added again under its old name counts on from there
+  mSeenBeats{mBeats.value()},
+  mProgressMs{NEVER},
+  mNextAttemptMs{0},
+  mRate{0.0},
+  mAttempts{0},
+  mStarted{false},
+  mRetired{false}
+{}
+
+Watchdog::Watchdog(const watchdog_info_t &info):
+  mInfo{info},
+  mLastCheckMs{NEVER}
+{
+  if (mInfo.mPeriodMs == 0 || mInfo.mStallMs < mInfo.mPeriodMs) {
+    throw std::invalid_argument(ERR_MSG_STALL);
+  }
+}
+
+Stage *Watchdog::addStage(const std::string &name, const Stage *upstream, const std::uint32_t source,
+  const bool watched) {
+  mStages.emplace_back(new Stage(name, upstream, source, watched));
+  return mStages.back().get();
+}
+
+void Watchdog::retire(Stage *stage) {
+  stage->mRetired = true;
+}
+
+bool Watchdog::stalled(const Stage &stage, const std::int64_t nowMs) const {
+  if (!stage.mWatched || stage.mRetired || stage.mFinished.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (!stage.mStarted) {
+    // A source waits for the pipeline to play, an element for its engine
+    // or for the first buffer from upstream, within startup-ms
+    return 0 != mInfo.mStartupMs && nowMs - stage.mProgressMs >= mInfo.mStartupMs &&
+      (nullptr == stage.mUpstream || stage.mUpstream->mStarted);
+  }
+  if (nowMs - stage.mProgressMs < mInfo.mStallMs) {
+    return false;
+  }
+  return nullptr == stage.mUpstream || stage.mUpstream->mProgressMs > stage.mProgressMs;
+}
+
+std::vector<Stall> Watchdog::check(const std::int64_t nowMs) {
+  auto elapsedMs = NEVER == mLastCheckMs ? 0 : nowMs - mLastCheckMs;
+  mLastCheckMs = nowMs;
+  for (auto &stage: mStages) {
+    if (stage->mRetired) {
+      continue;
+    }
+    auto beats = stage->mBeats.value();
+    stage->mRate = elapsedMs > 0 ? (beats - stage->mSeenBeats) * 1000.0 / elapsedMs : 0.0;
+    if (NEVER == stage->mProgressMs || beats != stage->mSeenBeats) {
+      stage->mStarted = stage->mStarted || beats != stage->mSeenBeats;
+      if (stage->mAttempts > 0) {
+        LOG_WARN("Watchdog: {} recovered after {} attempts", stage->mName, stage->mAttempts);
+      }
+      stage->mSeenBeats = beats;
+      stage->mProgressMs = nowMs;
+      stage->mAttempts = 0;
+    }
+  }
+
+  std::vector<Stage*> candidates;
+  for (auto &stage: mStages) {
+    if (this->stalled(*stage, nowMs)) {
+      candidates.push_back(stage.get());
+    }
+  }
+  std::vector<const Stage*> backpressured;
+  for (const auto *stage: candidates) {
+    for (const auto *up = stage->mUpstream; nullptr != up; up = up->mUpstream) {
+      backpressured.push_back(up);
+    }
+  }
+  auto isBackpressured = [&backpressured](const Stage *stage) {
+    return std::find(backpressured.begin(), backpressured.end(), stage) != backpressured.end();
+  };
+  bool pipelineStalled = std::any_of(candidates.begin(), candidates.end(),
+    [&isBackpressured](const Stage *stage) { return NO_SOURCE == stage->mSource && !isBackpressured(stage); });
+
+  std::vector<Stall> stalls;
+  for (auto *stage: candidates) {
+    if (isBackpressured(stage) || (NO_SOURCE != stage->mSource && pipelineStalled) ||
+        nowMs < stage->mNextAttemptMs) {
+      continue;
+    }
+    stalls.push_back(Stall{stage, nowMs - stage->mProgressMs, stage->mAttempts >= mInfo.mRecoveryAttempts});
+    stage->mAttempts++;
+    stage->mNextAttemptMs = nowMs + mInfo.mStallMs;
+  }
+  return stalls;
+}
+
+std::vector<std::string> Watchdog::describe(const std::int64_t nowMs) const {
+  std::vector<std::string> lines;
+  for (const auto &stage: mStages) {
+    if (stage->mRetired) {
+      continue;
+    }
+    std::ostringstream line;
+    line << stage->mName << ": " << stage->mSeenBeats << " buffers, " << std::fixed << std::setprecision(1)
+         << stage->mRate << "/s, last " << (nowMs - stage->mProgressMs) << " ms ago"
+         << (stage->mFinished.load(std::memory_order_relaxed) ? ", EOS" : "");
+    lines.push_back(line.str());
+  }
+  return lines;
+}
+
+} // namespace watchdog
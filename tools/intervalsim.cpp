@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "intervalcontroller.h"
+
+namespace {
+
+// A queue in front of nvinfer fed at the frame rate and drained at what
+// inference and tracking manage per frame. Inference runs on one frame in
+// interval + 1 and gets dearer with the objects in view.
+constexpr double FPS = 25.0;
+constexpr double QUEUE_BUFFERS = 200.0;
+constexpr double INFER_MS = 25.0;
+constexpr double INFER_MS_PER_OBJECT = 1.2;
+constexpr double TRACK_MS = 8.0;
+
+constexpr auto EXIT_FAILED = 2;
+
+struct Phase {
+  const char *mName;
+  double mSeconds;
+  double mObjects;  // per frame
+};
+
+// An empty scene, steady traffic, a rush the pipeline can't keep up with
+// at interval 0, then light traffic again
+constexpr Phase PHASES[] = {
+  {"empty", 20.0, 0.0},
+  {"traffic", 60.0, 12.0},
+  {"rush", 60.0, 30.0},
+  {"light", 120.0, 3.0},
+};
+
+struct PhaseResult {
+  std::uint32_t mFirst;
+  std::uint32_t mMax;
+  std::uint32_t mLast;
+  std::uint32_t mChanges;
+  std::uint32_t mDowns;
+  double mLastDownMs;
+  double mDownGapMs;    // between the last two step downs
+  bool mBackingOff;     // every gap between step downs longer than the one before
+};
+
+void usage(const char *app) {
+  std::cerr << "Usage: " << app << " [--trace]" << std::endl;
+  std::cerr << "  Feeds the nvinfer interval controller, default [interval-control] settings," << std::endl;
+  std::cerr << "  with samples of a simulated load and checks that the interval goes quiet" << std::endl;
+  std::cerr << "  on an empty scene, up under a rush and back down once it has passed, and" << std::endl;
+  std::cerr << "  that it waits longer before each step down it had to take back." << std::endl;
+}
+
+bool check(const bool passed, const char *what) {
+  std::cout << (passed ? "PASS: " : "FAIL: ") << what << std::endl;
+  return passed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bool trace = false;
+  for (int idx = 1; idx < argc; ++idx) {
+    if (!std::strcmp(argv[idx], "--trace")) {
+      trace = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  intervalcontrol::interval_control_info_t info;
+  intervalcontrol::IntervalController controller{info};
+  const double periodMs = info.mPeriodMs;
+  double backlog = 0;  // buffers queued
+  PhaseResult results[sizeof(PHASES) / sizeof(PHASES[0])];
+  double time = 0;
+
+  for (std::size_t phase = 0; phase < sizeof(PHASES) / sizeof(PHASES[0]); ++phase) {
+    const auto &load = PHASES[phase];
+    auto &result = results[phase];
+    result = PhaseResult{controller.interval(), controller.interval(), controller.interval(), 0, 0, 0.0, 0.0, true};
+    for (double elapsed = 0; elapsed < load.mSeconds * 1000; elapsed += periodMs, time += periodMs) {
+      auto interval = controller.interval();
+      auto frameMs = TRACK_MS + (INFER_MS + INFER_MS_PER_OBJECT * load.mObjects) / (interval + 1);
+      auto served = periodMs / frameMs;
+      backlog = std::min(std::max(0.0, backlog + FPS * periodMs / 1000 - served), QUEUE_BUFFERS);
+      auto latencyMs = backlog / FPS * 1000 + frameMs;
+      if (!controller.update(intervalcontrol::load_sample_t{backlog / QUEUE_BUFFERS, latencyMs, load.mObjects})) {
+        continue;
+      }
+      if (controller.interval() < interval) {
+        auto gap = time - result.mLastDownMs;
+        if (result.mDowns > 0) {
+          result.mBackingOff = result.mBackingOff && gap > result.mDownGapMs;
+          result.mDownGapMs = gap;
+        }
+        result.mLastDownMs = time;
+        ++result.mDowns;
+      }
+      interval = controller.interval();
+      result.mMax = std::max(result.mMax, interval);
+      ++result.mChanges;
+      if (trace) {
+        std::cout << std::fixed << std::setprecision(1) << std::setw(7) << time / 1000 << " s  "
+                  << std::setw(8) << load.mName << "  queue " << std::setw(5) << backlog << "  latency "
+                  << std::setw(7) << latencyMs << " ms  interval " << interval << " ("
+                  << controller.reason() << ")" << std::defaultfloat << std::setprecision(6) << std::endl;
+      }
+    }
+    result.mLast = controller.interval();
+    std::cout << std::setw(8) << load.mName << ": " << load.mObjects << " objects, interval "
+              << result.mFirst << " at the start, " << result.mMax << " at most, " << result.mChanges
+              << " changes, " << result.mLast << " at the end" << std::endl;
+  }
+
+  const auto &empty = results[0];
+  const auto &traffic = results[1];
+  const auto &rush = results[2];
+  const auto &light = results[3];
+  bool passed = check(empty.mLast == info.mQuietInterval, "an empty scene ends at the quiet interval");
+  passed = check(traffic.mDowns >= 3 && traffic.mBackingOff,
+    "steady traffic waits longer before every step down") && passed;
+  passed = check(rush.mMax > rush.mFirst, "the rush steps the interval up") && passed;
+  passed = check(light.mLast < rush.mMax && light.mLast == info.mMinInterval,
+    "light traffic steps it back down to the minimum") && passed;
+  return passed ? 0 : EXIT_FAILED;
+}
@@ -0,0 +1,127 @@
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "shmcounters.h"
+
+namespace {
+
+constexpr auto DEFAULT_SEGMENT = "/vehicle-tracking-od";
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+
+void usage(const char *app) {
+  std::cerr << "Usage: " << app << " [--json] [segment-name]" << std::endl;
+  std::cerr << "  Prints the O/D matrix summed over every pipeline process counting into" << std::endl;
+  std::cerr << "  the shared segment (default " << DEFAULT_SEGMENT << ")." << std::endl;
+}
+
+std::uint64_t sliceTotal(const shmcounters::ProcessSlot &slot) {
+  std::uint64_t total = 0;
+  for (const auto &entry: slot.mCounts) {
+    for (const auto &count: entry) {
+      total += count.load(std::memory_order_relaxed);
+    }
+  }
+  return total;
+}
+
+void printText(const shmcounters::SharedCounters &counters) {
+  const auto &segment = counters.segment();
+  auto totals = counters.totals();
+  std::cout << "     ";
+  for (const auto &gate: segment.mGateNames) {
+    std::cout << std::setw(8) << gate;
+  }
+  std::cout << std::endl;
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    std::cout << std::setw(5) << segment.mGateNames[entry];
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      std::cout << std::setw(8) << totals[entry][exit];
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::endl << "slot  pid      state  total     last update  label" << std::endl;
+  for (std::size_t idx = 0; idx < shmcounters::MAX_PROCESSES; ++idx) {
+    const auto &slot = segment.mSlots[idx];
+    auto pid = slot.mPid.load(std::memory_order_acquire);
+    if (pid <= 0) {
+      continue;
+    }
+    auto updated = slot.mUpdated.load(std::memory_order_relaxed);
+    char stamp[32] = "-";
+    if (0 != updated) {
+      time_t seconds = static_cast<time_t>(updated / NSEC_PER_SEC);
+      struct tm tm{};
+      localtime_r(&seconds, &tm);
+      strftime(stamp, sizeof(stamp), "%H:%M:%S", &tm);
+    }
+    std::cout << std::left << std::setw(6) << idx << std::setw(9) << pid
+              << std::setw(7) << (shmcounters::SharedCounters::alive(slot) ? "alive" : "gone")
+              << std::setw(10) << sliceTotal(slot) << std::setw(13) << stamp
+              << slot.mLabel << std::right << std::endl;
+  }
+}
+
+void printJson(const shmcounters::SharedCounters &counters) {
+  const auto &segment = counters.segment();
+  auto totals = counters.totals();
+  std::cout << "{\"gates\":[";
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    std::cout << (idx ? "," : "") << std::quoted(segment.mGateNames[idx]);
+  }
+  std::cout << "], \"od\":[";
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    std::cout << (entry ? "," : "") << "[";
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      std::cout << (exit ? "," : "") << totals[entry][exit];
+    }
+    std::cout << "]";
+  }
+  std::cout << "], \"processes\":[";
+  bool first = true;
+  for (std::size_t idx = 0; idx < shmcounters::MAX_PROCESSES; ++idx) {
+    const auto &slot = segment.mSlots[idx];
+    auto pid = slot.mPid.load(std::memory_order_acquire);
+    if (pid <= 0) {
+      continue;
+    }
+    std::cout << (first ? "" : ",") << "{\"slot\":" << idx << ", \"pid\":" << pid
+              << ", \"label\":" << std::quoted(slot.mLabel)
+              << ", \"alive\":" << (shmcounters::SharedCounters::alive(slot) ? "true" : "false")
+              << ", \"total\":" << sliceTotal(slot)
+              << ", \"updated_ms\":" << slot.mUpdated.load(std::memory_order_relaxed) / 1000000 << "}";
+    first = false;
+  }
+  std::cout << "]}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bool json = false;
+  std::string name = DEFAULT_SEGMENT;
+  for (int idx = 1; idx < argc; ++idx) {
+    if (!std::strcmp(argv[idx], "--json")) {
+      json = true;
+    } else if (argv[idx][0] == '/') {
+      name = argv[idx];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  try {
+    shmcounters::SharedCounters counters(name);
+    if (json) {
+      printJson(counters);
+    } else {
+      printText(counters);
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
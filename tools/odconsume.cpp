@@ -0,0 +1,246 @@
+#include <signal.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "metaring.h"
+
+namespace {
+
+constexpr auto DEFAULT_RING = "/vehicle-tracking-meta";
+// Caught up, wait for the probe's next batch
+constexpr auto POLL_WAIT = std::chrono::milliseconds(1);
+// Caught up for that long, check whether the writer is gone or restarted
+constexpr auto IDLE_CHECK = std::chrono::seconds(1);
+
+using counts_t = std::array<std::array<std::uint64_t, N>, N>;
+using steady_clock_t = std::chrono::steady_clock;
+
+std::atomic<bool> stopping{false};
+
+struct Options {
+  std::string mRing{DEFAULT_RING};
+  std::uint64_t mPeriod{0};  // seconds, 0 prints at the end only
+  bool mJson{false};
+  bool mEvents{false};
+  bool mFromOldest{false};
+};
+
+struct Crossing {
+  std::uint64_t mId;
+  std::uint8_t mGate;  // NO_GATE for an object that crossed nothing
+};
+
+struct Entry {
+  std::uint8_t mGate;
+  std::uint64_t mSeen;  // sequence of the last record the vehicle was in
+};
+
+struct Totals {
+  counts_t mCounts;
+  std::uint64_t mFrames;
+  std::uint64_t mExits;
+  std::uint64_t mTruncated;
+  std::uint64_t mRestarts;  // rings started by a new writer
+};
+
+void usage(const char *app) {
+  std::cerr << "Usage: " << app << " [options] [ring-name]" << std::endl;
+  std::cerr << "  Counts the O/D matrix from the frame records a pipeline publishes to" << std::endl;
+  std::cerr << "  its metadata ring (default " << DEFAULT_RING << "), until interrupted or the" << std::endl;
+  std::cerr << "  pipeline is gone and every record has been read." << std::endl;
+  std::cerr << "  --events          one NDJSON line per exit, as the kafka event messages" << std::endl;
+  std::cerr << "  --period SECONDS  prints the matrix every SECONDS too" << std::endl;
+  std::cerr << "  --from-oldest     starts with the oldest record still in the ring" << std::endl;
+  std::cerr << "  --json" << std::endl;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+  for (int idx = 1; idx < argc; ++idx) {
+    const char *arg = argv[idx];
+    bool hasValue = idx + 1 < argc;
+    if (!std::strcmp(arg, "--json")) {
+      options.mJson = true;
+    } else if (!std::strcmp(arg, "--events")) {
+      options.mEvents = true;
+    } else if (!std::strcmp(arg, "--from-oldest")) {
+      options.mFromOldest = true;
+    } else if (!std::strcmp(arg, "--period") && hasValue) {
+      char *end = nullptr;
+      options.mPeriod = std::strtoull(argv[++idx], &end, 10);
+      if ('\0' != *end) {
+        return false;
+      }
+    } else if ('/' == arg[0]) {
+      options.mRing = arg;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void stop(int) {
+  stopping = true;
+}
+
+void printText(std::ostream &out, const metaring::RingHeader &header, const Totals &totals,
+  const metaring::RingReader &reader) {
+  out << "     ";
+  for (const auto &gate: header.mGateNames) {
+    out << std::setw(8) << gate;
+  }
+  out << std::endl;
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    out << std::setw(5) << header.mGateNames[entry];
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      out << std::setw(8) << totals.mCounts[entry][exit];
+    }
+    out << std::endl;
+  }
+  out << "frames " << totals.mFrames << ", exits " << totals.mExits << ", lost " << reader.lost()
+      << ", truncated objects " << totals.mTruncated << ", ring restarts " << totals.mRestarts << std::endl;
+}
+
+void printJson(std::ostream &out, const metaring::RingHeader &header, const Totals &totals,
+  const metaring::RingReader &reader) {
+  out << "{\"gates\":[";
+  for (std::size_t idx = 0; idx < N; ++idx) {
+    out << (idx ? "," : "") << std::quoted(header.mGateNames[idx]);
+  }
+  out << "], \"od\":[";
+  for (std::size_t entry = 0; entry < N; ++entry) {
+    out << (entry ? "," : "") << "[";
+    for (std::size_t exit = 0; exit < N; ++exit) {
+      out << (exit ? "," : "") << totals.mCounts[entry][exit];
+    }
+    out << "]";
+  }
+  out << "], \"frames\":" << totals.mFrames << ", \"exits\":" << totals.mExits
+      << ", \"lost\":" << reader.lost() << ", \"truncated\":" << totals.mTruncated
+      << ", \"ring_restarts\":" << totals.mRestarts << "}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage(argv[0]);
+    return 1;
+  }
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  // The matrix goes to stderr when stdout carries the events
+  std::ostream &report = options.mEvents ? std::cerr : std::cout;
+
+  try {
+    std::unique_ptr<metaring::RingReader> reader{new metaring::RingReader(options.mRing, options.mFromOldest)};
+    Totals totals{};
+    // Gate each vehicle entered through, by source and tracker id. A
+    // vehicle whose exit was lost, or never came, is dropped once it has
+    // not been seen for a lap of the ring.
+    std::vector<std::unordered_map<std::uint64_t, Entry>> entries;
+    std::uint64_t lastSweep = 0;
+    std::vector<Crossing> crossings;
+    crossings.reserve(metaring::MAX_OBJECTS);
+    auto idleSince = steady_clock_t::now();
+    auto nextReport = steady_clock_t::now() + std::chrono::seconds(options.mPeriod);
+    while (!stopping) {
+      const auto *record = reader->next();
+      auto now = steady_clock_t::now();
+      if (options.mPeriod && now >= nextReport) {
+        options.mJson ? printJson(report, reader->header(), totals, *reader) :
+          printText(report, reader->header(), totals, *reader);
+        nextReport = now + std::chrono::seconds(options.mPeriod);
+      }
+      if (nullptr == record) {
+        if (now - idleSince < IDLE_CHECK) {
+          std::this_thread::sleep_for(POLL_WAIT);
+          continue;
+        }
+        if (reader->replaced()) {
+          // A restarted pipeline, its tracker ids start over
+          reader.reset(new metaring::RingReader(options.mRing, true));
+          entries.clear();
+          lastSweep = 0;
+          ++totals.mRestarts;
+        } else if (!reader->writerAlive()) {
+          break;
+        }
+        idleSince = steady_clock_t::now();
+        continue;
+      }
+      idleSince = now;
+      // Read in place: only the crossings are kept until the record is
+      // known to be intact
+      auto source = record->mSource;
+      auto truncated = record->mTruncated;
+      crossings.clear();
+      for (std::uint32_t idx = 0; idx < record->mObjects && idx < metaring::MAX_OBJECTS; ++idx) {
+        const auto &object = record->mObject[idx];
+        crossings.push_back(Crossing{object.mId, object.mGate < N ? object.mGate : metaring::NO_GATE});
+      }
+      if (!reader->release()) {
+        continue;
+      }
+      auto sequence = reader->sequence();
+      const std::uint64_t slots = reader->header().mSlots;
+      ++totals.mFrames;
+      totals.mTruncated += truncated;
+      if (source >= entries.size()) {
+        entries.resize(source + 1);
+      }
+      for (const auto &crossing: crossings) {
+        auto entry = entries[source].find(crossing.mId);
+        if (metaring::NO_GATE == crossing.mGate) {
+          if (entry != entries[source].end()) {
+            entry->second.mSeen = sequence;
+          }
+          continue;
+        }
+        if (entry == entries[source].end()) {
+          entries[source].emplace(crossing.mId, Entry{crossing.mGate, sequence});
+          continue;
+        }
+        ++totals.mCounts[entry->second.mGate][crossing.mGate];
+        ++totals.mExits;
+        if (options.mEvents) {
+          const auto &header = reader->header();
+          std::cout << "{\"event\":{\"entry\":" << std::quoted(header.mGateNames[entry->second.mGate])
+                    << ", \"exit\":" << std::quoted(header.mGateNames[crossing.mGate])
+                    << ", \"id\":" << crossing.mId << ", \"source\":" << source << "}}" << std::endl;
+        }
+        entries[source].erase(entry);
+      }
+      if (sequence - lastSweep >= slots) {
+        for (auto &byId: entries) {
+          for (auto entry = byId.begin(); entry != byId.end();) {
+            if (sequence - entry->second.mSeen > slots) {
+              entry = byId.erase(entry);
+            } else {
+              ++entry;
+            }
+          }
+        }
+        lastSweep = sequence;
+      }
+    }
+    options.mJson ? printJson(report, reader->header(), totals, *reader) :
+      printText(report, reader->header(), totals, *reader);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,512 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "archive.h"
+#include "gatenames.h"
+
+namespace {
+
+constexpr std::size_t GATES = gates::COUNT;
+
+constexpr std::uint64_t NSEC_PER_MSEC = 1000000ULL;
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+constexpr std::uint64_t NO_LIMIT = std::numeric_limits<std::uint64_t>::max();
+// NDJSON files are split into chunks of this size, cut at line ends
+constexpr std::size_t TEXT_CHUNK = 32 * 1024 * 1024;
+
+constexpr char KEY_EVENT[] = "\"event\"";
+constexpr char KEY_ENTRY[] = "\"entry\"";
+constexpr char KEY_EXIT[] = "\"exit\"";
+
+using counts_t = std::array<std::array<std::uint64_t, GATES>, GATES>;
+
+struct WindowSpec {
+  std::uint64_t mLength;  // nanoseconds
+  std::uint64_t mHop;
+};
+
+struct Options {
+  std::uint64_t mFrom{0};        // ns since epoch
+  std::uint64_t mTo{NO_LIMIT};
+  bool mRange{false};
+  std::vector<WindowSpec> mWindows;
+  unsigned mThreads{0};
+  bool mJson{false};
+  std::vector<std::string> mFiles;
+};
+
+// Counts of one thread, merged once every file is read
+struct Shard {
+  counts_t mCounts{};
+  std::uint64_t mEvents{0};
+  std::uint64_t mUntimed{0};   // NDJSON lines without a timestamp
+  std::uint64_t mOutside{0};   // out of --from/--to
+  std::uint64_t mMalformed{0};
+  std::vector<std::unordered_map<std::uint64_t, counts_t>> mBuckets;  // per window, by hop
+};
+
+struct TextFile {
+  const char *mBase;
+  std::size_t mSize;
+};
+
+struct Work {
+  bool mArchive;
+  std::size_t mSource;
+  std::size_t mBatch;   // archives
+  std::size_t mBegin;   // NDJSON
+  std::size_t mEnd;
+};
+
+void usage(const char *app) {
+  std::cerr << "Usage: " << app << " [options] FILE..." << std::endl;
+  std::cerr << "  Rebuilds the O/D matrix and window aggregates from crossing archives" << std::endl;
+  std::cerr << "  (.vtoc) and NDJSON captures of the kafka event messages. NDJSON lines" << std::endl;
+  std::cerr << "  may start with a timestamp in ms, as written by kcat -f '%T %s\\n';" << std::endl;
+  std::cerr << "  lines without one only count without --from/--to, never in windows." << std::endl;
+  std::cerr << "  --from TIME, --to TIME   ms since epoch or YYYY-MM-DDTHH:MM:SS (UTC)" << std::endl;
+  std::cerr << "  --tumbling SECONDS       tumbling window, repeatable" << std::endl;
+  std::cerr << "  --sliding SECONDS:HOP    sliding window, repeatable" << std::endl;
+  std::cerr << "  --threads N              default: every core" << std::endl;
+  std::cerr << "  --json" << std::endl;
+}
+
+bool parseTime(const char *text, std::uint64_t &time) {
+  char *end = nullptr;
+  auto ms = std::strtoull(text, &end, 10);
+  if (end != text && '\0' == *end) {
+    time = ms * NSEC_PER_MSEC;
+    return true;
+  }
+  struct tm tm{};
+  end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+  if (nullptr == end || '\0' != *end) {
+    return false;
+  }
+  time = static_cast<std::uint64_t>(timegm(&tm)) * NSEC_PER_SEC;
+  return true;
+}
+
+bool parseSeconds(const char *text, std::uint64_t &ns) {
+  char *end = nullptr;
+  auto seconds = std::strtoull(text, &end, 10);
+  if (end == text || 0 == seconds) {
+    return false;
+  }
+  ns = seconds * NSEC_PER_SEC;
+  return ':' == *end || '\0' == *end;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+  for (int idx = 1; idx < argc; ++idx) {
+    const char *arg = argv[idx];
+    bool hasValue = idx + 1 < argc;
+    if (!std::strcmp(arg, "--json")) {
+      options.mJson = true;
+    } else if (!std::strcmp(arg, "--from") && hasValue) {
+      options.mRange = true;
+      if (!parseTime(argv[++idx], options.mFrom)) {
+        return false;
+      }
+    } else if (!std::strcmp(arg, "--to") && hasValue) {
+      options.mRange = true;
+      if (!parseTime(argv[++idx], options.mTo)) {
+        return false;
+      }
+    } else if (!std::strcmp(arg, "--tumbling") && hasValue) {
+      WindowSpec spec{};
+      if (!parseSeconds(argv[++idx], spec.mLength)) {
+        return false;
+      }
+      spec.mHop = spec.mLength;
+      options.mWindows.push_back(spec);
+    } else if (!std::strcmp(arg, "--sliding") && hasValue) {
+      WindowSpec spec{};
+      const char *value = argv[++idx];
+      const char *hop = std::strchr(value, ':');
+      if (!parseSeconds(value, spec.mLength) || nullptr == hop || !parseSeconds(hop + 1, spec.mHop) ||
+          0 != spec.mLength % spec.mHop) {
+        return false;
+      }
+      options.mWindows.push_back(spec);
+    } else if (!std::strcmp(arg, "--threads") && hasValue) {
+      options.mThreads = static_cast<unsigned>(std::strtoul(argv[++idx], nullptr, 10));
+    } else if ('-' == arg[0]) {
+      return false;
+    } else {
+      options.mFiles.push_back(arg);
+    }
+  }
+  return !options.mFiles.empty() && options.mFrom < options.mTo;
+}
+
+// Index of a gate or line name ("SE" or "SE-Exit"), GATES when unknown
+std::size_t gateIndex(const char *name, const char *end) {
+  const char *dash = static_cast<const char*>(std::memchr(name, '-', end - name));
+  std::size_t length = (dash ? dash : end) - name;
+  for (std::size_t idx = 0; idx < GATES; ++idx) {
+    if (std::strlen(gates::NAMES[idx]) == length && 0 == std::memcmp(gates::NAMES[idx], name, length)) {
+      return idx;
+    }
+  }
+  return GATES;
+}
+
+// The string value of a key, in place
+bool stringValue(const char *line, const char *end, const char *key, const std::size_t keyLength,
+  const char *&value, const char *&valueEnd) {
+  const char *at = static_cast<const char*>(memmem(line, end - line, key, keyLength));
+  if (nullptr == at) {
+    return false;
+  }
+  at += keyLength;
+  while (at != end && (' ' == *at || ':' == *at)) {
+    ++at;
+  }
+  if (at == end || '"' != *at) {
+    return false;
+  }
+  value = at + 1;
+  valueEnd = static_cast<const char*>(std::memchr(value, '"', end - value));
+  return nullptr != valueEnd;
+}
+
+void count(const Options &options, Shard &shard, const std::uint64_t time, const std::size_t entry,
+  const std::size_t exit) {
+  if (time < options.mFrom || time >= options.mTo) {
+    ++shard.mOutside;
+    return;
+  }
+  shard.mCounts[entry][exit] += 1;
+  ++shard.mEvents;
+  for (std::size_t spec = 0; spec < options.mWindows.size(); ++spec) {
+    shard.mBuckets[spec][time / options.mWindows[spec].mHop][entry][exit] += 1;
+  }
+}
+
+void readBatch(const Options &options, const archive::ArchiveReader &reader, const std::size_t batch,
+  archive::columns_t &columns, Shard &shard) {
+  const auto &index = reader.batch(batch);
+  if (index.mLastTime < options.mFrom || index.mFirstTime >= options.mTo) {
+    shard.mOutside += index.mRows;
+    return;
+  }
+  constexpr std::uint32_t COLUMNS = (1U << archive::TIME) | (1U << archive::ENTRY) | (1U << archive::EXIT);
+  if (!reader.decode(batch, columns, COLUMNS)) {
+    shard.mMalformed += index.mRows;
+    return;
+  }
+  for (std::size_t row = 0; row < index.mRows; ++row) {
+    if (columns.mEntry[row] >= GATES || columns.mExit[row] >= GATES) {
+      ++shard.mMalformed;
+      continue;
+    }
+    count(options, shard, columns.mTime[row], columns.mEntry[row], columns.mExit[row]);
+  }
+}
+
+void readLine(const Options &options, const char *line, const char *end, Shard &shard) {
+  if (nullptr == memmem(line, end - line, KEY_EVENT, sizeof(KEY_EVENT) - 1)) {
+    // Window messages and anything else
+    return;
+  }
+  bool timed = false;
+  std::uint64_t time = 0;
+  const char *at = line;
+  while (at != end && *at >= '0' && *at <= '9') {
+    time = time * 10 + static_cast<std::uint64_t>(*at++ - '0');
+    timed = true;
+  }
+  time *= NSEC_PER_MSEC;
+  const char *entry = nullptr, *entryEnd = nullptr, *exit = nullptr, *exitEnd = nullptr;
+  if (!stringValue(at, end, KEY_ENTRY, sizeof(KEY_ENTRY) - 1, entry, entryEnd) ||
+      !stringValue(at, end, KEY_EXIT, sizeof(KEY_EXIT) - 1, exit, exitEnd)) {
+    ++shard.mMalformed;
+    return;
+  }
+  auto entryIdx = gateIndex(entry, entryEnd);
+  auto exitIdx = gateIndex(exit, exitEnd);
+  if (entryIdx >= GATES || exitIdx >= GATES) {
+    ++shard.mMalformed;
+    return;
+  }
+  if (!timed) {
+    ++shard.mUntimed;
+    if (!options.mRange) {
+      shard.mCounts[entryIdx][exitIdx] += 1;
+      ++shard.mEvents;
+    }
+    return;
+  }
+  count(options, shard, time, entryIdx, exitIdx);
+}
+
+// Lines starting in [begin, end)
+void readChunk(const Options &options, const TextFile &file, std::size_t begin, const std::size_t end,
+  Shard &shard) {
+  if (0 != begin) {
+    const char *newline = static_cast<const char*>(std::memchr(file.mBase + begin - 1, '\n',
+      file.mSize - begin + 1));
+    if (nullptr == newline) {
+      return;
+    }
+    begin = newline + 1 - file.mBase;
+  }
+  const char *fileEnd = file.mBase + file.mSize;
+  for (const char *line = file.mBase + begin; line < file.mBase + end && line < fileEnd;) {
+    const char *newline = static_cast<const char*>(std::memchr(line, '\n', fileEnd - line));
+    const char *lineEnd = newline ? newline : fileEnd;
+    readLine(options, line, lineEnd, shard);
+    line = lineEnd + 1;
+  }
+}
+
+bool isArchive(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open " + path);
+  }
+  std::uint64_t magic = 0;
+  auto got = read(fd, &magic, sizeof(magic));
+  close(fd);
+  return sizeof(magic) == got && archive::MAGIC == magic;
+}
+
+TextFile mapText(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st{};
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    throw std::runtime_error("Unable to open " + path);
+  }
+  TextFile file{nullptr, static_cast<std::size_t>(st.st_size)};
+  if (file.mSize > 0) {
+    void *base = mmap(nullptr, file.mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == base) {
+      close(fd);
+      throw std::runtime_error("Unable to map " + path);
+    }
+    madvise(base, file.mSize, MADV_SEQUENTIAL);
+    file.mBase = static_cast<const char*>(base);
+  }
+  close(fd);
+  return file;
+}
+
+void printMatrix(std::ostream &out, const counts_t &counts) {
+  out << "[";
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    out << (entry ? ",[" : "[");
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      out << (exit ? "," : "") << counts[entry][exit];
+    }
+    out << "]";
+  }
+  out << "]";
+}
+
+std::uint64_t total(const counts_t &counts) {
+  std::uint64_t sum = 0;
+  for (const auto &entry: counts) {
+    for (const auto exit: entry) {
+      sum += exit;
+    }
+  }
+  return sum;
+}
+
+void add(counts_t &into, const counts_t &from) {
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      into[entry][exit] += from[entry][exit];
+    }
+  }
+}
+
+// Every window with crossings, from the merged hop buckets
+void printWindows(std::ostream &out, const Options &options, const Shard &merged) {
+  bool first = true;
+  out << "[";
+  for (std::size_t spec = 0; spec < options.mWindows.size(); ++spec) {
+    const auto &window = options.mWindows[spec];
+    const auto &buckets = merged.mBuckets[spec];
+    std::vector<std::uint64_t> hops;
+    hops.reserve(buckets.size());
+    for (const auto &bucket: buckets) {
+      hops.push_back(bucket.first);
+    }
+    std::sort(hops.begin(), hops.end());
+    auto span = window.mLength / window.mHop;
+    // Windows ending with each hop that has crossings, and the ones the
+    // crossings slide through
+    std::vector<std::uint64_t> ends;
+    for (const auto hop: hops) {
+      for (std::uint64_t last = hop; last < hop + span; ++last) {
+        if (ends.empty() || ends.back() < last) {
+          ends.push_back(last);
+        }
+      }
+    }
+    for (const auto last: ends) {
+      counts_t counts{};
+      for (std::uint64_t hop = last + 1 >= span ? last + 1 - span : 0; hop <= last; ++hop) {
+        auto bucket = buckets.find(hop);
+        if (bucket != buckets.end()) {
+          add(counts, bucket->second);
+        }
+      }
+      auto end = (last + 1) * window.mHop;
+      out << (first ? "" : ",") << "{\"type\":" << (span > 1 ? "\"sliding\"" : "\"tumbling\"");
+      out << ", \"length\":" << window.mLength / NSEC_PER_SEC;
+      out << ", \"start_ms\":" << (end - window.mLength) / NSEC_PER_MSEC;
+      out << ", \"end_ms\":" << end / NSEC_PER_MSEC;
+      out << ", \"total\":" << total(counts) << ", \"od\":";
+      printMatrix(out, counts);
+      out << "}";
+      first = false;
+    }
+  }
+  out << "]";
+}
+
+void printText(const Options &options, const Shard &merged) {
+  std::cout << "     ";
+  for (const auto *gate: gates::NAMES) {
+    std::cout << std::setw(10) << gate;
+  }
+  std::cout << std::endl;
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    std::cout << std::setw(5) << gates::NAMES[entry];
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      std::cout << std::setw(10) << merged.mCounts[entry][exit];
+    }
+    std::cout << std::endl;
+  }
+  if (!options.mWindows.empty()) {
+    std::cout << std::endl << "windows: ";
+    printWindows(std::cout, options, merged);
+    std::cout << std::endl;
+  }
+}
+
+void printJson(const Options &options, const Shard &merged) {
+  std::cout << "{\"total\":" << merged.mEvents << ", \"gates\":[";
+  for (std::size_t idx = 0; idx < GATES; ++idx) {
+    std::cout << (idx ? "," : "") << std::quoted(gates::NAMES[idx]);
+  }
+  std::cout << "], \"od\":";
+  printMatrix(std::cout, merged.mCounts);
+  std::cout << ", \"windows\":";
+  printWindows(std::cout, options, merged);
+  std::cout << ", \"untimed\":" << merged.mUntimed << ", \"outside\":" << merged.mOutside;
+  std::cout << ", \"malformed\":" << merged.mMalformed << "}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage(argv[0]);
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<archive::ArchiveReader>> archives;
+  std::vector<TextFile> texts;
+  std::vector<Work> work;
+  try {
+    for (const auto &path: options.mFiles) {
+      if (isArchive(path)) {
+        archives.emplace_back(new archive::ArchiveReader(path));
+        if (archives.back()->recovered()) {
+          std::cerr << path << " has no footer, read " << archives.back()->batches() << " batches" << std::endl;
+        }
+        for (std::size_t batch = 0; batch < archives.back()->batches(); ++batch) {
+          work.push_back(Work{true, archives.size() - 1, batch, 0, 0});
+        }
+      } else {
+        texts.push_back(mapText(path));
+        for (std::size_t begin = 0; begin < texts.back().mSize; begin += TEXT_CHUNK) {
+          work.push_back(Work{false, texts.size() - 1, 0, begin,
+            std::min(begin + TEXT_CHUNK, texts.back().mSize)});
+        }
+      }
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  unsigned threads = options.mThreads ? options.mThreads : std::max(1U, std::thread::hardware_concurrency());
+  threads = std::max(1U, std::min<unsigned>(threads, static_cast<unsigned>(work.size())));
+  std::vector<Shard> shards(threads);
+  std::atomic<std::size_t> next{0};
+  auto shardMain = [&](Shard &shard) {
+    shard.mBuckets.resize(options.mWindows.size());
+    archive::columns_t columns;
+    for (auto idx = next.fetch_add(1); idx < work.size(); idx = next.fetch_add(1)) {
+      const auto &item = work[idx];
+      if (item.mArchive) {
+        readBatch(options, *archives[item.mSource], item.mBatch, columns, shard);
+      } else {
+        readChunk(options, texts[item.mSource], item.mBegin, item.mEnd, shard);
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned idx = 1; idx < threads; ++idx) {
+    pool.emplace_back(shardMain, std::ref(shards[idx]));
+  }
+  shardMain(shards[0]);
+  for (auto &thread: pool) {
+    thread.join();
+  }
+
+  Shard merged;
+  merged.mBuckets.resize(options.mWindows.size());
+  for (const auto &shard: shards) {
+    add(merged.mCounts, shard.mCounts);
+    merged.mEvents += shard.mEvents;
+    merged.mUntimed += shard.mUntimed;
+    merged.mOutside += shard.mOutside;
+    merged.mMalformed += shard.mMalformed;
+    for (std::size_t spec = 0; spec < shard.mBuckets.size(); ++spec) {
+      for (const auto &bucket: shard.mBuckets[spec]) {
+        add(merged.mBuckets[spec][bucket.first], bucket.second);
+      }
+    }
+  }
+  for (const auto &text: texts) {
+    if (text.mBase) {
+      munmap(const_cast<char*>(text.mBase), text.mSize);
+    }
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cerr << merged.mEvents << " events from " << options.mFiles.size() << " files in " << seconds
+            << " s on " << threads << " threads (" << std::fixed << std::setprecision(1)
+            << (merged.mEvents + merged.mOutside) / std::max(seconds, 1e-9) * 60 / 1e6 << "M events/min)"
+            << std::defaultfloat << std::endl;
+  if (options.mJson) {
+    printJson(options, merged);
+  } else {
+    printText(options, merged);
+  }
+  return 0;
+}
@@ -0,0 +1,875 @@
+#include <gst/gst.h>
+#include <glib.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <librdkafka/rdkafkacpp.h>
+
+#include "allocaccounting.h"
+#include "appparser.h"
+#include "gates.h"
+#include "kafkaparser.h"
+#include "kafkaproducer.h"
+#include "logger.h"
+#include "metadata.h"
+#include "metrics.h"
+#include "gstnvdsmeta.h"
+#include "nvds_analytics_meta.h"
+#include "nvdsmeta.h"
+#include "types.h"
+
+namespace {
+
+constexpr auto ANALYTICS_CONFIG_FILE = "cfg/config_nvdsanalytics.txt";
+constexpr auto CONFIG_GROUP_LINE_CROSSING = "line-crossing-stream-0";
+constexpr auto CONFIG_GROUP_ROI = "roi-filtering-stream-0";
+constexpr auto LINE_CROSSING_PREFIX = "line-crossing-";
+constexpr auto ROI_PREFIX = "roi-";
+constexpr auto ENTRY_SUFFIX = "-Entry";
+constexpr auto EXIT_SUFFIX = "-Exit";
+
+constexpr auto ERR_MSG_ANALYTICS_CONFIG = "Unable to read the analytics config";
+constexpr auto ERR_MSG_LINE = "Line crossings need a direction and a line, 8 coordinates";
+constexpr auto ERR_MSG_GATES = "Every gate needs an Entry and an Exit line";
+constexpr auto ERR_MSG_ROI = "The ROI of the roundabout needs at least 3 points";
+constexpr auto ERR_MSG_PATH = "Gate lines do not fit the roundabout model, path";
+
+constexpr std::size_t GATES = N;
+constexpr std::size_t NO_LINE = ~std::size_t{0};
+
+constexpr auto PGIE_CLASS_ID_BUS = 0;
+constexpr auto PGIE_CLASS_ID_CAR = 1;
+
+// Paths start and end this far out of the gate lines and join the ring
+// this far inside them, in pixels of the analytics config
+constexpr double APPROACH = 60.0;
+constexpr double INSIDE = 25.0;
+// The ring vehicles drive around, an ellipse in the ROI's bounding box
+constexpr double RING_SCALE = 0.55;
+constexpr double RING_STEP = M_PI / 36;
+constexpr double BOX_WIDTH = 60.0;
+constexpr double BOX_HEIGHT = 40.0;
+// A switched vehicle shows up under its new id after the tracker's probation
+constexpr std::uint32_t SWITCH_FRAMES = 3;
+constexpr double MIN_SPEED = 0.7;   // of the mean speed
+constexpr double SPEED_SPREAD = 0.6;
+
+constexpr std::uint64_t NSEC_PER_SEC = 1000000000ULL;
+constexpr auto EXIT_MISMATCH = 2;
+constexpr auto EXIT_ALLOC_REGRESSION = 3;
+
+using counts_t = std::array<std::array<std::uint64_t, GATES>, GATES>;
+
+struct Point {
+  double mX;
+  double mY;
+};
+
+Point operator+(const Point &lhs, const Point &rhs) { return Point{lhs.mX + rhs.mX, lhs.mY + rhs.mY}; }
+Point operator-(const Point &lhs, const Point &rhs) { return Point{lhs.mX - rhs.mX, lhs.mY - rhs.mY}; }
+Point operator*(const double scale, const Point &point) { return Point{scale * point.mX, scale * point.mY}; }
+
+double dot(const Point &lhs, const Point &rhs) { return lhs.mX * rhs.mX + lhs.mY * rhs.mY; }
+
+double cross(const Point &origin, const Point &lhs, const Point &rhs) {
+  return (lhs.mX - origin.mX) * (rhs.mY - origin.mY) - (lhs.mY - origin.mY) * (rhs.mX - origin.mX);
+}
+
+// A line of the analytics config: nvdsanalytics counts an object when its
+// track crosses the line along the direction
+struct Line {
+  std::string mName;   // "N-Entry"
+  std::size_t mGate;
+  bool mEntry;
+  Point mDirection;    // unit
+  Point mFrom;
+  Point mTo;
+};
+
+bool crosses(const Point &from, const Point &to, const Line &line) {
+  auto side = [](const double value) { return value > 0; };
+  return side(cross(line.mFrom, line.mTo, from)) != side(cross(line.mFrom, line.mTo, to)) &&
+    side(cross(from, to, line.mFrom)) != side(cross(from, to, line.mTo)) &&
+    dot(to - from, line.mDirection) > 0;
+}
+
+struct Path {
+  // Clamped to the ends
+  Point at(const double distance) const {
+    auto next = std::upper_bound(mDistance.begin(), mDistance.end(), distance) - mDistance.begin();
+    if (0 == next) {
+      return mPoints.front();
+    }
+    if (static_cast<std::size_t>(next) == mPoints.size()) {
+      return mPoints.back();
+    }
+    const auto &from = mPoints[next - 1];
+    auto share = (distance - mDistance[next - 1]) / (mDistance[next] - mDistance[next - 1]);
+    return from + share * (mPoints[next] - from);
+  }
+  double length() const { return mDistance.back(); }
+
+  std::vector<Point> mPoints;
+  std::vector<double> mDistance;  // along the path to every point
+};
+
+struct Scene {
+  std::vector<Line> mLines;
+  std::array<std::size_t, GATES> mEntryLine;
+  std::array<std::size_t, GATES> mExitLine;
+  std::string mRoiName;
+  std::vector<Point> mRoi;
+  std::array<std::array<Path, GATES>, GATES> mPaths;  // by entry and exit
+};
+
+bool inside(const std::vector<Point> &polygon, const Point &point) {
+  bool in = false;
+  for (std::size_t idx = 0, prev = polygon.size() - 1; idx < polygon.size(); prev = idx++) {
+    const auto &a = polygon[idx];
+    const auto &b = polygon[prev];
+    if ((a.mY > point.mY) != (b.mY > point.mY) &&
+        point.mX < (b.mX - a.mX) * (point.mY - a.mY) / (b.mY - a.mY) + a.mX) {
+      in = !in;
+    }
+  }
+  return in;
+}
+
+// Portable, so that a seed gives the same traffic with any standard library
+class Random final {
+ public:
+  explicit Random(const std::uint64_t seed) : mEngine{seed} {}
+  double uniform() { return static_cast<double>(mEngine() >> 11) * (1.0 / 9007199254740992.0); }
+  bool chance(const double probability) { return uniform() < probability; }
+  // Mean 1 / rate
+  double exponential(const double rate) { return -std::log(1.0 - uniform()) / rate; }
+  std::size_t below(const std::size_t count) {
+    return std::min(count - 1, static_cast<std::size_t>(uniform() * count));
+  }
+
+ private:
+  std::mt19937_64 mEngine;
+};
+
+struct Options {
+  std::uint32_t mStreams{1};
+  double mSeconds{3600};
+  double mFps{25};
+  double mSpeedup{0};          // times real time, 0 for as fast as possible
+  double mRate{6};             // arrivals per gate per minute
+  std::uint32_t mDensity{20};  // most vehicles in the scene of a stream
+  double mSpeed{150};          // pixels per second
+  double mSwitches{0};         // per vehicle minute
+  double mOcclusions{0};       // per vehicle minute
+  double mOcclusionMs{400};
+  double mBusShare{0.1};
+  std::uint64_t mSeed{1};
+  double mTolerance{0};        // percent
+  bool mKafka{false};
+  bool mJson{false};
+  bool mAllocCheck{false};     // fail on probe allocations past the warm-up
+};
+
+struct Vehicle {
+  std::uint64_t mId;         // tracker id, a switch gives a new one
+  std::size_t mEntry;
+  std::size_t mExit;
+  int mClass;
+  const Path *mPath;
+  double mDistance;          // along the path
+  double mSpeed;
+  Point mPosition;
+  // What nvdsanalytics knows of the current id
+  bool mTracked;
+  Point mLastSeen;
+  std::uint32_t mHidden;     // frames left occluded
+  std::size_t mFirstGate;    // first crossing under the current id, GATES for none
+};
+
+struct Stream {
+  std::vector<Vehicle> mVehicles;
+  std::array<double, GATES> mNextArrival;  // seconds
+  NvDsAnalyticsFrameMeta mFrameMeta;
+  std::vector<NvDsAnalyticsObjInfo> mObjInfo;  // one per vehicle slot
+};
+
+struct Totals {
+  counts_t mTruth{};     // vehicles that drove from entry to exit
+  counts_t mTracked{};   // the same, as far as the tracker ids allow
+  std::uint64_t mArrived{0};
+  std::uint64_t mExited{0};
+  std::uint64_t mDelayed{0};  // arrivals held back by --density
+  std::uint64_t mSwitches{0};
+  std::uint64_t mOcclusions{0};
+  std::uint64_t mObjects{0};
+};
+
+void usage(const char *app) {
+  std::cerr << "Usage: " << app << " [options]" << std::endl;
+  std::cerr << "  Drives the analytics probe with seeded synthetic traffic through the gates" << std::endl;
+  std::cerr << "  of " << ANALYTICS_CONFIG_FILE << " and checks the O/D matrix against ground" << std::endl;
+  std::cerr << "  truth. Run from the repository root, features come from cfg/app_config.txt." << std::endl;
+  std::cerr << "  --streams N          virtual streams, one frame each per batch (1)" << std::endl;
+  std::cerr << "  --seconds S          simulated time (3600)" << std::endl;
+  std::cerr << "  --fps F              frames per second of every stream (25)" << std::endl;
+  std::cerr << "  --speedup X          times real time, 0 for as fast as possible (0)" << std::endl;
+  std::cerr << "  --rate R             arrivals per gate per minute (6)" << std::endl;
+  std::cerr << "  --density N          most vehicles in the scene of a stream (20)" << std::endl;
+  std::cerr << "  --speed PX           mean speed, pixels per second (150)" << std::endl;
+  std::cerr << "  --id-switches R      tracker id switches per vehicle minute (0)" << std::endl;
+  std::cerr << "  --occlusions R       occlusions per vehicle minute (0)" << std::endl;
+  std::cerr << "  --occlusion-ms MS    length of an occlusion (400)" << std::endl;
+  std::cerr << "  --bus-share F        share of buses, the rest are cars (0.1)" << std::endl;
+  std::cerr << "  --seed S             (1)" << std::endl;
+  std::cerr << "  --tolerance PCT      allowed difference to the reference (0)" << std::endl;
+  std::cerr << "  --kafka              send the messages to the broker of cfg/kafka_config.txt" << std::endl;
+  std::cerr << "  --json" << std::endl;
+  std::cerr << "  --alloc-check        fail when the probe allocates after its warm-up, needs a" << std::endl;
+  std::cerr << "                       build with make ALLOC_ACCOUNTING=1" << std::endl;
+}
+
+bool parseNumber(const char *text, double &value, const double min) {
+  char *end = nullptr;
+  value = std::strtod(text, &end);
+  return end != text && '\0' == *end && value >= min;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+  for (int idx = 1; idx < argc; ++idx) {
+    const char *arg = argv[idx];
+    bool hasValue = idx + 1 < argc;
+    double value = 0;
+    if (!std::strcmp(arg, "--json")) {
+      options.mJson = true;
+    } else if (!std::strcmp(arg, "--kafka")) {
+      options.mKafka = true;
+    } else if (!std::strcmp(arg, "--alloc-check")) {
+      options.mAllocCheck = true;
+    } else if (!hasValue || !parseNumber(argv[++idx], value, 0)) {
+      return false;
+    } else if (!std::strcmp(arg, "--streams") && value >= 1) {
+      options.mStreams = static_cast<std::uint32_t>(value);
+    } else if (!std::strcmp(arg, "--seconds") && value > 0) {
+      options.mSeconds = value;
+    } else if (!std::strcmp(arg, "--fps") && value > 0) {
+      options.mFps = value;
+    } else if (!std::strcmp(arg, "--speedup")) {
+      options.mSpeedup = value;
+    } else if (!std::strcmp(arg, "--rate") && value > 0) {
+      options.mRate = value;
+    } else if (!std::strcmp(arg, "--density") && value >= 1) {
+      options.mDensity = static_cast<std::uint32_t>(value);
+    } else if (!std::strcmp(arg, "--speed") && value > 0) {
+      options.mSpeed = value;
+    } else if (!std::strcmp(arg, "--id-switches")) {
+      options.mSwitches = value;
+    } else if (!std::strcmp(arg, "--occlusions")) {
+      options.mOcclusions = value;
+    } else if (!std::strcmp(arg, "--occlusion-ms")) {
+      options.mOcclusionMs = value;
+    } else if (!std::strcmp(arg, "--bus-share") && value <= 1) {
+      options.mBusShare = value;
+    } else if (!std::strcmp(arg, "--seed")) {
+      options.mSeed = static_cast<std::uint64_t>(value);
+    } else if (!std::strcmp(arg, "--tolerance")) {
+      options.mTolerance = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t gateIndex(const std::string &name) {
+  return gates::index(name.c_str(), std::min(name.find('-'), name.size()));
+}
+
+bool endsWith(const std::string &text, const char *suffix) {
+  auto length = std::strlen(suffix);
+  return text.size() >= length && 0 == text.compare(text.size() - length, length, suffix);
+}
+
+std::vector<Point> getPoints(GKeyFile *keyFile, const char *group, const char *key) {
+  gsize length = 0;
+  GError *error = nullptr;
+  gint *values = g_key_file_get_integer_list(keyFile, group, key, &length, &error);
+  if (error) {
+    std::string message = error->message;
+    g_error_free(error);
+    throw std::runtime_error(std::string(ERR_MSG_ANALYTICS_CONFIG) + ": " + message);
+  }
+  std::vector<Point> points;
+  for (gsize idx = 0; idx + 1 < length; idx += 2) {
+    points.push_back(Point{static_cast<double>(values[idx]), static_cast<double>(values[idx + 1])});
+  }
+  g_free(values);
+  return points;
+}
+
+std::vector<std::string> getKeys(GKeyFile *keyFile, const char *group) {
+  GError *error = nullptr;
+  gchar **keys = g_key_file_get_keys(keyFile, group, nullptr, &error);
+  if (error) {
+    std::string message = error->message;
+    g_error_free(error);
+    throw std::runtime_error(std::string(ERR_MSG_ANALYTICS_CONFIG) + ": " + message);
+  }
+  std::vector<std::string> names;
+  for (gchar **key = keys; *key; ++key) {
+    names.push_back(*key);
+  }
+  g_strfreev(keys);
+  return names;
+}
+
+// Into the roundabout over the entry line, counterclockwise around the
+// ring, out over the exit line
+Path makePath(const Scene &scene, const std::size_t entry, const std::size_t exit) {
+  double left = scene.mRoi[0].mX, right = left, top = scene.mRoi[0].mY, bottom = top;
+  Point center{0, 0};
+  for (const auto &point: scene.mRoi) {
+    left = std::min(left, point.mX);
+    right = std::max(right, point.mX);
+    top = std::min(top, point.mY);
+    bottom = std::max(bottom, point.mY);
+    center = center + (1.0 / scene.mRoi.size()) * point;
+  }
+  double radiusX = RING_SCALE * (right - left) / 2;
+  double radiusY = RING_SCALE * (bottom - top) / 2;
+  auto angle = [&](const Point &point) {
+    return std::atan2((point.mY - center.mY) / radiusY, (point.mX - center.mX) / radiusX);
+  };
+
+  const auto &in = scene.mLines[scene.mEntryLine[entry]];
+  const auto &out = scene.mLines[scene.mExitLine[exit]];
+  auto inMiddle = 0.5 * (in.mFrom + in.mTo);
+  auto outMiddle = 0.5 * (out.mFrom + out.mTo);
+  auto joins = inMiddle + INSIDE * in.mDirection;
+  auto leaves = outMiddle - INSIDE * out.mDirection;
+
+  Path path;
+  path.mPoints.push_back(inMiddle - APPROACH * in.mDirection);
+  path.mPoints.push_back(joins);
+  // Counterclockwise on screen is a decreasing angle with y pointing down
+  auto from = angle(joins);
+  auto turn = std::fmod(from - angle(leaves) + 4 * M_PI, 2 * M_PI);
+  auto steps = static_cast<int>(std::ceil(turn / RING_STEP));
+  for (int step = 0; step <= steps; ++step) {
+    auto at = from - turn * step / std::max(steps, 1);
+    path.mPoints.push_back(Point{center.mX + radiusX * std::cos(at), center.mY + radiusY * std::sin(at)});
+  }
+  path.mPoints.push_back(leaves);
+  path.mPoints.push_back(outMiddle + APPROACH * out.mDirection);
+
+  double distance = 0;
+  path.mDistance.push_back(0);
+  for (std::size_t idx = 1; idx < path.mPoints.size(); ++idx) {
+    auto step = path.mPoints[idx] - path.mPoints[idx - 1];
+    distance += std::sqrt(dot(step, step));
+    path.mDistance.push_back(distance);
+  }
+
+  // Every line the path crosses has to be its own, or the ground truth
+  // would not be what the gates count
+  std::vector<std::size_t> crossed;
+  for (std::size_t idx = 1; idx < path.mPoints.size(); ++idx) {
+    for (std::size_t line = 0; line < scene.mLines.size(); ++line) {
+      if (crosses(path.mPoints[idx - 1], path.mPoints[idx], scene.mLines[line])) {
+        crossed.push_back(line);
+      }
+    }
+  }
+  if (crossed != std::vector<std::size_t>{scene.mEntryLine[entry], scene.mExitLine[exit]}) {
+    throw std::runtime_error(std::string(ERR_MSG_PATH) + " " + gates::name(entry) + " to " + gates::name(exit));
+  }
+  return path;
+}
+
+Scene loadScene(const char *file) {
+  std::unique_ptr<GKeyFile, decltype(&g_key_file_free)> keyFile{g_key_file_new(), g_key_file_free};
+  GError *error = nullptr;
+  if (!g_key_file_load_from_file(keyFile.get(), file, G_KEY_FILE_NONE, &error)) {
+    std::string message = error->message;
+    g_error_free(error);
+    throw std::runtime_error(std::string(ERR_MSG_ANALYTICS_CONFIG) + ": " + message);
+  }
+
+  Scene scene;
+  scene.mEntryLine.fill(NO_LINE);
+  scene.mExitLine.fill(NO_LINE);
+  for (const auto &key: getKeys(keyFile.get(), CONFIG_GROUP_LINE_CROSSING)) {
+    if (0 != key.compare(0, std::strlen(LINE_CROSSING_PREFIX), LINE_CROSSING_PREFIX)) {
+      continue;
+    }
+    Line line;
+    line.mName = key.substr(std::strlen(LINE_CROSSING_PREFIX));
+    line.mGate = gateIndex(line.mName);
+    line.mEntry = endsWith(line.mName, ENTRY_SUFFIX);
+    if (GATES == line.mGate || (!line.mEntry && !endsWith(line.mName, EXIT_SUFFIX))) {
+      // Counted by nvdsanalytics, ignored by the probe
+      continue;
+    }
+    auto points = getPoints(keyFile.get(), CONFIG_GROUP_LINE_CROSSING, key.c_str());
+    if (4 != points.size()) {
+      throw std::runtime_error(std::string(ERR_MSG_LINE) + ": " + key);
+    }
+    auto direction = points[1] - points[0];
+    line.mDirection = (1.0 / std::sqrt(dot(direction, direction))) * direction;
+    line.mFrom = points[2];
+    line.mTo = points[3];
+    (line.mEntry ? scene.mEntryLine : scene.mExitLine)[line.mGate] = scene.mLines.size();
+    scene.mLines.push_back(line);
+  }
+  for (std::size_t gate = 0; gate < GATES; ++gate) {
+    if (NO_LINE == scene.mEntryLine[gate] || NO_LINE == scene.mExitLine[gate]) {
+      throw std::runtime_error(std::string(ERR_MSG_GATES) + ": " + gates::name(gate));
+    }
+  }
+
+  for (const auto &key: getKeys(keyFile.get(), CONFIG_GROUP_ROI)) {
+    if (0 == key.compare(0, std::strlen(ROI_PREFIX), ROI_PREFIX)) {
+      scene.mRoiName = key.substr(std::strlen(ROI_PREFIX));
+      scene.mRoi = getPoints(keyFile.get(), CONFIG_GROUP_ROI, key.c_str());
+      break;
+    }
+  }
+  if (scene.mRoi.size() < 3) {
+    throw std::runtime_error(ERR_MSG_ROI);
+  }
+
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      if (entry != exit) {
+        scene.mPaths[entry][exit] = makePath(scene, entry, exit);
+      }
+    }
+  }
+  return scene;
+}
+
+// The analytics user meta lives in the streams, the pool only lends the
+// NvDsUserMeta around it
+gpointer copyUserMeta(gpointer data, gpointer) {
+  return static_cast<NvDsUserMeta*>(data)->user_meta_data;
+}
+
+void releaseUserMeta(gpointer data, gpointer) {
+  static_cast<NvDsUserMeta*>(data)->user_meta_data = nullptr;
+}
+
+gpointer copyBatchMeta(gpointer data, gpointer) {
+  return data;
+}
+
+void releaseBatchMeta(gpointer, gpointer) {
+}
+
+NvDsUserMeta *userMeta(NvDsBatchMeta *batchMeta, void *data, const NvDsMetaType type) {
+  NvDsUserMeta *userMeta = nvds_acquire_user_meta_from_pool(batchMeta);
+  userMeta->user_meta_data = data;
+  userMeta->base_meta.meta_type = type;
+  userMeta->base_meta.copy_func = copyUserMeta;
+  userMeta->base_meta.release_func = releaseUserMeta;
+  return userMeta;
+}
+
+class TrafficGenerator final {
+ public:
+  TrafficGenerator(const Options &options, const Scene &scene) :
+    mOptions{options},
+    mScene{scene},
+    mRandom{options.mSeed},
+    mStreams(options.mStreams),
+    mFrameTime{1.0 / options.mFps},
+    mOcclusionFrames{static_cast<std::uint32_t>(std::max(1.0, std::round(options.mOcclusionMs / 1000 * options.mFps)))},
+    mNextId{1}
+  {
+    for (auto &stream: mStreams) {
+      stream.mVehicles.reserve(options.mDensity);
+      stream.mObjInfo.resize(options.mDensity);
+      for (auto &arrival: stream.mNextArrival) {
+        arrival = mRandom.exponential(options.mRate / 60);
+      }
+      // Every key up front, so that counting a crossing never allocates
+      for (const auto &line: scene.mLines) {
+        stream.mFrameMeta.objLCCumCnt[line.mName] = 0;
+        stream.mFrameMeta.objLCCurrCnt[line.mName] = 0;
+      }
+      stream.mFrameMeta.objInROIcnt[scene.mRoiName] = 0;
+    }
+  }
+
+  // One frame of every stream into the batch
+  void frame(NvDsBatchMeta *batchMeta, const std::uint64_t frameNum) {
+    auto now = frameNum * mFrameTime;
+    auto pts = static_cast<std::uint64_t>(now * NSEC_PER_SEC);
+    // As nvstreammux stamps it with attach-sys-ts
+    auto ntp = static_cast<std::uint64_t>(g_get_real_time()) * 1000;
+    for (std::uint32_t source = 0; source < mStreams.size(); ++source) {
+      NvDsFrameMeta *frameMeta = nvds_acquire_frame_meta_from_pool(batchMeta);
+      frameMeta->pad_index = source;
+      frameMeta->batch_id = source;
+      frameMeta->source_id = source;
+      frameMeta->frame_num = static_cast<gint>(frameNum);
+      frameMeta->buf_pts = pts;
+      frameMeta->ntp_timestamp = ntp;
+      nvds_add_frame_meta_to_batch(batchMeta, frameMeta);
+      step(mStreams[source], batchMeta, frameMeta, now);
+    }
+  }
+
+  const Totals &totals() const { return mTotals; }
+
+ private:
+  // Due arrivals in the order they come, over every gate
+  void arrive(Stream &stream, const double now) {
+    while (stream.mVehicles.size() < mOptions.mDensity) {
+      auto gate = static_cast<std::size_t>(std::min_element(stream.mNextArrival.begin(),
+        stream.mNextArrival.end()) - stream.mNextArrival.begin());
+      if (stream.mNextArrival[gate] > now) {
+        return;
+      }
+      if (now - stream.mNextArrival[gate] >= mFrameTime) {
+        // Queued at the gate while the scene was full
+        ++mTotals.mDelayed;
+      }
+      auto exit = (gate + 1 + mRandom.below(GATES - 1)) % GATES;
+      const auto *path = &mScene.mPaths[gate][exit];
+      auto cls = mRandom.chance(mOptions.mBusShare) ? PGIE_CLASS_ID_BUS : PGIE_CLASS_ID_CAR;
+      auto speed = mOptions.mSpeed * (MIN_SPEED + SPEED_SPREAD * mRandom.uniform());
+      stream.mVehicles.push_back(Vehicle{mNextId++, gate, exit, cls, path, 0.0, speed, path->at(0.0),
+        false, Point{0, 0}, 0, GATES});
+      stream.mNextArrival[gate] += mRandom.exponential(mOptions.mRate / 60);
+      ++mTotals.mArrived;
+    }
+  }
+
+  void step(Stream &stream, NvDsBatchMeta *batchMeta, NvDsFrameMeta *frameMeta, const double now) {
+    arrive(stream, now);
+    auto &frameInfo = stream.mFrameMeta;
+    for (auto &count: frameInfo.objLCCurrCnt) {
+      count.second = 0;
+    }
+    std::uint32_t inRoi = 0;
+    double switchChance = mOptions.mSwitches / 60 * mFrameTime;
+    double occlusionChance = mOptions.mOcclusions / 60 * mFrameTime;
+    for (std::size_t slot = 0; slot < stream.mVehicles.size(); ++slot) {
+      auto &vehicle = stream.mVehicles[slot];
+      auto previous = vehicle.mPosition;
+      vehicle.mDistance += vehicle.mSpeed * mFrameTime;
+      vehicle.mPosition = vehicle.mPath->at(vehicle.mDistance);
+      if (crosses(previous, vehicle.mPosition, mScene.mLines[mScene.mExitLine[vehicle.mExit]])) {
+        mTotals.mTruth[vehicle.mEntry][vehicle.mExit] += 1;
+        ++mTotals.mExited;
+      }
+
+      if (vehicle.mHidden > 0) {
+        --vehicle.mHidden;
+        continue;
+      }
+      if (mRandom.chance(occlusionChance)) {
+        vehicle.mHidden = mOcclusionFrames - 1;
+        ++mTotals.mOcclusions;
+        continue;
+      }
+      if (mRandom.chance(switchChance)) {
+        // nvdsanalytics has no history for the new id
+        vehicle.mId = mNextId++;
+        vehicle.mTracked = false;
+        vehicle.mFirstGate = GATES;
+        vehicle.mHidden = SWITCH_FRAMES - 1;
+        ++mTotals.mSwitches;
+        continue;
+      }
+
+      auto &objInfo = stream.mObjInfo[slot];
+      objInfo.lcStatus.clear();
+      auto first = mScene.mLines.size();
+      for (std::size_t idx = 0; vehicle.mTracked && idx < mScene.mLines.size(); ++idx) {
+        const auto &line = mScene.mLines[idx];
+        if (crosses(vehicle.mLastSeen, vehicle.mPosition, line)) {
+          first = std::min(first, idx);
+          objInfo.lcStatus.push_back(line.mName);
+          frameInfo.objLCCumCnt[line.mName] += 1;
+          frameInfo.objLCCurrCnt[line.mName] += 1;
+        }
+      }
+      if (first < mScene.mLines.size()) {
+        // The probe goes by the first line of a frame, the second crossing
+        // of an id is its exit
+        auto gate = mScene.mLines[first].mGate;
+        if (GATES == vehicle.mFirstGate) {
+          vehicle.mFirstGate = gate;
+        } else {
+          mTotals.mTracked[vehicle.mFirstGate][gate] += 1;
+          vehicle.mFirstGate = GATES;
+        }
+      }
+      vehicle.mLastSeen = vehicle.mPosition;
+      vehicle.mTracked = true;
+
+      NvDsObjectMeta *objMeta = nvds_acquire_obj_meta_from_pool(batchMeta);
+      objMeta->class_id = vehicle.mClass;
+      objMeta->object_id = vehicle.mId;
+      objMeta->confidence = 1.0;
+      // Lines are crossed by the bottom center of the box
+      objMeta->rect_params.left = static_cast<float>(vehicle.mPosition.mX - BOX_WIDTH / 2);
+      objMeta->rect_params.top = static_cast<float>(vehicle.mPosition.mY - BOX_HEIGHT);
+      objMeta->rect_params.width = static_cast<float>(BOX_WIDTH);
+      objMeta->rect_params.height = static_cast<float>(BOX_HEIGHT);
+      nvds_add_obj_meta_to_frame(frameMeta, objMeta, nullptr);
+      nvds_add_user_meta_to_obj(objMeta, userMeta(batchMeta, &objInfo, NVDS_USER_OBJ_META_NVDSANALYTICS));
+      ++mTotals.mObjects;
+      if (inside(mScene.mRoi, vehicle.mPosition)) {
+        ++inRoi;
+      }
+    }
+    frameInfo.objInROIcnt[mScene.mRoiName] = inRoi;
+    nvds_add_user_meta_to_frame(frameMeta, userMeta(batchMeta, &frameInfo, NVDS_USER_FRAME_META_NVDSANALYTICS));
+
+    // Past the end of their path, the tracker drops them
+    stream.mVehicles.erase(std::remove_if(stream.mVehicles.begin(), stream.mVehicles.end(),
+      [](const Vehicle &vehicle) { return vehicle.mDistance >= vehicle.mPath->length(); }),
+      stream.mVehicles.end());
+  }
+
+  const Options &mOptions;
+  const Scene &mScene;
+  Random mRandom;
+  std::vector<Stream> mStreams;
+  double mFrameTime;  // seconds
+  std::uint32_t mOcclusionFrames;
+  std::uint64_t mNextId;
+  Totals mTotals;
+};
+
+void kafkaCall(RdKafka::Event &event) {
+  if (RdKafka::Event::EVENT_ERROR == event.type()) {
+    LOG_ERROR("Kafka ERROR ({}): {}", RdKafka::err2str(event.err()), event.str());
+  }
+}
+
+template <typename Matrix>
+void printMatrix(std::ostream &out, const Matrix &matrix) {
+  out << "[";
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    out << (entry ? ",[" : "[");
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      out << (exit ? "," : "") << matrix[entry][exit];
+    }
+    out << "]";
+  }
+  out << "]";
+}
+
+template <typename Matrix>
+void printTable(std::ostream &out, const char *title, const Matrix &matrix) {
+  out << title << std::endl << "     ";
+  for (std::size_t gate = 0; gate < GATES; ++gate) {
+    out << std::setw(10) << gates::name(gate);
+  }
+  out << std::endl;
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    out << std::setw(5) << gates::name(entry);
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      out << std::setw(10) << matrix[entry][exit];
+    }
+    out << std::endl;
+  }
+}
+
+std::uint64_t total(const counts_t &counts) {
+  std::uint64_t sum = 0;
+  for (const auto &entry: counts) {
+    for (const auto exit: entry) {
+      sum += exit;
+    }
+  }
+  return sum;
+}
+
+// Sum of the cell differences
+std::uint64_t difference(const counts_t &reference, const ::metadata::crossings_t &counted) {
+  std::uint64_t sum = 0;
+  for (std::size_t entry = 0; entry < GATES; ++entry) {
+    for (std::size_t exit = 0; exit < GATES; ++exit) {
+      auto lhs = reference[entry][exit];
+      auto rhs = static_cast<std::uint64_t>(counted[entry][exit]);
+      sum += lhs > rhs ? lhs - rhs : rhs - lhs;
+    }
+  }
+  return sum;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  gst_init(&argc, &argv);
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage(argv[0]);
+    return 1;
+  }
+  auto frames = static_cast<std::uint64_t>(options.mSeconds * options.mFps);
+  if (options.mAllocCheck && !allocaccounting::ENABLED) {
+    std::cerr << "--alloc-check needs a build with make ALLOC_ACCOUNTING=1" << std::endl;
+    return 1;
+  }
+  if (options.mAllocCheck && frames <= allocaccounting::WARMUP_BUFFERS) {
+    std::cerr << "--alloc-check needs more than " << allocaccounting::WARMUP_BUFFERS
+              << " buffers, --seconds times --fps" << std::endl;
+    return 1;
+  }
+
+  vehicletracking::app_info_t appInfo;
+  if (!appparser::setAppProperties(appInfo)) {
+    std::cerr << "Unable to set application properties" << std::endl;
+    return 1;
+  }
+  logger::Logger log{appInfo.mLogging};
+
+  std::unique_ptr<Scene> scene;
+  try {
+    scene.reset(new Scene(loadScene(ANALYTICS_CONFIG_FILE)));
+    // Every stream crosses the lines of stream 0
+    metadata::setGates(std::make_shared<const gates::GateRegistry>(ANALYTICS_CONFIG_FILE, options.mStreams));
+    if (options.mKafka) {
+      kafkaproducer::kafka_info_t kafkaInfo;
+      if (!kafkaparser::setKafkaProperties(kafkaInfo)) {
+        std::cerr << "Unable to set kafka properties" << std::endl;
+        return 1;
+      }
+      metadata::setSink(metadata::sink_t{std::make_shared<kafkaproducer::KafkaProducer>(
+        kafkaInfo.mEndpoint, kafkaInfo.mTopic, kafkaCall), kafkaInfo.mPerEvent});
+    }
+    // What the pipeline sets up, less the checkpoint and the shared
+    // counters: both carry counts over from earlier runs
+    metadata::setCube(appInfo.mCube);
+    metadata::setWindows(appInfo.mWindows);
+    if (appInfo.mStitching.mEnable) {
+      metadata::setStitching(appInfo.mStitching);
+    }
+    if (appInfo.mOccupancy.mEnable) {
+      metadata::setOccupancy(appInfo.mOccupancy);
+    }
+    if (appInfo.mArchive.mEnable) {
+      metadata::setArchive(appInfo.mArchive);
+    }
+    if (appInfo.mMetaRing.mEnable) {
+      metadata::setMetaRing(appInfo.mMetaRing);
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  TrafficGenerator generator{options, *scene};
+  NvDsBatchMeta *batchMeta = nvds_create_batch_meta(options.mStreams);
+  GstBuffer *buffer = gst_buffer_new();
+  NvDsMeta *meta = gst_buffer_add_nvds_meta(buffer, batchMeta, nullptr, copyBatchMeta, releaseBatchMeta);
+  meta->meta_type = NVDS_BATCH_GST_META;
+  GstPadProbeInfo info{};
+  info.data = buffer;
+
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration inProbe{0};
+  for (std::uint64_t frameNum = 0; frameNum < frames; ++frameNum) {
+    generator.frame(batchMeta, frameNum);
+    auto probeStart = std::chrono::steady_clock::now();
+    metadata::nvdsanalyticsSrcPadBufferProbe(nullptr, &info, nullptr);
+    inProbe += std::chrono::steady_clock::now() - probeStart;
+    while (batchMeta->frame_meta_list) {
+      nvds_remove_frame_meta_from_batch(batchMeta, static_cast<NvDsFrameMeta*>(batchMeta->frame_meta_list->data));
+    }
+    if (options.mSpeedup > 0) {
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((frameNum + 1) / options.mFps / options.mSpeedup)));
+    }
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto probeSeconds = std::chrono::duration<double>(inProbe).count();
+  metadata::flushWindows();
+  if (!appInfo.mMetrics.mTextfile.empty() && !metrics::writeTextfile(appInfo.mMetrics.mTextfile)) {
+    std::cerr << "Unable to write the metrics to " << appInfo.mMetrics.mTextfile << std::endl;
+  }
+  // Delivers what is queued while the logger is still up
+  metadata::setSink(metadata::sink_t{nullptr, true});
+  metadata::closeArchive();
+  gst_buffer_unref(buffer);
+  nvds_destroy_batch_meta(batchMeta);
+
+  const auto &totals = generator.totals();
+  auto counted = metadata::crossingsMatrix();
+  // Stitching may count vehicles the tracker lost, then only the ground
+  // truth says whether it got them right
+  const auto &reference = appInfo.mStitching.mEnable ? totals.mTruth : totals.mTracked;
+  auto error = difference(reference, counted);
+  bool pass = error <= options.mTolerance / 100 * total(reference);
+  auto speedup = options.mSeconds / std::max(seconds, 1e-9);
+  auto regressions = allocaccounting::regressions();
+  bool allocPass = !options.mAllocCheck || 0 == regressions;
+
+  if (options.mJson) {
+    std::cout << "{\"streams\":" << options.mStreams << ", \"seconds\":" << options.mSeconds;
+    std::cout << ", \"seed\":" << options.mSeed << ", \"wall_seconds\":" << seconds;
+    std::cout << ", \"probe_seconds\":" << probeSeconds << ", \"speedup\":" << speedup;
+    std::cout << ", \"arrived\":" << totals.mArrived << ", \"exited\":" << totals.mExited;
+    std::cout << ", \"delayed\":" << totals.mDelayed << ", \"id_switches\":" << totals.mSwitches;
+    std::cout << ", \"occlusions\":" << totals.mOcclusions << ", \"objects\":" << totals.mObjects;
+    std::cout << ", \"gates\":[";
+    for (std::size_t idx = 0; idx < GATES; ++idx) {
+      std::cout << (idx ? "," : "") << std::quoted(gates::name(idx));
+    }
+    std::cout << "], \"truth\":";
+    printMatrix(std::cout, totals.mTruth);
+    std::cout << ", \"tracked\":";
+    printMatrix(std::cout, totals.mTracked);
+    std::cout << ", \"counted\":";
+    printMatrix(std::cout, counted);
+    std::cout << ", \"reference\":" << (appInfo.mStitching.mEnable ? "\"truth\"" : "\"tracked\"");
+    std::cout << ", \"difference\":" << error << ", \"pass\":" << (pass ? "true" : "false");
+    if (options.mAllocCheck) {
+      std::cout << ", \"alloc_pass\":" << (allocPass ? "true" : "false");
+    }
+    std::cout << ", \"stats\":" << metadata::statsJson() << "}" << std::endl;
+  } else {
+    std::cout << "Simulated " << options.mSeconds << " s of " << options.mStreams << " streams at "
+              << options.mFps << " fps in " << seconds << " s, " << std::fixed << std::setprecision(1)
+              << speedup << "x real time, " << probeSeconds * 1e6 / std::max<std::uint64_t>(frames, 1)
+              << " us per buffer in the probe" << std::defaultfloat << std::endl;
+    std::cout << totals.mArrived << " vehicles arrived, " << totals.mExited << " exited, "
+              << totals.mDelayed << " delayed by the density, " << totals.mSwitches << " id switches, "
+              << totals.mOcclusions << " occlusions" << std::endl << std::endl;
+    printTable(std::cout, "Ground truth", totals.mTruth);
+    std::cout << std::endl;
+    printTable(std::cout, "Tracker view (same id over entry and exit)", totals.mTracked);
+    std::cout << std::endl;
+    printTable(std::cout, "Counted", counted);
+    std::cout << std::endl << metadata::statsJson() << std::endl << std::endl;
+    std::cout << (pass ? "PASS" : "FAIL") << ": counted differs from the "
+              << (appInfo.mStitching.mEnable ? "ground truth" : "tracker view") << " by " << error
+              << " of " << total(reference) << std::endl;
+    if (options.mAllocCheck) {
+      std::cout << (allocPass ? "PASS" : "FAIL") << ": the probe allocated on " << regressions << " of "
+                << frames - allocaccounting::WARMUP_BUFFERS << " buffers after the warm-up" << std::endl;
+    }
+  }
+  if (!pass) {
+    return EXIT_MISMATCH;
+  }
+  return allocPass ? 0 : EXIT_ALLOC_REGRESSION;
+}